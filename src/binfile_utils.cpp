@@ -9,11 +9,12 @@
 
 #include "binfile_utils.hpp"
 #include "fileloader.hpp"
+#include "prefetcher.hpp"
 
 namespace BinFileUtils {
 
-BinFile::BinFile(const std::string& fileName, const std::string& _type, uint32_t maxVersion)
-    : fileLoader(fileName)
+BinFile::BinFile(const std::string& fileName, const std::string& _type, uint32_t maxVersion, unsigned int loadFlags)
+    : fileLoader(fileName, loadFlags)
 {
     addr = fileLoader.dataBuffer();
     size = fileLoader.dataSize();
@@ -134,6 +135,19 @@ uint64_t BinFile::getSectionSize(uint32_t sectionId, uint32_t sectionPos) {
     return sections[sectionId][sectionPos].size;
 }
 
+void BinFile::adviseSection(uint32_t sectionId, int advice) {
+
+    auto it = sections.find(sectionId);
+
+    if (it == sections.end()) {
+        return;
+    }
+
+    for (const Section &s : it->second) {
+        adviseRange(s.start, s.size, advice);
+    }
+}
+
 uint32_t BinFile::readU32LE() {
     const uint64_t new_pos = pos + 4;
 
@@ -170,8 +184,8 @@ void *BinFile::read(uint64_t len) {
     return res;
 }
 
-std::unique_ptr<BinFile> openExisting(const std::string& filename, const std::string& type, uint32_t maxVersion) {
-    return std::unique_ptr<BinFile>(new BinFile(filename, type, maxVersion));
+std::unique_ptr<BinFile> openExisting(const std::string& filename, const std::string& type, uint32_t maxVersion, unsigned int loadFlags) {
+    return std::unique_ptr<BinFile>(new BinFile(filename, type, maxVersion, loadFlags));
 }
 
 } // Namespace
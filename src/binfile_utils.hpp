@@ -38,23 +38,32 @@ namespace BinFileUtils {
     public:
 
         BinFile(const void *fileData, size_t fileSize, std::string _type, uint32_t maxVersion);
-        BinFile(const std::string& fileName, const std::string& _type, uint32_t maxVersion);
+        // loadFlags: FileLoader::LOAD_* flags
+        BinFile(const std::string& fileName, const std::string& _type, uint32_t maxVersion, unsigned int loadFlags = 0);
         BinFile(const BinFile&) = delete;
         BinFile& operator=(const BinFile&) = delete;
 
         void startReadSection(uint32_t sectionId, uint32_t setionPos = 0);
         void endReadSection(bool check = true);
 
+        bool hasSection(uint32_t sectionId) const { return sections.find(sectionId) != sections.end(); }
+
+        const void *data() const { return addr; }
+        uint64_t dataSize() const { return size; }
+
         void *getSectionData(uint32_t sectionId, uint32_t sectionPos = 0);
         uint64_t getSectionSize(uint32_t sectionId, uint32_t sectionPos = 0);
 
+        // madvise hint (MADV_*) for every instance of a section; no-op if absent
+        void adviseSection(uint32_t sectionId, int advice);
+
         uint32_t readU32LE();
         uint64_t readU64LE();
 
         void *read(uint64_t l);
     };
 
-    std::unique_ptr<BinFile> openExisting(const std::string& filename, const std::string& type, uint32_t maxVersion);
+    std::unique_ptr<BinFile> openExisting(const std::string& filename, const std::string& type, uint32_t maxVersion, unsigned int loadFlags = 0);
 } // Namespace
 
 #endif // BINFILE_UTILS_H
@@ -0,0 +1,414 @@
+#include <gmp.h>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <mutex>
+
+template <typename Field>
+LazyFFT<Field>::LazyFFT(uint64_t maxDomainSize, ThreadPool &threadPool)
+    : f(Field::field)
+{
+    maxDomainPow = log2(maxDomainSize);
+
+    mpz_t q, e;
+    mpz_init(q);
+    mpz_init(e);
+
+    f.toMpz(q, f.negOne());
+    mpz_add_ui(q, q, 1);
+
+    mpz_sub_ui(e, q, 1);
+    const uint32_t s = mpz_scan1(e, 0);
+
+    if (maxDomainPow > s) {
+        mpz_clear(q);
+        mpz_clear(e);
+        throw std::invalid_argument("Domain size too big for the field: 2^" + std::to_string(maxDomainPow)
+                                    + " > 2^" + std::to_string(s));
+    }
+
+    // First quadratic non-residue, searched the same way ffiasm does
+    Element nqr, aux;
+    f.set(nqr, 2);
+    mpz_fdiv_q_2exp(e, q, 1);
+    for (;;) {
+        expMpz(aux, nqr, e);
+        if (!f.eq(aux, f.one())) {
+            break;
+        }
+        f.add(nqr, nqr, f.one());
+    }
+
+    // Primitive 2^s root of unity, squared down to 2^maxDomainPow
+    Element rootMax;
+    mpz_sub_ui(e, q, 1);
+    mpz_fdiv_q_2exp(e, e, s);
+    expMpz(rootMax, nqr, e);
+    for (uint32_t i = s; i > maxDomainPow; i--) {
+        f.square(rootMax, rootMax);
+    }
+
+    mpz_clear(q);
+    mpz_clear(e);
+
+    computeTwiddles(rootMax, threadPool);
+
+    Element two;
+    f.set(two, 2);
+    f.inv(two, two);
+    powTwoInv.resize(maxDomainPow + 1);
+    f.copy(powTwoInv[0], f.one());
+    for (uint32_t i = 1; i <= maxDomainPow; i++) {
+        f.mul(powTwoInv[i], powTwoInv[i-1], two);
+    }
+}
+
+template <typename Field>
+void LazyFFT<Field>::expMpz(Element &r, const Element &base, mpz_t e) {
+    std::vector<uint8_t> scalar((mpz_sizeinbase(e, 2) + 7) / 8 + 1);
+    size_t count = 0;
+
+    mpz_export(scalar.data(), &count, -1, 1, -1, 0, e);
+
+    if (count == 0) {
+        f.copy(r, f.one());
+        return;
+    }
+    f.exp(r, base, scalar.data(), count);
+}
+
+template <typename Field>
+void LazyFFT<Field>::computeTwiddles(const Element &rootMax, ThreadPool &threadPool) {
+    const uint64_t maxDomainSize = 1ULL << maxDomainPow;
+
+    twiddles.resize(maxDomainSize);
+    f.copy(twiddles[0], f.one());
+
+    if (maxDomainSize < 2) {
+        return;
+    }
+
+    // Top level: powers of the largest root, each thread starting from its own power
+    const uint64_t top = maxDomainSize / 2;
+
+    threadPool.parallelFor(0, top, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        Element w;
+
+        if (begin == 0) {
+            f.copy(w, f.one());
+        } else {
+            uint64_t exponent = begin;
+            f.exp(w, rootMax, (uint8_t *)&exponent, sizeof(exponent));
+        }
+
+        for (int64_t j = begin; j < end; j++) {
+            twiddles[top + j] = w;
+            FrOps::mul(w, w, rootMax);
+        }
+    });
+
+    // w_{2h}^j = w_{4h}^{2j}
+    for (uint64_t h = top / 2; h >= 1; h /= 2) {
+        threadPool.parallelFor(0, h, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+            for (int64_t j = begin; j < end; j++) {
+                twiddles[h + j] = twiddles[2*h + 2*j];
+            }
+        });
+    }
+}
+
+template <typename Field>
+uint32_t LazyFFT<Field>::log2(uint64_t n) {
+    uint32_t res = 0;
+    while (n > 1) {
+        n >>= 1;
+        res++;
+    }
+    return res;
+}
+
+template <typename Field>
+typename Field::Element LazyFFT<Field>::root(uint32_t domainPow, uint64_t idx) {
+    if (domainPow > maxDomainPow) {
+        throw std::range_error("Root of unity 2^" + std::to_string(domainPow) + " not available");
+    }
+
+    Element r;
+
+    if (domainPow == 0) {
+        f.copy(r, f.one());
+        return r;
+    }
+
+    const uint64_t h = 1ULL << (domainPow - 1);
+
+    // w^(h + j) = -w^j
+    if (idx < h) {
+        f.copy(r, twiddles[h + idx]);
+    } else {
+        f.neg(r, twiddles[idx]);
+    }
+    return r;
+}
+
+template <typename Field>
+uint64_t LazyFFT<Field>::reverseBits(uint64_t i, uint32_t domainPow) {
+    uint64_t r = 0;
+    for (uint32_t k = 0; k < domainPow; k++) {
+        r = (r << 1) | ((i >> k) & 1);
+    }
+    return r;
+}
+
+template <typename Field>
+uint32_t LazyFFT<Field>::checkSize(uint64_t n, uint32_t maxPow) {
+    const uint32_t domainPow = log2(n);
+
+    if (n != (1ULL << domainPow) || domainPow > maxPow) {
+        throw std::invalid_argument("Invalid FFT size: " + std::to_string(n));
+    }
+    return domainPow;
+}
+
+template <typename Field>
+void LazyFFT<Field>::bitReverse(Element *a, uint32_t domainPow, ThreadPool &threadPool) {
+    const uint64_t n = 1ULL << domainPow;
+
+    threadPool.parallelFor(0, n, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t i = begin; i < end; i++) {
+            const uint64_t r = reverseBits(i, domainPow);
+            if ((uint64_t)i < r) {
+                std::swap(a[i], a[r]);
+            }
+        }
+    });
+}
+
+// Twiddle of butterfly j in the layer of half-size h. The inverse uses
+// w^-j = -w^(h-j), read from the same table with the operands swapped.
+template <typename Field>
+inline const typename Field::Element &LazyFFT<Field>::twiddle(uint64_t h, uint64_t j, bool inverse, bool &swapped) {
+    swapped = inverse && j != 0;
+    return swapped ? twiddles[2*h - j] : twiddles[h + j];
+}
+
+// Cooley-Tukey: [0, 4q) -> [0, 4q)
+template <typename Field>
+inline void LazyFFT<Field>::butterflyDit(Element &x, Element &y, const Element &w, bool swapped) {
+    Element u, t;
+
+    FrOps::reduceLazy(u, x);
+    FrOps::mulLazy(t, y, w);
+
+    if (swapped) {
+        FrOps::subLazy(x, u, t);
+        FrOps::addLazy(y, u, t);
+    } else {
+        FrOps::addLazy(x, u, t);
+        FrOps::subLazy(y, u, t);
+    }
+}
+
+// Gentleman-Sande: [0, 2q) -> [0, 2q)
+template <typename Field>
+inline void LazyFFT<Field>::butterflyDif(Element &x, Element &y, const Element &w, bool swapped) {
+    Element s, d;
+
+    FrOps::addLazy(s, x, y);
+    if (swapped) {
+        FrOps::subLazy(d, y, x);
+    } else {
+        FrOps::subLazy(d, x, y);
+    }
+
+    FrOps::reduceLazy(x, s);
+    FrOps::mulLazy(y, d, w);
+}
+
+template <typename Field>
+inline void LazyFFT<Field>::finalize(Element &x, const Element *scale) {
+    if (scale != nullptr) {
+        FrOps::mul(x, x, *scale);
+    } else {
+        FrOps::reduceFull(x, x);
+    }
+}
+
+// Bit-reversed input in [0, 4q) -> natural order output in [0, q), multiplied
+// by *scale if given. Layers are fused in pairs (radix 4) so every element is
+// loaded and stored once per two layers; an odd leftover layer runs first.
+template <typename Field>
+void LazyFFT<Field>::ditLayers(Element *a, uint32_t domainPow, bool inverse, const Element *scale, ThreadPool &threadPool) {
+    const uint64_t n = 1ULL << domainPow;
+
+    if (domainPow == 0) {
+        finalize(a[0], scale);
+        return;
+    }
+
+    uint32_t layer = 0;
+
+    if (domainPow % 2 == 1) {
+        const bool last = domainPow == 1;
+
+        threadPool.parallelFor(0, n / 2, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+            for (int64_t k = begin; k < end; k++) {
+                Element &x = a[2*k];
+                Element &y = a[2*k + 1];
+
+                butterflyDit(x, y, twiddles[1], false);
+
+                if (last) {
+                    finalize(x, scale);
+                    finalize(y, scale);
+                }
+            }
+        });
+        layer = 1;
+    }
+
+    for (; layer < domainPow; layer += 2) {
+        const uint64_t h = 1ULL << layer;
+        const bool last = layer + 2 == domainPow;
+
+        threadPool.parallelFor(0, n / 4, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+            for (int64_t g = begin; g < end; g++) {
+                const uint64_t j = g & (h - 1);
+                const uint64_t base = ((g - j) << 2) + j;
+
+                Element &e0 = a[base];
+                Element &e1 = a[base + h];
+                Element &e2 = a[base + 2*h];
+                Element &e3 = a[base + 3*h];
+
+                bool swapped;
+                const Element &w1 = twiddle(h, j, inverse, swapped);
+                butterflyDit(e0, e1, w1, swapped);
+                butterflyDit(e2, e3, w1, swapped);
+
+                const Element &w2 = twiddle(2*h, j, inverse, swapped);
+                butterflyDit(e0, e2, w2, swapped);
+
+                const Element &w3 = twiddle(2*h, j + h, inverse, swapped);
+                butterflyDit(e1, e3, w3, swapped);
+
+                if (last) {
+                    finalize(e0, scale);
+                    finalize(e1, scale);
+                    finalize(e2, scale);
+                    finalize(e3, scale);
+                }
+            }
+        });
+    }
+}
+
+// Natural order input in [0, 2q) -> bit-reversed output in [0, 2q), unscaled.
+// Mirror of ditLayers: radix-4 passes from the top, odd leftover layer last.
+template <typename Field>
+void LazyFFT<Field>::difLayers(Element *a, uint32_t domainPow, bool inverse, ThreadPool &threadPool) {
+    const uint64_t n = 1ULL << domainPow;
+
+    int32_t layer = domainPow;
+
+    for (; layer >= 2; layer -= 2) {
+        const uint64_t h = 1ULL << (layer - 2);
+
+        threadPool.parallelFor(0, n / 4, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+            for (int64_t g = begin; g < end; g++) {
+                const uint64_t j = g & (h - 1);
+                const uint64_t base = ((g - j) << 2) + j;
+
+                Element &e0 = a[base];
+                Element &e1 = a[base + h];
+                Element &e2 = a[base + 2*h];
+                Element &e3 = a[base + 3*h];
+
+                bool swapped;
+                const Element &w2 = twiddle(2*h, j, inverse, swapped);
+                butterflyDif(e0, e2, w2, swapped);
+
+                const Element &w3 = twiddle(2*h, j + h, inverse, swapped);
+                butterflyDif(e1, e3, w3, swapped);
+
+                const Element &w1 = twiddle(h, j, inverse, swapped);
+                butterflyDif(e0, e1, w1, swapped);
+                butterflyDif(e2, e3, w1, swapped);
+            }
+        });
+    }
+
+    if (layer == 1) {
+        threadPool.parallelFor(0, n / 2, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+            for (int64_t k = begin; k < end; k++) {
+                butterflyDif(a[2*k], a[2*k + 1], twiddles[1], false);
+            }
+        });
+    }
+}
+
+template <typename Field>
+void LazyFFT<Field>::prepareCoset(uint64_t n, ThreadPool &threadPool) {
+    // The shift needs the 2n-th roots
+    const uint32_t domainPow = checkSize(2*n, maxDomainPow) - 1;
+
+    std::lock_guard<std::mutex> guard(cosetMutex);
+
+    if (cosetShift.size() == n) {
+        return;
+    }
+
+    std::vector<Element> shift(n);
+    const Element &nInv = powTwoInv[domainPow];
+
+    // shift[p] = w_{2n}^rev(p) / n, matching the bit-reversed ifft output
+    threadPool.parallelFor(0, n, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t p = begin; p < end; p++) {
+            FrOps::mul(shift[p], twiddles[n + reverseBits(p, domainPow)], nInv);
+        }
+    });
+
+    cosetShift.swap(shift);
+}
+
+template <typename Field>
+void LazyFFT<Field>::fft(Element *a, uint64_t n, ThreadPool &threadPool) {
+    const uint32_t domainPow = checkSize(n, maxDomainPow);
+
+    if (n == 1) {
+        return;
+    }
+
+    bitReverse(a, domainPow, threadPool);
+    ditLayers(a, domainPow, false, nullptr, threadPool);
+}
+
+template <typename Field>
+void LazyFFT<Field>::ifft(Element *a, uint64_t n, ThreadPool &threadPool) {
+    const uint32_t domainPow = checkSize(n, maxDomainPow);
+
+    if (n == 1) {
+        return;
+    }
+
+    bitReverse(a, domainPow, threadPool);
+    ditLayers(a, domainPow, true, &powTwoInv[domainPow], threadPool);
+}
+
+template <typename Field>
+void LazyFFT<Field>::cosetTransform(Element *a, uint64_t n, ThreadPool &threadPool) {
+    const uint32_t domainPow = checkSize(2*n, maxDomainPow) - 1;
+
+    prepareCoset(n, threadPool);
+
+    difLayers(a, domainPow, true, threadPool);
+
+    // Still in bit-reversed order: apply the shift and the 1/n of the ifft
+    threadPool.parallelFor(0, n, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t p = begin; p < end; p++) {
+            FrOps::mulLazy(a[p], a[p], cosetShift[p]);
+        }
+    });
+
+    ditLayers(a, domainPow, false, nullptr, threadPool);
+}
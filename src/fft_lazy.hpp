@@ -0,0 +1,83 @@
+#ifndef FFT_LAZY_HPP
+#define FFT_LAZY_HPP
+
+#include <cstdint>
+#include <vector>
+#include <gmp.h>
+#include <mutex>
+
+#include "threadpool.hpp"
+#include "fr_inline.hpp"
+
+// Radix-4 NTT over a prime field with Harvey-style lazy butterflies.
+//
+// Drop-in for the parts of ffiasm's FFT<Field> the provers use: same roots of
+// unity (2-adic root derived from the first quadratic non-residue), same
+// transform direction and ifft scaling, natural order in and out.
+//
+// Between layers values are kept in [0, 4q) instead of being fully reduced:
+// a butterfly does one conditional subtraction (of 2q) instead of three, and
+// the full reduction happens once, fused into the last layer. Requires
+// 4q < 2^256, which holds for the BN254 scalar field. Layers are fused in
+// pairs, so the array is traversed once per two layers.
+template <typename Field>
+class LazyFFT {
+
+    typedef typename Field::Element Element;
+    typedef typename InlineField<Field>::type FrOps;
+
+    Field &f;
+
+    uint32_t maxDomainPow;
+
+    // twiddles[h + j] = w_{2h}^j for every power of two h < maxDomainSize
+    std::vector<Element> twiddles;
+
+    // powTwoInv[k] = 2^-k
+    std::vector<Element> powTwoInv;
+
+    // cosetShift[p] = w_{2n}^rev(p) / n for the last prepared n
+    std::vector<Element> cosetShift;
+    std::mutex cosetMutex;
+
+    void expMpz(Element &r, const Element &base, mpz_t e);
+    void computeTwiddles(const Element &rootMax, ThreadPool &threadPool);
+
+    static uint64_t reverseBits(uint64_t i, uint32_t domainPow);
+    static uint32_t checkSize(uint64_t n, uint32_t maxPow);
+    void bitReverse(Element *a, uint32_t domainPow, ThreadPool &threadPool);
+
+    inline const Element &twiddle(uint64_t h, uint64_t j, bool inverse, bool &swapped);
+    static inline void butterflyDit(Element &x, Element &y, const Element &w, bool swapped);
+    static inline void butterflyDif(Element &x, Element &y, const Element &w, bool swapped);
+    static inline void finalize(Element &x, const Element *scale);
+
+    void ditLayers(Element *a, uint32_t domainPow, bool inverse, const Element *scale, ThreadPool &threadPool);
+    void difLayers(Element *a, uint32_t domainPow, bool inverse, ThreadPool &threadPool);
+
+public:
+    LazyFFT(uint64_t maxDomainSize, ThreadPool &threadPool = ThreadPool::defaultPool());
+
+    static uint32_t log2(uint64_t n);
+
+    // w_{2^domainPow}^idx, idx < 2^domainPow
+    Element root(uint32_t domainPow, uint64_t idx);
+
+    void fft(Element *a, uint64_t n, ThreadPool &threadPool = ThreadPool::defaultPool());
+    void ifft(Element *a, uint64_t n, ThreadPool &threadPool = ThreadPool::defaultPool());
+
+    // Builds the shift table used by cosetTransform (n elements). Called
+    // implicitly by the first cosetTransform of size n.
+    void prepareCoset(uint64_t n, ThreadPool &threadPool = ThreadPool::defaultPool());
+
+    // a <- evaluations on the coset w_{2n} * <w_n> of the polynomial whose
+    // evaluations on <w_n> are a, i.e. fft(shift(ifft(a))). The ifft runs
+    // decimation-in-frequency and leaves its output bit-reversed, the shift is
+    // applied in that order and the decimation-in-time fft takes it back to
+    // natural order, so no permutation pass is needed.
+    void cosetTransform(Element *a, uint64_t n, ThreadPool &threadPool = ThreadPool::defaultPool());
+};
+
+#include "fft_lazy.cpp"
+
+#endif // FFT_LAZY_HPP
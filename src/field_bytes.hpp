@@ -0,0 +1,35 @@
+#ifndef FIELD_BYTES_HPP
+#define FIELD_BYTES_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+// Big-endian encodings of field elements, 8 bytes per limb, as laid out in
+// EVM calldata. No conversion through GMP or strings.
+
+// 'e' in normal form, limbs little-endian as in the witness
+template <typename Element>
+inline void normalToBytesBE(const Element &e, uint8_t *out)
+{
+    const size_t nLimbs = sizeof(e.v) / sizeof(e.v[0]);
+
+    for (size_t i = 0; i < nLimbs; i++) {
+        const uint64_t limb = e.v[nLimbs - 1 - i];
+
+        for (size_t j = 0; j < 8; j++) {
+            out[i * 8 + j] = (uint8_t)(limb >> (56 - 8 * j));
+        }
+    }
+}
+
+// 'e' in Montgomery form, as the curve point coordinates
+template <typename Field>
+inline void montgomeryToBytesBE(Field &field, const typename Field::Element &e, uint8_t *out)
+{
+    typename Field::Element normal;
+
+    field.fromMontgomery(normal, e);
+    normalToBytesBE(normal, out);
+}
+
+#endif // FIELD_BYTES_HPP
@@ -0,0 +1,279 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "field_decimal.hpp"
+
+namespace FieldDecimal {
+
+typedef unsigned __int128 uint128_t;
+
+// 10^19, the largest power of ten in a limb
+static const uint64_t CHUNK = 10000000000000000000ULL;
+static const size_t CHUNK_DIGITS = 19;
+
+static const uint64_t POW10[CHUNK_DIGITS + 1] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Writes the 'n' low digits of 'c' ending at 'end', two at a time
+static void writeDigits(uint64_t c, char *end, size_t n)
+{
+    while (n >= 2) {
+        const uint64_t pair = c % 100;
+
+        c /= 100;
+        end -= 2;
+        std::memcpy(end, DIGIT_PAIRS + 2 * pair, 2);
+        n -= 2;
+    }
+
+    if (n == 1) {
+        *(end - 1) = (char)('0' + c);
+    }
+}
+
+static size_t countDigits(uint64_t c)
+{
+    size_t n = 1;
+
+    while (n < CHUNK_DIGITS && c >= POW10[n]) {
+        n++;
+    }
+    return n;
+}
+
+size_t toDecimal(const uint64_t *v, char *out)
+{
+    uint64_t n[4] = {v[0], v[1], v[2], v[3]};
+    // Base 10^19 digits, least significant first: 2^256 < 10^95
+    uint64_t chunks[5];
+    size_t nChunks = 0;
+    int top = 3;
+
+    while (top >= 0 && n[top] == 0) {
+        top--;
+    }
+
+    if (top < 0) {
+        out[0] = '0';
+        return 1;
+    }
+
+    // Split into 10^19 chunks by short division, dropping the limbs that
+    // become zero so that the last steps are single word divisions
+    while (top >= 0) {
+        uint64_t rem = 0;
+
+        for (int i = top; i >= 0; i--) {
+            const uint128_t cur = ((uint128_t)rem << 64) | n[i];
+
+            n[i] = (uint64_t)(cur / CHUNK);
+            rem = (uint64_t)(cur % CHUNK);
+        }
+        chunks[nChunks++] = rem;
+
+        while (top >= 0 && n[top] == 0) {
+            top--;
+        }
+    }
+
+    // Leading chunk without padding, the others as 19 digits each
+    const size_t leading = countDigits(chunks[nChunks - 1]);
+    const size_t len = leading + (nChunks - 1) * CHUNK_DIGITS;
+    char *end = out + len;
+
+    for (size_t k = 0; k + 1 < nChunks; k++) {
+        writeDigits(chunks[k], end, CHUNK_DIGITS);
+        end -= CHUNK_DIGITS;
+    }
+    writeDigits(chunks[nChunks - 1], end, leading);
+
+    return len;
+}
+
+bool fromDecimal(const char *str, size_t len, uint64_t *v)
+{
+    if (len == 0) {
+        return false;
+    }
+
+    // Leading zeros do not count against MAX_DIGITS
+    while (len > 1 && *str == '0') {
+        str++;
+        len--;
+    }
+
+    if (len > MAX_DIGITS) {
+        return false;
+    }
+
+    v[0] = v[1] = v[2] = v[3] = 0;
+
+    size_t chunkLen = len % CHUNK_DIGITS;
+
+    if (chunkLen == 0) {
+        chunkLen = CHUNK_DIGITS;
+    }
+
+    while (len > 0) {
+        uint64_t c = 0;
+
+        for (size_t i = 0; i < chunkLen; i++) {
+            const unsigned d = (unsigned char)str[i] - '0';
+
+            if (d > 9) {
+                return false;
+            }
+            c = c * 10 + d;
+        }
+
+        // v = v * 10^chunkLen + c
+        const uint64_t m = POW10[chunkLen];
+        uint64_t carry = c;
+
+        for (int i = 0; i < 4; i++) {
+            const uint128_t t = (uint128_t)v[i] * m + carry;
+
+            v[i] = (uint64_t)t;
+            carry = (uint64_t)(t >> 64);
+        }
+
+        if (carry != 0) {
+            return false;
+        }
+
+        str += chunkLen;
+        len -= chunkLen;
+        chunkLen = CHUNK_DIGITS;
+    }
+
+    return true;
+}
+
+static bool lessThan(const uint64_t *a, const uint64_t *b)
+{
+    for (int i = 3; i >= 0; i--) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i];
+        }
+    }
+    return false;
+}
+
+void reduce(uint64_t *v, const uint64_t *modulus)
+{
+    // Field moduli here are above 2^253, so this runs a few times at most
+    while (!lessThan(v, modulus)) {
+        uint64_t borrow = 0;
+
+        for (int i = 0; i < 4; i++) {
+            const uint128_t t = (uint128_t)v[i] - modulus[i] - borrow;
+
+            v[i] = (uint64_t)t;
+            borrow = (uint64_t)(t >> 127);
+        }
+    }
+}
+
+ArrayWriter::ArrayWriter(std::string &_out, size_t count)
+    : out(_out), empty(true)
+{
+    out.reserve(out.size() + count * (MAX_DIGITS + 3) + 2);
+}
+
+void ArrayWriter::add(const uint64_t *v)
+{
+    char digits[MAX_DIGITS];
+    const size_t len = toDecimal(v, digits);
+
+    out.push_back(empty ? '[' : ',');
+    empty = false;
+
+    out.push_back('"');
+    out.append(digits, len);
+    out.push_back('"');
+}
+
+void ArrayWriter::close()
+{
+    if (empty) {
+        out.append("null");
+    } else {
+        out.push_back(']');
+    }
+}
+
+ArrayReader::ArrayReader(const char *str, size_t len)
+    : pos(str), end(str + len), first(true), done(false)
+{
+    skipSpace();
+
+    if (pos == end || *pos != '[') {
+        throw std::invalid_argument("Expected a JSON array");
+    }
+    pos++;
+}
+
+void ArrayReader::skipSpace()
+{
+    while (pos != end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r')) {
+        pos++;
+    }
+}
+
+bool ArrayReader::next(uint64_t *v)
+{
+    if (done) {
+        return false;
+    }
+
+    skipSpace();
+
+    if (pos != end && *pos == ']') {
+        pos++;
+    } else {
+        if (!first) {
+            if (pos == end || *pos != ',') {
+                throw std::invalid_argument("Expected ',' or ']'");
+            }
+            pos++;
+            skipSpace();
+        }
+
+        if (pos == end || *pos != '"') {
+            throw std::invalid_argument("Expected a decimal string");
+        }
+        pos++;
+
+        const char *digits = pos;
+
+        while (pos != end && *pos != '"') {
+            pos++;
+        }
+
+        if (pos == end || !fromDecimal(digits, pos - digits, v)) {
+            throw std::invalid_argument("Invalid decimal string");
+        }
+        pos++;
+        first = false;
+        return true;
+    }
+
+    done = true;
+    skipSpace();
+
+    if (pos != end) {
+        throw std::invalid_argument("Unexpected data after the array");
+    }
+    return false;
+}
+
+} // namespace FieldDecimal
@@ -0,0 +1,64 @@
+#ifndef FIELD_DECIMAL_HPP
+#define FIELD_DECIMAL_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Decimal strings of 256-bit field elements (4 little-endian limbs, normal
+// form) and the JSON arrays of such strings used for public signals, without
+// GMP or per-element heap allocation.
+namespace FieldDecimal {
+
+// Digits of 2^256 - 1
+const size_t MAX_DIGITS = 78;
+
+// Writes the decimal digits of 'v' to 'out' (at most MAX_DIGITS, no
+// terminator) and returns their number
+size_t toDecimal(const uint64_t *v, char *out);
+
+// Parses 'len' decimal digits into 'v'. Returns false on an empty string, a
+// non-digit or a value of 2^256 or more.
+bool fromDecimal(const char *str, size_t len, uint64_t *v);
+
+// Brings 'v' below 'modulus' (both 4 limbs)
+void reduce(uint64_t *v, const uint64_t *modulus);
+
+// Appends ["<v0>","<v1>",...] to a string, one element at a time. The output
+// is the same as nlohmann::json::dump of a json the strings were pushed back
+// into, so nothing added gives null rather than [].
+class ArrayWriter
+{
+    std::string &out;
+    bool empty;
+
+public:
+    // 'count' only sizes the reservation
+    ArrayWriter(std::string &_out, size_t count);
+
+    void add(const uint64_t *v);
+
+    void close();
+};
+
+// Reads a JSON array of decimal strings element by element. Throws
+// std::invalid_argument on anything else, or on data after the array.
+class ArrayReader
+{
+    const char *pos;
+    const char *end;
+    bool first;
+    bool done;
+
+    void skipSpace();
+
+public:
+    ArrayReader(const char *str, size_t len);
+
+    // Parses the next element into 'v', returns false past the last one
+    bool next(uint64_t *v);
+};
+
+} // namespace FieldDecimal
+
+#endif // FIELD_DECIMAL_HPP
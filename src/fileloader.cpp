@@ -1,31 +1,93 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/file.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
 #include <system_error>
 #include <stdexcept>
+#include <vector>
+
+#ifdef USE_IO_URING
+#include <liburing.h>
+#endif
 
 #include "fileloader.hpp"
+#include "keccak256.h"
+#include "numa.hpp"
+#include "threadpool.hpp"
 
 namespace BinFileUtils {
 
+static const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+// Unit of work when reading or populating in parallel
+static const size_t LOAD_CHUNK_SIZE = 4 * HUGE_PAGE_SIZE;
+
+// Written after the data of a shared segment once it is completely filled
+static const char SHARED_READY[8] = {'u', 'g', 'z', 'k', 'e', 'y', '\0', '\1'};
+
+#ifdef USE_IO_URING
+// Reads kept in flight; enough to saturate an NVMe device
+static const unsigned IO_URING_QUEUE_DEPTH = 64;
+#endif
+
+// The modification and change times are taken to the nanosecond, so that a
+// file rewritten within the second it was loaded in gets another identity
+static void identityDigest(const struct stat &sb, uint8_t *digest) {
+#ifdef __APPLE__
+    const struct timespec &mtime = sb.st_mtimespec;
+    const struct timespec &ctime = sb.st_ctimespec;
+#else
+    const struct timespec &mtime = sb.st_mtim;
+    const struct timespec &ctime = sb.st_ctim;
+#endif
+    const uint64_t key[7] = {
+        (uint64_t)sb.st_dev, (uint64_t)sb.st_ino, (uint64_t)sb.st_size,
+        (uint64_t)mtime.tv_sec, (uint64_t)mtime.tv_nsec,
+        (uint64_t)ctime.tv_sec, (uint64_t)ctime.tv_nsec
+    };
+
+    FIPS202_KECCAK_256((const uint8_t *)key, sizeof(key), digest);
+}
+
 FileLoader::FileLoader()
     : fd(-1)
+    , flags(0)
+    , extraOffset(0)
+    , extraSize(0)
 {
+    memset(identity, 0, sizeof(identity));
 }
 
-FileLoader::FileLoader(const std::string& fileName)
+FileLoader::FileLoader(const std::string& fileName, unsigned int flags, const SharedSegment *shared)
     : fd(-1)
+    , flags(0)
+    , extraOffset(0)
+    , extraSize(0)
+{
+    memset(identity, 0, sizeof(identity));
+    load(fileName, flags, shared);
+}
+
+void FileLoader::fileIdentity(uint8_t *digest) const
 {
-    load(fileName);
+    memcpy(digest, identity, sizeof(identity));
 }
 
-void FileLoader::load(const std::string& fileName)
+void FileLoader::load(const std::string& fileName, unsigned int flags, const SharedSegment *shared)
 {
     if (fd != -1) {
         throw std::invalid_argument("file already loaded");
     }
 
+    if ((flags & LOAD_SHARED) && shared == nullptr) {
+        throw std::invalid_argument("LOAD_SHARED needs the SharedSegment of the file type");
+    }
+
     struct stat sb;
 
     fd = open(fileName.c_str(), O_RDONLY);
@@ -35,25 +97,494 @@ void FileLoader::load(const std::string& fileName)
 
     if (fstat(fd, &sb) == -1) {          /* To obtain file size */
         close(fd);
+        fd = -1;
         throw std::system_error(errno, std::generic_category(), "fstat");
     }
 
     size = sb.st_size;
+    addr = MAP_FAILED;
+    this->flags = flags;
+    identityDigest(sb, identity);
+
+    try {
+        if (flags & LOAD_SHARED) {
+            loadShared(fileName, *shared);
+
+        } else if (flags & (LOAD_READ | LOAD_HUGE_PAGES | LOAD_NUMA_INTERLEAVE | LOAD_NUMA_PARTITION)) {
+            allocate(flags & LOAD_HUGE_PAGES);
+
+            if (flags & (LOAD_NUMA_INTERLEAVE | LOAD_NUMA_PARTITION)) {
+                numaInterleave(addr, mapSize);
+            }
+            readAll();
+
+            // Same read-only contract as the file mapping
+            mprotect(addr, mapSize, PROT_READ);
+        } else {
+            mapFile();
+
+            if (flags & LOAD_POPULATE) {
+                populate();
+            }
+        }
+
+        if ((flags & LOAD_MLOCK) && mlock(addr, mapSize) == -1) {
+            throw std::system_error(errno, std::generic_category(), "mlock");
+        }
+
+    } catch (...) {
+        if (addr != MAP_FAILED) {
+            munmap(addr, mapSize);
+        }
+        close(fd);
+        fd = -1;
+        throw;
+    }
+}
+
+void FileLoader::mapFile()
+{
+    mapSize = size;
 
     addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
 
     if (addr == MAP_FAILED) {
-        close(fd);
         throw std::system_error(errno, std::generic_category(), "mmap failed");
     }
 
-    madvise(addr, size, MADV_SEQUENTIAL);
+    // No whole-file advice: the MSMs make several passes over the point
+    // sections, so readers set per-section hints (BinFile::adviseSection)
+}
+
+void FileLoader::allocate(bool hugePages)
+{
+    mapSize = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+#ifdef MAP_HUGETLB
+    if (hugePages) {
+        int hugeFlags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_2MB
+        hugeFlags |= MAP_HUGE_2MB;
+#endif
+        addr = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, hugeFlags, -1, 0);
+
+        if (addr != MAP_FAILED) {
+            return;
+        }
+    }
+#endif
+
+    // Over-allocate so the region can be aligned to a huge page boundary,
+    // which also keeps every read request aligned
+    const size_t rawSize = mapSize + HUGE_PAGE_SIZE;
+
+    void *raw = mmap(nullptr, rawSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (raw == MAP_FAILED) {
+        throw std::system_error(errno, std::generic_category(), "mmap failed");
+    }
+
+    const uintptr_t aligned = ((uintptr_t)raw + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+    const size_t head = aligned - (uintptr_t)raw;
+
+    if (head > 0) {
+        munmap(raw, head);
+    }
+    munmap((void *)(aligned + mapSize), rawSize - head - mapSize);
+
+    addr = (void *)aligned;
+
+#ifdef MADV_HUGEPAGE
+    // No reserved hugetlbfs pages: fall back to transparent huge pages
+    if (hugePages) {
+        madvise(addr, mapSize, MADV_HUGEPAGE);
+    }
+#endif
+}
+
+void FileLoader::readAll()
+{
+#ifdef USE_IO_URING
+    if (readWithIoUring()) {
+        return;
+    }
+#endif
+    readWithThreads();
+}
+
+void FileLoader::readWithThreads()
+{
+    const uint64_t nChunks = (size + LOAD_CHUNK_SIZE - 1) / LOAD_CHUNK_SIZE;
+    std::atomic<int> readError(0);
+
+    ThreadPool::defaultPool().parallelFor(0, nChunks, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t i = begin; i < end && readError == 0; i++) {
+            uint64_t offset = i * LOAD_CHUNK_SIZE;
+            uint64_t left = std::min<uint64_t>(LOAD_CHUNK_SIZE, size - offset);
+
+            while (left > 0) {
+                ssize_t n = pread(fd, (char *)addr + offset, left, offset);
+
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    readError = n < 0 ? errno : EIO;
+                    return;
+                }
+                offset += n;
+                left -= n;
+            }
+        }
+    });
+
+    if (readError != 0) {
+        throw std::system_error(readError, std::generic_category(), "pread");
+    }
+}
+
+#ifdef USE_IO_URING
+bool FileLoader::readWithIoUring()
+{
+    struct io_uring ring;
+
+    // Unavailable kernels and seccomp-restricted processes use the thread pool
+    if (io_uring_queue_init(IO_URING_QUEUE_DEPTH, &ring, 0) < 0) {
+        return false;
+    }
+
+    const uint64_t nChunks = (size + LOAD_CHUNK_SIZE - 1) / LOAD_CHUNK_SIZE;
+
+    // Progress of every chunk, so that short reads can be resubmitted
+    std::vector<uint64_t> offsets(nChunks);
+    std::vector<uint64_t> lefts(nChunks);
+
+    for (uint64_t i = 0; i < nChunks; i++) {
+        offsets[i] = i * LOAD_CHUNK_SIZE;
+        lefts[i] = std::min<uint64_t>(LOAD_CHUNK_SIZE, size - offsets[i]);
+    }
+
+    auto queueRead = [&] (uint64_t i) {
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+
+        io_uring_prep_read(sqe, fd, (char *)addr + offsets[i], lefts[i], offsets[i]);
+        io_uring_sqe_set_data(sqe, (void *)(uintptr_t)i);
+    };
+
+    uint64_t next = 0;
+    unsigned inFlight = 0;
+    int error = 0;
+
+    while (error == 0 && (next < nChunks || inFlight > 0)) {
+        while (next < nChunks && inFlight < IO_URING_QUEUE_DEPTH) {
+            queueRead(next++);
+            inFlight++;
+        }
+
+        int ret = io_uring_submit_and_wait(&ring, 1);
+
+        if (ret < 0 && ret != -EINTR) {
+            error = -ret;
+            break;
+        }
+
+        struct io_uring_cqe *cqe;
+        unsigned head;
+        unsigned seen = 0;
+
+        io_uring_for_each_cqe(&ring, head, cqe) {
+            const uint64_t i = (uintptr_t)io_uring_cqe_get_data(cqe);
+            const int res = cqe->res;
+
+            seen++;
+            inFlight--;
+
+            if (res == -EINTR || res == -EAGAIN) {
+                queueRead(i);
+                inFlight++;
+
+            } else if (res <= 0) {
+                if (error == 0) {
+                    error = res < 0 ? -res : EIO;
+                }
+
+            } else {
+                offsets[i] += res;
+                lefts[i] -= res;
+
+                if (lefts[i] > 0) {
+                    queueRead(i);
+                    inFlight++;
+                }
+            }
+        }
+        io_uring_cq_advance(&ring, seen);
+    }
+
+    // Reads still in flight target our buffer: reap them before it can be
+    // freed. Whatever cannot be submitted any more will never complete.
+    if (io_uring_submit(&ring) < 0) {
+        inFlight -= io_uring_sq_ready(&ring);
+    }
+
+    while (inFlight > 0) {
+        struct io_uring_cqe *cqe;
+
+        if (io_uring_wait_cqe(&ring, &cqe) < 0) {
+            break;
+        }
+        io_uring_cqe_seen(&ring, cqe);
+        inFlight--;
+    }
+
+    io_uring_queue_exit(&ring);
+
+    if (error != 0) {
+        throw std::system_error(error, std::generic_category(), "io_uring read");
+    }
+
+    return true;
+}
+#endif
+
+// 'prefix' followed by the first half of 'digest' in hex
+static std::string sharedName(const char *prefix, const uint8_t *digest) {
+    char name[64];
+
+    int len = snprintf(name, sizeof(name), "%s", prefix);
+    for (int i = 0; i < 16; i++) {
+        len += snprintf(name + len, sizeof(name) - len, "%02x", digest[i]);
+    }
+
+    return name;
+}
+
+#ifndef __ANDROID__
+// Records 'name' as the segment of the file at 'fileName', in a small segment
+// named after its path, and unlinks the segment it supersedes: one filled
+// from earlier contents of the file. Processes still attached to that one
+// keep their mapping. Best effort: a failure leaves the old segment in place.
+static void replaceSharedSegment(const std::string &fileName, const std::string &name) {
+    const size_t entrySize = 64;
+    char *real = realpath(fileName.c_str(), nullptr);
+    const std::string path = real != nullptr ? real : fileName;
+    uint8_t digest[32];
+
+    free(real);
+    FIPS202_KECCAK_256((const uint8_t *)path.data(), path.size(), digest);
+
+    const std::string indexName = sharedName("/ultragroth-path-", digest);
+    int index = shm_open(indexName.c_str(), O_RDWR | O_CREAT, 0600);
+
+    if (index == -1) {
+        return;
+    }
+
+    if (flock(index, LOCK_EX) == 0) {
+        struct stat st;
+
+        if (fstat(index, &st) == 0 && ((size_t)st.st_size == entrySize || ftruncate(index, entrySize) == 0)) {
+            char *entry = (char *)mmap(nullptr, entrySize, PROT_READ | PROT_WRITE, MAP_SHARED, index, 0);
+
+            if (entry != MAP_FAILED) {
+                const std::string previous(entry, strnlen(entry, entrySize));
+
+                if (!previous.empty() && previous != name && previous.compare(0, 12, "/ultragroth-") == 0) {
+                    shm_unlink(previous.c_str());
+                }
+
+                memset(entry, 0, entrySize);
+                memcpy(entry, name.data(), std::min(name.size(), entrySize - 1));
+                munmap(entry, entrySize);
+            }
+        }
+        flock(index, LOCK_UN);
+    }
+    close(index);
+}
+#endif
+
+void FileLoader::loadShared(const std::string &fileName, const SharedSegment &shared)
+{
+#ifdef __ANDROID__
+    throw std::runtime_error("Shared zkey memory is not supported on Android");
+#else
+    uint8_t digest[32];
+    size_t extra = 0;
+
+    // Named from a mapping of the file, dropped once the segment is attached
+    mapFile();
+
+    try {
+        shared.name(addr, size, digest);
+
+        if (shared.extraSize) {
+            extra = shared.extraSize(addr, size);
+        }
+    } catch (...) {
+        munmap(addr, mapSize);
+        addr = MAP_FAILED;
+        throw;
+    }
+
+    munmap(addr, mapSize);
+    addr = MAP_FAILED;
+
+    const std::string name = sharedName("/ultragroth-", digest);
+
+    // The derived data starts on a cache line, the ready marker follows it
+    extraOffset = (size + 63) & ~(size_t)63;
+    extraSize = extra;
+    mapSize = extraOffset + extraSize + sizeof(SHARED_READY);
+
+    int shm = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+    if (shm == -1) {
+        throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+    }
+
+    // Maps the segment if it is filled and holds the contents it is named
+    // after. A filler that died half way leaves the marker unset, a segment
+    // of another size or whose contents do not match is corrupted: both are
+    // filled again.
+    auto attach = [&] () {
+        struct stat st;
+
+        if (fstat(shm, &st) == -1) {
+            throw std::system_error(errno, std::generic_category(), "fstat " + name);
+        }
+
+        if ((size_t)st.st_size != mapSize) {
+            return false;
+        }
+
+        addr = mmap(nullptr, mapSize, PROT_READ, MAP_SHARED, shm, 0);
+
+        if (addr == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap failed");
+        }
+
+        if (memcmp((char *)addr + mapSize - sizeof(SHARED_READY), SHARED_READY, sizeof(SHARED_READY)) != 0 ||
+            !shared.verify(addr, size, digest)) {
+
+            munmap(addr, mapSize);
+            addr = MAP_FAILED;
+            return false;
+        }
+
+        return true;
+    };
+
+    // Processes attach under a shared lock, so that they check the segment
+    // at the same time; the first one fills it under an exclusive lock, and
+    // a process that finds it unusable checks again under that lock, as
+    // another one may have filled it meanwhile
+    bool attached = false;
+    bool filled = false;
+
+    for (int lock : {LOCK_SH, LOCK_EX}) {
+        if (flock(shm, lock) == -1) {
+            int error = errno;
+            close(shm);
+            throw std::system_error(error, std::generic_category(), "flock " + name);
+        }
+
+        try {
+            attached = attach();
+
+            if (!attached && lock == LOCK_EX) {
+                if (ftruncate(shm, mapSize) == -1) {
+                    throw std::system_error(errno, std::generic_category(), "ftruncate " + name);
+                }
+
+                addr = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0);
+
+                if (addr == MAP_FAILED) {
+                    throw std::system_error(errno, std::generic_category(), "mmap failed");
+                }
+
+                // Unset while the segment is being filled
+                memset((char *)addr + mapSize - sizeof(SHARED_READY), 0, sizeof(SHARED_READY));
+
+#ifdef MADV_HUGEPAGE
+                // Honoured if shmem transparent huge pages are enabled
+                if (flags & LOAD_HUGE_PAGES) {
+                    madvise(addr, mapSize, MADV_HUGEPAGE);
+                }
+#endif
+
+                // Placed once by the filler, for every process attaching later
+                if (flags & (LOAD_NUMA_INTERLEAVE | LOAD_NUMA_PARTITION)) {
+                    numaInterleave(addr, mapSize);
+                }
+
+                readAll();
+
+                if (extraSize > 0) {
+                    shared.fillExtra(addr, size, (char *)addr + extraOffset);
+                }
+
+                memcpy((char *)addr + mapSize - sizeof(SHARED_READY), SHARED_READY, sizeof(SHARED_READY));
+
+                mprotect(addr, mapSize, PROT_READ);
+                filled = true;
+            }
+
+        } catch (...) {
+            if (addr != MAP_FAILED) {
+                munmap(addr, mapSize);
+                addr = MAP_FAILED;
+            }
+            flock(shm, LOCK_UN);
+            close(shm);
+            throw;
+        }
+
+        flock(shm, LOCK_UN);
+
+        if (attached || filled) {
+            break;
+        }
+    }
+
+    close(shm);
+
+    if (filled) {
+        replaceSharedSegment(fileName, name);
+    }
+#endif
+}
+
+void FileLoader::populate()
+{
+    const uint64_t pageSize = sysconf(_SC_PAGESIZE);
+    const uint64_t nChunks = (size + LOAD_CHUNK_SIZE - 1) / LOAD_CHUNK_SIZE;
+
+    ThreadPool::defaultPool().parallelFor(0, nChunks, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        const volatile uint8_t *bytes = (const volatile uint8_t *)addr;
+        uint8_t sink = 0;
+
+        for (uint64_t offset = begin * LOAD_CHUNK_SIZE; offset < std::min<uint64_t>(end * LOAD_CHUNK_SIZE, size); offset += pageSize) {
+            sink ^= bytes[offset];
+        }
+        (void)sink;
+    });
+}
+
+void FileLoader::makeWritable()
+{
+    if (flags & LOAD_SHARED) {
+        throw std::invalid_argument("A shared memory segment can not be made writable");
+    }
+
+    if (mprotect(addr, mapSize, PROT_READ | PROT_WRITE) == -1) {
+        throw std::system_error(errno, std::generic_category(), "mprotect");
+    }
 }
 
 FileLoader::~FileLoader()
 {
     if (fd != -1) {
-        munmap(addr, size);
+        munmap(addr, mapSize);
         close(fd);
     }
 }
@@ -2,29 +2,110 @@
 #define FILELOADER_HPP
 
 #include <cstddef>
+#include <functional>
 #include <string>
 #include <cstdint>
+#include <sys/stat.h>
 
 namespace BinFileUtils {
 
+// How LOAD_SHARED names, checks and completes the segment of a file type
+struct SharedSegment {
+    // 32-byte digest of the contents of the file mapped at 'data', naming its
+    // segment; computed as cheaply as the file type allows
+    std::function<void(const void *data, size_t size, uint8_t *digest)> name;
+    // True if 'data', the file contents held in a segment, have 'digest'.
+    // Run by every process attaching to the segment.
+    std::function<bool(const void *data, size_t size, const uint8_t *digest)> verify;
+    // Bytes of data derived from the file and kept after it in the segment,
+    // and their computation into 'extra', run once by the process filling
+    // the segment; both may be left empty for none
+    std::function<size_t(const void *data, size_t size)> extraSize;
+    std::function<void(const void *data, size_t size, void *extra)> fillExtra;
+};
+
 class FileLoader
 {
 public:
+    // Load flags, combinable. The values match the PROVER_LOAD_* C API flags.
+    enum {
+        // Like LOAD_READ, into 2 MiB huge pages (hugetlbfs if pages are
+        // reserved, transparent huge pages otherwise)
+        LOAD_HUGE_PAGES = 0x1,
+        // Lock the data in RAM so that no access ever takes a major fault
+        LOAD_MLOCK      = 0x2,
+        // Fault in every page at load time, from all threads of the pool
+        LOAD_POPULATE   = 0x4,
+        // Read the file into anonymous memory with many concurrent large
+        // requests (io_uring if built with USE_IO_URING, a pool of preads
+        // otherwise) instead of demand paging a mapping
+        LOAD_READ       = 0x8,
+        // Keep the data in a POSIX shared memory segment named after a digest
+        // of the file contents (see SharedSegment): the first process fills
+        // it, later ones on the host check it and map it read-only. The
+        // segment outlives the processes, up to reboot or until a segment
+        // filled from new contents of the same file path supersedes it.
+        LOAD_SHARED     = 0x10,
+        // Spread the pages over all NUMA nodes; implies LOAD_READ unless
+        // LOAD_SHARED is set, page cache pages can not be placed
+        LOAD_NUMA_INTERLEAVE = 0x20,
+        // Like LOAD_NUMA_INTERLEAVE here; tells the prover to then split every
+        // point section over the nodes and bind its pool workers to match
+        LOAD_NUMA_PARTITION  = 0x40
+    };
+
     FileLoader();
-    FileLoader(const std::string& fileName);
+    // 'shared' is required with LOAD_SHARED, and must outlive the call
+    FileLoader(const std::string& fileName, unsigned int flags = 0, const SharedSegment *shared = nullptr);
     ~FileLoader();
 
-    void load(const std::string& fileName);
+    void load(const std::string& fileName, unsigned int flags = 0, const SharedSegment *shared = nullptr);
 
     void*  dataBuffer() { return addr; }
     size_t dataSize() const { return size; }
+    int    fileDescriptor() const { return fd; }
+    unsigned int loadFlags() const { return flags; }
 
     std::string dataAsString() { return std::string((char*)addr, size); }
 
+    // Keccak-256 of the device, inode, size and modification and change times
+    // (to the nanosecond) of the file as it was loaded: the same for every
+    // load of the file until it is rewritten or replaced, without reading its
+    // data. A rewrite that keeps all of them, e.g. one that restores the
+    // times on a filesystem with coarse timestamps, goes unnoticed.
+    void fileIdentity(uint8_t *digest) const;
+
+    // The data derived from the file in a LOAD_SHARED segment, nullptr and 0
+    // if none
+    const void *sharedExtra() const { return extraSize > 0 ? (const char *)addr + extraOffset : nullptr; }
+    size_t sharedExtraSize() const { return extraSize; }
+
+    // Allows writes to the data, which stay private to the process: the file
+    // (or the LOAD_SHARED segment, which is refused) is never modified, and
+    // with a plain mapping only the pages written to are copied
+    void makeWritable();
+
 private:
     void*   addr;
     size_t  size;
+    // Length of the mapping at addr, rounded up to its page size
+    size_t  mapSize;
     int     fd;
+    unsigned int flags;
+    uint8_t identity[32];
+    // Data derived from the file in a LOAD_SHARED segment, at addr + extraOffset
+    size_t  extraOffset;
+    size_t  extraSize;
+
+    void mapFile();
+    void loadShared(const std::string &fileName, const SharedSegment &shared);
+    void allocate(bool hugePages);
+    void readAll();
+    void readWithThreads();
+#ifdef USE_IO_URING
+    bool readWithIoUring();
+#endif
+    void populate();
 };
 
 } // Namespace
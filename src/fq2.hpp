@@ -0,0 +1,107 @@
+#ifndef FQ2_HPP
+#define FQ2_HPP
+
+#include <cstdint>
+
+#include "fq.hpp"
+
+// Raw Fq2 arithmetic and the BN254 curve constants, for the code that works
+// on zkey points directly (compression, validation) rather than through the
+// curve classes of the engine.
+
+namespace ZKeyUtils {
+
+    typedef RawFq::Element FqElement;
+
+    // Fq2 = Fq[u] / (u^2 + 1)
+    struct Fq2Element {
+        FqElement c0;
+        FqElement c1;
+    };
+
+    inline void fq2Mul(Fq2Element &r, const Fq2Element &a, const Fq2Element &b) {
+        RawFq &F = RawFq::field;
+        FqElement t0, t1, t2, t3;
+
+        F.mul(t0, a.c0, b.c0);
+        F.mul(t1, a.c1, b.c1);
+        F.add(t2, a.c0, a.c1);
+        F.add(t3, b.c0, b.c1);
+        F.mul(t2, t2, t3);
+
+        F.sub(r.c0, t0, t1);
+        F.sub(r.c1, t2, t0);
+        F.sub(r.c1, r.c1, t1);
+    }
+
+    inline void fq2Square(Fq2Element &r, const Fq2Element &a) {
+        RawFq &F = RawFq::field;
+        FqElement s, d, m;
+
+        F.add(s, a.c0, a.c1);
+        F.sub(d, a.c0, a.c1);
+        F.mul(m, a.c0, a.c1);
+
+        F.mul(r.c0, s, d);
+        F.add(r.c1, m, m);
+    }
+
+    inline void fq2Add(Fq2Element &r, const Fq2Element &a, const Fq2Element &b) {
+        RawFq::field.add(r.c0, a.c0, b.c0);
+        RawFq::field.add(r.c1, a.c1, b.c1);
+    }
+
+    inline void fq2Sub(Fq2Element &r, const Fq2Element &a, const Fq2Element &b) {
+        RawFq::field.sub(r.c0, a.c0, b.c0);
+        RawFq::field.sub(r.c1, a.c1, b.c1);
+    }
+
+    inline bool fq2Eq(const Fq2Element &a, const Fq2Element &b) {
+        return RawFq::field.eq(a.c0, b.c0) && RawFq::field.eq(a.c1, b.c1);
+    }
+
+    inline bool fq2IsZero(const Fq2Element &a) {
+        return RawFq::field.isZero(a.c0) && RawFq::field.isZero(a.c1);
+    }
+
+    // r = base^exp, exp as four little-endian 64-bit limbs
+    inline void fq2Exp(Fq2Element &r, const Fq2Element &base, const uint64_t *exp) {
+        Fq2Element acc;
+        RawFq::field.copy(acc.c0, RawFq::field.one());
+        RawFq::field.copy(acc.c1, RawFq::field.zero());
+
+        for (int i = 255; i >= 0; i--) {
+            fq2Square(acc, acc);
+            if ((exp[i / 64] >> (i % 64)) & 1) {
+                fq2Mul(acc, acc, base);
+            }
+        }
+        r = acc;
+    }
+
+    // Curve constants: y^2 = x^3 + 3 on G1, y^2 = x^3 + 3 / (9 + u) on G2
+    struct CurveConstants {
+        FqElement b1;
+        Fq2Element b2;
+
+        CurveConstants() {
+            RawFq &F = RawFq::field;
+
+            // 3 / (9 + u) = 3 * (9 - u) / 82
+            FqElement inv82;
+            F.inv(inv82, F.set(82));
+
+            F.copy(b1, F.set(3));
+            F.mul(b2.c0, F.set(27), inv82);
+            F.mul(b2.c1, F.set(3), inv82);
+            F.neg(b2.c1, b2.c1);
+        }
+    };
+
+    inline const CurveConstants &curveConstants() {
+        static const CurveConstants c;
+        return c;
+    }
+}
+
+#endif // FQ2_HPP
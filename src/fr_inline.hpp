@@ -0,0 +1,257 @@
+#ifndef FR_INLINE_HPP
+#define FR_INLINE_HPP
+
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "fr.hpp"
+
+// Header-only 4x64 Montgomery arithmetic with the modulus fixed at compile time.
+//
+// RawFr routes every operation through the out-of-line nasm/arm64 objects, which
+// is right for isolated calls but keeps the compiler from inlining, keeping
+// operands in registers across operations or vectorizing the surrounding loop.
+// The hot prover loops (coefficient evaluation, coset shifts, H combination)
+// use this class instead; the results are bit-identical to RawFr.
+//
+// Operations are templated on the element type so they work directly on
+// RawFr::Element (or anything else exposing uint64_t v[4]).
+template <uint64_t Q0, uint64_t Q1, uint64_t Q2, uint64_t Q3, uint64_t NP>
+class MontgomeryField {
+
+    typedef unsigned __int128 uint128_t;
+
+    static inline uint64_t addCarry(uint64_t a, uint64_t b, uint8_t &carry) {
+#if defined(__x86_64__)
+        unsigned long long r;
+        carry = _addcarry_u64(carry, a, b, &r);
+        return r;
+#else
+        uint128_t r = (uint128_t)a + b + carry;
+        carry = (uint8_t)(r >> 64);
+        return (uint64_t)r;
+#endif
+    }
+
+    static inline uint64_t subBorrow(uint64_t a, uint64_t b, uint8_t &borrow) {
+#if defined(__x86_64__)
+        unsigned long long r;
+        borrow = _subborrow_u64(borrow, a, b, &r);
+        return r;
+#else
+        uint128_t r = (uint128_t)a - b - borrow;
+        borrow = (uint8_t)(r >> 127);
+        return (uint64_t)r;
+#endif
+    }
+
+    // r = t - q if t >= q, otherwise t (branchless)
+    static inline void reduceOnce(uint64_t *r, const uint64_t *t, uint64_t carryIn = 0) {
+        uint8_t borrow = 0;
+        uint64_t s0 = subBorrow(t[0], Q0, borrow);
+        uint64_t s1 = subBorrow(t[1], Q1, borrow);
+        uint64_t s2 = subBorrow(t[2], Q2, borrow);
+        uint64_t s3 = subBorrow(t[3], Q3, borrow);
+        subBorrow(carryIn, 0, borrow);
+
+        const uint64_t keep = 0 - (uint64_t)borrow;
+
+        r[0] = (t[0] & keep) | (s0 & ~keep);
+        r[1] = (t[1] & keep) | (s1 & ~keep);
+        r[2] = (t[2] & keep) | (s2 & ~keep);
+        r[3] = (t[3] & keep) | (s3 & ~keep);
+    }
+
+    // One CIOS round: t = (t + a * bi + m * q) / 2^64
+    static inline void mulRound(uint64_t *t, const uint64_t *a, uint64_t bi) {
+        uint128_t acc;
+        uint64_t carry;
+
+        acc = (uint128_t)a[0] * bi + t[0];
+        uint64_t t0 = (uint64_t)acc; carry = (uint64_t)(acc >> 64);
+        acc = (uint128_t)a[1] * bi + t[1] + carry;
+        uint64_t t1 = (uint64_t)acc; carry = (uint64_t)(acc >> 64);
+        acc = (uint128_t)a[2] * bi + t[2] + carry;
+        uint64_t t2 = (uint64_t)acc; carry = (uint64_t)(acc >> 64);
+        acc = (uint128_t)a[3] * bi + t[3] + carry;
+        uint64_t t3 = (uint64_t)acc;
+        uint64_t t4 = (uint64_t)(acc >> 64) + t[4];
+
+        const uint64_t m = t0 * NP;
+
+        acc = (uint128_t)m * Q0 + t0;
+        carry = (uint64_t)(acc >> 64);
+        acc = (uint128_t)m * Q1 + t1 + carry;
+        t[0] = (uint64_t)acc; carry = (uint64_t)(acc >> 64);
+        acc = (uint128_t)m * Q2 + t2 + carry;
+        t[1] = (uint64_t)acc; carry = (uint64_t)(acc >> 64);
+        acc = (uint128_t)m * Q3 + t3 + carry;
+        t[2] = (uint64_t)acc; carry = (uint64_t)(acc >> 64);
+        acc = (uint128_t)t4 + carry;
+        t[3] = (uint64_t)acc;
+        t[4] = (uint64_t)(acc >> 64);
+    }
+
+    template <typename Element>
+    static inline void subTwoQ(Element &r, const Element &a) {
+        uint8_t borrow = 0;
+        uint64_t s0 = subBorrow(a.v[0], Q2_0, borrow);
+        uint64_t s1 = subBorrow(a.v[1], Q2_1, borrow);
+        uint64_t s2 = subBorrow(a.v[2], Q2_2, borrow);
+        uint64_t s3 = subBorrow(a.v[3], Q2_3, borrow);
+
+        const uint64_t keep = 0 - (uint64_t)borrow;
+
+        r.v[0] = (a.v[0] & keep) | (s0 & ~keep);
+        r.v[1] = (a.v[1] & keep) | (s1 & ~keep);
+        r.v[2] = (a.v[2] & keep) | (s2 & ~keep);
+        r.v[3] = (a.v[3] & keep) | (s3 & ~keep);
+    }
+
+public:
+    static const uint64_t q[4];
+
+    // 2q, the bound of the redundant representation used by the lazy ops
+    static const uint64_t Q2_0 = Q0 << 1;
+    static const uint64_t Q2_1 = (Q1 << 1) | (Q0 >> 63);
+    static const uint64_t Q2_2 = (Q2 << 1) | (Q1 >> 63);
+    static const uint64_t Q2_3 = (Q3 << 1) | (Q2 >> 63);
+
+    template <typename Element>
+    static inline void add(Element &r, const Element &a, const Element &b) {
+        uint8_t carry = 0;
+        uint64_t t[4];
+        t[0] = addCarry(a.v[0], b.v[0], carry);
+        t[1] = addCarry(a.v[1], b.v[1], carry);
+        t[2] = addCarry(a.v[2], b.v[2], carry);
+        t[3] = addCarry(a.v[3], b.v[3], carry);
+        reduceOnce(r.v, t, carry);
+    }
+
+    template <typename Element>
+    static inline void sub(Element &r, const Element &a, const Element &b) {
+        uint8_t borrow = 0;
+        uint64_t t0 = subBorrow(a.v[0], b.v[0], borrow);
+        uint64_t t1 = subBorrow(a.v[1], b.v[1], borrow);
+        uint64_t t2 = subBorrow(a.v[2], b.v[2], borrow);
+        uint64_t t3 = subBorrow(a.v[3], b.v[3], borrow);
+
+        const uint64_t mask = 0 - (uint64_t)borrow;
+
+        uint8_t carry = 0;
+        r.v[0] = addCarry(t0, Q0 & mask, carry);
+        r.v[1] = addCarry(t1, Q1 & mask, carry);
+        r.v[2] = addCarry(t2, Q2 & mask, carry);
+        r.v[3] = addCarry(t3, Q3 & mask, carry);
+    }
+
+    template <typename Element>
+    static inline void mul(Element &r, const Element &a, const Element &b) {
+        uint64_t t[5] = {0, 0, 0, 0, 0};
+
+        mulRound(t, a.v, b.v[0]);
+        mulRound(t, a.v, b.v[1]);
+        mulRound(t, a.v, b.v[2]);
+        mulRound(t, a.v, b.v[3]);
+
+        reduceOnce(r.v, t, t[4]);
+    }
+
+    template <typename Element>
+    static inline void square(Element &r, const Element &a) {
+        mul(r, a, a);
+    }
+
+    // Lazy variants for the FFT butterflies (Harvey). They require 4q < 2^256
+    // and work on values in [0, 4q) that are not fully reduced.
+
+    // a in [0, 4q), b in [0, q) -> r in [0, 2q). Requires q < 2^256 / 4 as well,
+    // so that a * b / 2^256 + q stays below 2q.
+    template <typename Element>
+    static inline void mulLazy(Element &r, const Element &a, const Element &b) {
+        uint64_t t[5] = {0, 0, 0, 0, 0};
+
+        mulRound(t, a.v, b.v[0]);
+        mulRound(t, a.v, b.v[1]);
+        mulRound(t, a.v, b.v[2]);
+        mulRound(t, a.v, b.v[3]);
+
+        r.v[0] = t[0];
+        r.v[1] = t[1];
+        r.v[2] = t[2];
+        r.v[3] = t[3];
+    }
+
+    // a, b in [0, 2q) -> r = a + b in [0, 4q)
+    template <typename Element>
+    static inline void addLazy(Element &r, const Element &a, const Element &b) {
+        uint8_t carry = 0;
+        r.v[0] = addCarry(a.v[0], b.v[0], carry);
+        r.v[1] = addCarry(a.v[1], b.v[1], carry);
+        r.v[2] = addCarry(a.v[2], b.v[2], carry);
+        r.v[3] = addCarry(a.v[3], b.v[3], carry);
+    }
+
+    // a, b in [0, 2q) -> r = a - b + 2q in [0, 4q)
+    template <typename Element>
+    static inline void subLazy(Element &r, const Element &a, const Element &b) {
+        uint8_t carry = 0;
+        uint64_t t0 = addCarry(a.v[0], Q2_0, carry);
+        uint64_t t1 = addCarry(a.v[1], Q2_1, carry);
+        uint64_t t2 = addCarry(a.v[2], Q2_2, carry);
+        uint64_t t3 = addCarry(a.v[3], Q2_3, carry);
+
+        uint8_t borrow = 0;
+        r.v[0] = subBorrow(t0, b.v[0], borrow);
+        r.v[1] = subBorrow(t1, b.v[1], borrow);
+        r.v[2] = subBorrow(t2, b.v[2], borrow);
+        r.v[3] = subBorrow(t3, b.v[3], borrow);
+    }
+
+    // [0, 4q) -> [0, 2q)
+    template <typename Element>
+    static inline void reduceLazy(Element &r, const Element &a) {
+        subTwoQ(r, a);
+    }
+
+    // [0, 4q) -> [0, q)
+    template <typename Element>
+    static inline void reduceFull(Element &r, const Element &a) {
+        subTwoQ(r, a);
+        reduceOnce(r.v, r.v);
+    }
+
+    // a * b + c, the shape of the coefficient accumulation
+    template <typename Element>
+    static inline void mulAdd(Element &r, const Element &a, const Element &b, const Element &c) {
+        Element t;
+        mul(t, a, b);
+        add(r, t, c);
+    }
+};
+
+template <uint64_t Q0, uint64_t Q1, uint64_t Q2, uint64_t Q3, uint64_t NP>
+const uint64_t MontgomeryField<Q0, Q1, Q2, Q3, NP>::q[4] = {Q0, Q1, Q2, Q3};
+
+// BN254 scalar field, same constants as build/fr_raw_generic.cpp
+typedef MontgomeryField<
+    0x43e1f593f0000001ULL,
+    0x2833e84879b97091ULL,
+    0xb85045b68181585dULL,
+    0x30644e72e131a029ULL,
+    0xc2e1f593efffffffULL
+> FrInline;
+
+// Maps a field class to its inline implementation
+template <typename Field>
+struct InlineField;
+
+template <>
+struct InlineField<RawFr> {
+    typedef FrInline type;
+};
+
+#endif // FR_INLINE_HPP
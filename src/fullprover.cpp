@@ -92,6 +92,7 @@ void FullProver::checkPending() {
             pendingCircuit = "";
             errString = "";
             canceled = false;
+            control.reset();
             proof = nlohmann::detail::value_t::null;
             std::thread th(&FullProver::thread_calculateProve, this);
             th.detach();
@@ -152,7 +153,7 @@ void FullProver::thread_calculateProve() {
         }
         
         if (!isCanceled()) {
-            proof = provers[circuit]->prove(wtnsData)->toJson();
+            proof = provers[circuit]->prove(wtnsData, &control)->toJson();
         } else {
             LOG_TRACE("AVOIDING prove");
             proof = {};
@@ -209,6 +210,7 @@ void FullProver::abort() {
         return;
     }
     canceled = true;
+    control.cancel();
     LOG_TRACE("FullProver::abort end -> canceled=true");
 }
 
@@ -8,6 +8,7 @@ using json = nlohmann::json;
 #include <cstdint>
 #include "alt_bn128.hpp"
 #include "groth16.hpp"
+#include "prove_control.hpp"
 #include "binfile_utils.hpp"
 #include "zkey_utils.hpp"
 
@@ -32,6 +33,8 @@ class FullProver {
     std::string errString;
 
     bool canceled;
+    // Stops the running proof on abort
+    ProveControl control;
 
     bool isCanceled();
     void calcFinished();
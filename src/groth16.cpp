@@ -1,8 +1,11 @@
 #include "random_generator.hpp"
 #include "misc.hpp"
+#include "msm_montgomery.hpp"
 #include <sstream>
 #include <vector>
 #include <mutex>
+#include <algorithm>
+#include <cstring>
 
 namespace Groth16 {
 
@@ -46,26 +49,155 @@ std::unique_ptr<Prover<Engine>> makeProver(
 }
 
 template <typename Engine>
-std::unique_ptr<Proof<Engine>> Prover<Engine>::prove(typename Engine::FrElement *wtns) {
+template <typename Curve>
+void Prover<Engine>::msm_wtns(
+    Curve &g,
+    typename Curve::Point &r,
+    typename Curve::PointAffine *bases,
+    const typename Engine::FrElement *scalars,
+    uint64_t n
+) {
+    // ffiasm's MSM can not be stopped part way
+    if (pool == nullptr && control == nullptr) {
+        g.multiMulByScalarMSM(r, bases, (uint8_t *)scalars, sizeof(scalars[0]), n);
+        return;
+    }
 
-    ThreadPool &threadPool = ThreadPool::defaultPool();
+    MSMMontgomery<Curve, typename Engine::Fr> msm(g, E.fr, false, control);
+    msm.run(r, bases, scalars, n, thread_pool());
+}
 
-    uint32_t sW = sizeof(wtns[0]);
-    typename Engine::G1Point pi_a;
-    E.g1.multiMulByScalarMSM(pi_a, pointsA, (uint8_t *)wtns, sW, nVars);
+template <typename Engine>
+template <typename Curve>
+void Prover<Engine>::msm_batch(
+    Curve &g,
+    std::vector<typename Curve::Point> &r,
+    typename Curve::PointAffine *bases,
+    const std::vector<typename Engine::FrElement *> &scalars,
+    uint64_t offset,
+    uint64_t n
+) {
+    check_cancelled();
 
-    typename Engine::G1Point pib1;
-    E.g1.multiMulByScalarMSM(pib1, pointsB1, (uint8_t *)wtns, sW, nVars);
+    if (scalars.size() == 1) {
+        r.resize(1);
+        msm_wtns(g, r[0], bases, scalars[0] + offset, n);
+        return;
+    }
 
-    typename Engine::G2Point pi_b;
-    E.g2.multiMulByScalarMSM(pi_b, pointsB2, (uint8_t *)wtns, sW, nVars);
+    std::vector<const typename Engine::FrElement *> batch;
 
-    typename Engine::G1Point pi_c;
-    E.g1.multiMulByScalarMSM(pi_c, pointsC, (uint8_t *)((uint64_t)wtns + (nPublic +1)*sW), sW, nVars-nPublic-1);
+    for (auto wtns : scalars) {
+        batch.push_back(wtns + offset);
+    }
+
+    MSMMontgomery<Curve, typename Engine::Fr> msm(g, E.fr, false, control);
+    msm.runBatch(r, bases, batch, n, thread_pool());
+}
+
+template <typename Engine>
+bool Prover<Engine>::diff_base(
+    const typename Engine::FrElement *wtns,
+    std::vector<uint32_t> &indexes,
+    std::vector<typename Engine::FrElement> &deltas
+) {
+    ThreadPool &threadPool = thread_pool();
+    const typename Engine::FrElement *baseWtns = base->wtns.data();
+
+    // Fixed chunks, so that appending them in order keeps the indexes ascending
+    const uint64_t nChunks = threadPool.getThreadCount();
+    const uint64_t chunkSize = (nVars + nChunks - 1) / nChunks;
+    std::vector<std::vector<uint32_t>> changed(nChunks);
+
+    threadPool.parallelFor(0, nChunks, [&](int64_t begin, int64_t end, uint64_t) {
+        for (int64_t k = begin; k < end; k++) {
+            const uint64_t last = std::min<uint64_t>(nVars, (k + 1) * chunkSize);
+
+            for (uint64_t i = k * chunkSize; i < last; i++) {
+                if (std::memcmp(&wtns[i], &baseWtns[i], sizeof(wtns[i])) != 0) {
+                    changed[k].push_back(i);
+                }
+            }
+        }
+    });
+
+    size_t count = 0;
+
+    for (const auto &c : changed) {
+        count += c.size();
+    }
+
+    // Past that the delta MSMs gain little over full ones
+    if (count > nVars / 2) {
+        return false;
+    }
+
+    indexes.reserve(count);
+
+    for (const auto &c : changed) {
+        indexes.insert(indexes.end(), c.begin(), c.end());
+    }
+
+    // Modular subtraction, the same in normal form as in Montgomery form
+    deltas.resize(count);
+
+    for (size_t j = 0; j < count; j++) {
+        FrOps::sub(deltas[j], wtns[indexes[j]], baseWtns[indexes[j]]);
+    }
+
+    return true;
+}
+
+template <typename Engine>
+template <typename Curve>
+void Prover<Engine>::msm_delta(
+    Curve &g,
+    typename Curve::Point &r,
+    typename Curve::Point &from,
+    typename Curve::PointAffine *bases,
+    const std::vector<uint32_t> &indexes,
+    const std::vector<typename Engine::FrElement> &deltas,
+    uint32_t first
+) {
+    const size_t start = std::lower_bound(indexes.begin(), indexes.end(), first) - indexes.begin();
+    const size_t n = indexes.size() - start;
+
+    if (n == 0) {
+        g.copy(r, from);
+        return;
+    }
+
+    // Gathered, as the MSM takes contiguous bases
+    std::vector<typename Curve::PointAffine> points(n);
 
-    auto a = new typename Engine::FrElement[domainSize];
-    auto b = new typename Engine::FrElement[domainSize];
-    auto c = new typename Engine::FrElement[domainSize];
+    for (size_t j = 0; j < n; j++) {
+        g.copy(points[j], bases[indexes[start + j] - first]);
+    }
+
+    msm_wtns(g, r, points.data(), deltas.data() + start, n);
+    g.add(r, r, from);
+}
+
+template <typename Engine>
+void Prover<Engine>::compute_h(
+    typename Engine::G1Point &pih,
+    typename Engine::FrElement *wtns,
+    typename Engine::FrElement *scratch
+) {
+    ThreadPool &threadPool = thread_pool();
+
+    // Without scratch b and c are freed before the MSM, as it needs memory too
+    std::unique_ptr<typename Engine::FrElement[]> ownedA, ownedB, ownedC;
+
+    if (scratch == nullptr) {
+        ownedA.reset(new typename Engine::FrElement[domainSize]);
+        ownedB.reset(new typename Engine::FrElement[domainSize]);
+        ownedC.reset(new typename Engine::FrElement[domainSize]);
+    }
+
+    auto a = scratch ? scratch : ownedA.get();
+    auto b = scratch ? scratch + domainSize : ownedB.get();
+    auto c = scratch ? scratch + 2 * (uint64_t)domainSize : ownedC.get();
 
     threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
         for (uint32_t i=begin; i<end; i++) {
@@ -82,7 +214,11 @@ std::unique_ptr<Proof<Engine>> Prover<Engine>::prove(typename Engine::FrElement
             typename Engine::FrElement *ab = (coefs[i].m == 0) ? a : b;
             typename Engine::FrElement aux;
 
-            E.fr.mul(
+            if ((i & (ProveControl::POLL_INTERVAL - 1)) == 0 && cancelled()) {
+                return;
+            }
+
+            FrOps::mul(
                 aux,
                 wtns[coefs[i].s],
                 coefs[i].coef
@@ -90,16 +226,19 @@ std::unique_ptr<Proof<Engine>> Prover<Engine>::prove(typename Engine::FrElement
 
             std::lock_guard<std::mutex> guard(locks[coefs[i].c % NLOCKS]);
 
-            E.fr.add(
+            FrOps::add(
                 ab[coefs[i].c],
                 ab[coefs[i].c],
                 aux
             );
         }
     });
+
+    check_cancelled();
+
     threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
         for (uint64_t i=begin; i<end; i++) {
-            E.fr.mul(
+            FrOps::mul(
                 c[i],
                 a[i],
                 b[i]
@@ -107,54 +246,37 @@ std::unique_ptr<Proof<Engine>> Prover<Engine>::prove(typename Engine::FrElement
         }
     });
 
-    uint32_t domainPower = fft->log2(domainSize);
-
-    fft->ifft(a, domainSize);
+    fft->cosetTransform(a, domainSize, threadPool);
+    check_cancelled();
+    fft->cosetTransform(b, domainSize, threadPool);
+    check_cancelled();
+    fft->cosetTransform(c, domainSize, threadPool);
 
     threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
         for (uint64_t i=begin; i<end; i++) {
-            E.fr.mul(a[i], a[i], fft->root(domainPower+1, i));
+            FrOps::mul(a[i], a[i], b[i]);
+            FrOps::sub(a[i], a[i], c[i]);
         }
     });
 
-    fft->fft(a, domainSize);
-
-    fft->ifft(b, domainSize);
+    ownedB.reset();
+    ownedC.reset();
 
-    threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
-        for (uint64_t i=begin; i<end; i++) {
-            E.fr.mul(b[i], b[i], fft->root(domainPower+1, i));
-        }
-    });
+    check_cancelled();
 
-    fft->fft(b, domainSize);
-
-    fft->ifft(c, domainSize);
-
-    threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
-        for (uint64_t i=begin; i<end; i++) {
-            E.fr.mul(c[i], c[i], fft->root(domainPower+1, i));
-        }
-    });
-
-    fft->fft(c, domainSize);
-
-    threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
-        for (uint64_t i=begin; i<end; i++) {
-            E.fr.mul(a[i], a[i], b[i]);
-            E.fr.sub(a[i], a[i], c[i]);
-            E.fr.fromMontgomery(a[i], a[i]);
-        }
-    });
-
-    delete [] b;
-    delete [] c;
-
-    typename Engine::G1Point pih;
-    E.g1.multiMulByScalarMSM(pih, pointsH, (uint8_t *)a, sizeof(a[0]), domainSize);
-
-    delete [] a;
+    // a is left in Montgomery form, the MSM converts each scalar on the fly
+    MSMMontgomery<typename Engine::G1, typename Engine::Fr> msmH(E.g1, E.fr, true, control);
+    msmH.run(pih, pointsH, a, domainSize, threadPool);
+}
 
+template <typename Engine>
+std::unique_ptr<Proof<Engine>> Prover<Engine>::finalize(
+    typename Engine::G1Point &pi_a,
+    typename Engine::G1Point &pib1,
+    typename Engine::G2Point &pi_b,
+    typename Engine::G1Point &pi_c,
+    typename Engine::G1Point &pih
+) {
     typename Engine::FrElement r;
     typename Engine::FrElement s;
     typename Engine::FrElement rs;
@@ -202,6 +324,168 @@ std::unique_ptr<Proof<Engine>> Prover<Engine>::prove(typename Engine::FrElement
     return std::unique_ptr<Proof<Engine>>(p);
 }
 
+template <typename Engine>
+std::unique_ptr<Proof<Engine>> Prover<Engine>::prove(typename Engine::FrElement *wtns, ProveControl *control) {
+
+    start_control(control);
+
+    std::vector<uint32_t> indexes;
+    std::vector<typename Engine::FrElement> deltas;
+
+    // With a base witness that is close enough, MSMs over the changes only
+    const bool delta = base && diff_base(wtns, indexes, deltas);
+
+    typename Engine::G1Point pi_a;
+    if (delta) {
+        msm_delta(E.g1, pi_a, base->pi_a, pointsA, indexes, deltas, 0);
+    } else {
+        msm_wtns(E.g1, pi_a, pointsA, wtns, nVars);
+    }
+    stage_done("msm_a");
+
+    typename Engine::G1Point pib1;
+    if (delta) {
+        msm_delta(E.g1, pib1, base->pib1, pointsB1, indexes, deltas, 0);
+    } else {
+        msm_wtns(E.g1, pib1, pointsB1, wtns, nVars);
+    }
+    stage_done("msm_b1");
+
+    typename Engine::G2Point pi_b;
+    if (delta) {
+        msm_delta(E.g2, pi_b, base->pi_b, pointsB2, indexes, deltas, 0);
+    } else {
+        msm_wtns(E.g2, pi_b, pointsB2, wtns, nVars);
+    }
+    stage_done("msm_b2");
+
+    typename Engine::G1Point pi_c;
+    if (delta) {
+        msm_delta(E.g1, pi_c, base->pi_c, pointsC, indexes, deltas, nPublic + 1);
+    } else {
+        msm_wtns(E.g1, pi_c, pointsC, wtns + nPublic + 1, nVars-nPublic-1);
+    }
+    stage_done("msm_c");
+
+    typename Engine::G1Point pih;
+    compute_h(pih, wtns, nullptr);
+    stage_done("h");
+
+    return finalize(pi_a, pib1, pi_b, pi_c, pih);
+}
+
+template <typename Engine>
+std::unique_ptr<Proof<Engine>> Prover<Engine>::rerandomize(const Proof<Engine> &proof) {
+    typename Engine::FrElement r1;
+    typename Engine::FrElement r2;
+    typename Engine::FrElement r1inv;
+    typename Engine::FrElement r1r2;
+
+    // Normal form scalars below 2^248, as in finalize; r1 must be invertible
+    do {
+        E.fr.copy(r1, E.fr.zero());
+        randombytes_buf((void *)&(r1.v[0]), sizeof(r1)-1);
+    } while (E.fr.isZero(r1));
+
+    E.fr.copy(r2, E.fr.zero());
+    randombytes_buf((void *)&(r2.v[0]), sizeof(r2)-1);
+
+    // 1/r1 through Montgomery form: r1*R, then R/r1, then 1/r1
+    E.fr.toMontgomery(r1inv, r1);
+    E.fr.inv(r1inv, r1inv);
+    E.fr.fromMontgomery(r1inv, r1inv);
+
+    E.fr.mul(r1r2, r1, r2);
+    E.fr.toMontgomery(r1r2, r1r2);
+
+    typename Engine::G1PointAffine A = proof.A;
+    typename Engine::G2PointAffine B = proof.B;
+    typename Engine::G1PointAffine C = proof.C;
+
+    typename Engine::G1Point pi_a;
+    typename Engine::G2Point pi_b;
+    typename Engine::G1Point pi_c;
+    typename Engine::G2Point p2;
+
+    E.g1.mulByScalar(pi_a, A, (uint8_t *)&r1inv, sizeof(r1inv));
+
+    E.g2.mulByScalar(pi_b, B, (uint8_t *)&r1, sizeof(r1));
+    E.g2.mulByScalar(p2, vk_delta2, (uint8_t *)&r1r2, sizeof(r1r2));
+    E.g2.add(pi_b, pi_b, p2);
+
+    E.g1.mulByScalar(pi_c, A, (uint8_t *)&r2, sizeof(r2));
+    E.g1.add(pi_c, pi_c, C);
+
+    Proof<Engine> *p = new Proof<Engine>(Engine::engine);
+    E.g1.copy(p->A, pi_a);
+    E.g2.copy(p->B, pi_b);
+    E.g1.copy(p->C, pi_c);
+
+    return std::unique_ptr<Proof<Engine>>(p);
+}
+
+template <typename Engine>
+void Prover<Engine>::set_base_witness(const typename Engine::FrElement *wtns) {
+
+    if (wtns == nullptr) {
+        base.reset();
+        return;
+    }
+
+    // Not under the control of the last proof, which may be gone
+    start_control(nullptr);
+
+    std::unique_ptr<BaseWitness> b(new BaseWitness);
+
+    b->wtns.assign(wtns, wtns + nVars);
+
+    msm_wtns(E.g1, b->pi_a, pointsA, wtns, nVars);
+    msm_wtns(E.g1, b->pib1, pointsB1, wtns, nVars);
+    msm_wtns(E.g2, b->pi_b, pointsB2, wtns, nVars);
+    msm_wtns(E.g1, b->pi_c, pointsC, wtns + nPublic + 1, nVars-nPublic-1);
+
+    base = std::move(b);
+}
+
+template <typename Engine>
+std::vector<std::unique_ptr<Proof<Engine>>> Prover<Engine>::prove_batch(
+    const std::vector<typename Engine::FrElement *> &wtns,
+    ProveControl *control
+) {
+    const size_t n = wtns.size();
+
+    start_control(control);
+
+    std::vector<typename Engine::G1Point> pi_a, pib1, pi_c, pih(n);
+    std::vector<typename Engine::G2Point> pi_b;
+
+    msm_batch(E.g1, pi_a, pointsA, wtns, 0, nVars);
+    stage_done("msm_a");
+    msm_batch(E.g1, pib1, pointsB1, wtns, 0, nVars);
+    stage_done("msm_b1");
+    msm_batch(E.g2, pi_b, pointsB2, wtns, 0, nVars);
+    stage_done("msm_b2");
+    msm_batch(E.g1, pi_c, pointsC, wtns, nPublic + 1, nVars - nPublic - 1);
+    stage_done("msm_c");
+
+    std::unique_ptr<typename Engine::FrElement[]> scratch(new typename Engine::FrElement[3 * (uint64_t)domainSize]);
+
+    for (size_t k = 0; k < n; k++) {
+        compute_h(pih[k], wtns[k], scratch.get());
+    }
+
+    scratch.reset();
+    stage_done("h");
+
+    std::vector<std::unique_ptr<Proof<Engine>>> proofs;
+
+    for (size_t k = 0; k < n; k++) {
+        proofs.push_back(finalize(pi_a[k], pib1[k], pi_b[k], pi_c[k], pih[k]));
+    }
+
+    return proofs;
+}
+
 template <typename Engine>
 std::string Proof<Engine>::toJsonStr() {
 
@@ -214,6 +498,19 @@ std::string Proof<Engine>::toJsonStr() {
     return ss.str();
 }
 
+template <typename Engine>
+void Proof<Engine>::toEvm(uint8_t *out) {
+
+    montgomeryToBytesBE(E.f1, A.x, out + 0);
+    montgomeryToBytesBE(E.f1, A.y, out + 32);
+    montgomeryToBytesBE(E.f1, B.x.b, out + 64);
+    montgomeryToBytesBE(E.f1, B.x.a, out + 96);
+    montgomeryToBytesBE(E.f1, B.y.b, out + 128);
+    montgomeryToBytesBE(E.f1, B.y.a, out + 160);
+    montgomeryToBytesBE(E.f1, C.x, out + 192);
+    montgomeryToBytesBE(E.f1, C.y, out + 224);
+}
+
 template <typename Engine>
 json Proof<Engine>::toJson() {
 
@@ -3,11 +3,16 @@
 
 #include <string>
 #include <array>
+#include <vector>
+#include <memory>
 #include <nlohmann/json.hpp>
 #include <cstdint>
 using json = nlohmann::json;
 
-#include "fft.hpp"
+#include "fft_lazy.hpp"
+#include "fr_inline.hpp"
+#include "prove_control.hpp"
+#include "field_bytes.hpp"
 
 namespace Groth16 {
 
@@ -22,6 +27,11 @@ namespace Groth16 {
         Proof(Engine &_E) : E(_E) { }
         std::string toJsonStr();
         json toJson();
+
+        // pi_a, pi_b, pi_c as 32-byte big-endian coordinates, G2 with the
+        // imaginary part first: the calldata layout of EVM verifiers
+        static const size_t EVM_SIZE = 256;
+        void toEvm(uint8_t *out);
         void fromJson(const json& proof);
     };
 
@@ -52,6 +62,9 @@ namespace Groth16 {
     template <typename Engine>
     class Prover {
 
+        // Inlined field ops for the per-element loops, E.fr elsewhere
+        typedef typename InlineField<typename Engine::Fr>::type FrOps;
+
         Engine &E;
         uint32_t nVars;
         uint32_t nPublic;
@@ -69,7 +82,75 @@ namespace Groth16 {
         typename Engine::G1PointAffine *pointsC;
         typename Engine::G1PointAffine *pointsH;
 
-        FFT<typename Engine::Fr> *fft;
+        LazyFFT<typename Engine::Fr> *fft;
+
+        // Pool the proofs run on, null for the default pool
+        ThreadPool *pool;
+
+        ThreadPool &thread_pool() const { return pool != nullptr ? *pool : ThreadPool::defaultPool(); }
+
+        // MSM of normal form scalars: ffiasm's, which always runs on the
+        // default pool and can not be cancelled, or MSMMontgomery on a
+        // dedicated pool or under a control
+        template <typename Curve>
+        void msm_wtns(Curve &g, typename Curve::Point &r, typename Curve::PointAffine *bases,
+                      const typename Engine::FrElement *scalars, uint64_t n);
+
+        // Control of the proof in progress, may be null
+        ProveControl *control;
+        unsigned int stagesDone;
+
+        // A, B1, B2, C and H
+        static const unsigned int PROVE_STAGES = 5;
+
+        void start_control(ProveControl *_control) { control = _control; stagesDone = 0; }
+
+        // For the parallel loops, which stop early and leave the throwing to
+        // check_cancelled on the calling thread
+        bool cancelled() const { return control != nullptr && control->isCancelled(); }
+        void check_cancelled() const { if (control != nullptr) control->check(); }
+        void stage_done(const char *stage) { if (control != nullptr) control->stageDone(stage, ++stagesDone, PROVE_STAGES); }
+
+        // MSMs of one point section for every witness of a batch, in a single
+        // pass over the points
+        template <typename Curve>
+        void msm_batch(Curve &g, std::vector<typename Curve::Point> &r, typename Curve::PointAffine *bases,
+                       const std::vector<typename Engine::FrElement *> &scalars, uint64_t offset, uint64_t n);
+
+        // Commits to h; scratch holds 3 domain-sized arrays, or is null to allocate them
+        void compute_h(typename Engine::G1Point &pih, typename Engine::FrElement *wtns, typename Engine::FrElement *scratch);
+
+        // Copy of a base witness and its unblinded A, B1, B2 and C MSMs
+        struct BaseWitness {
+            std::vector<typename Engine::FrElement> wtns;
+            typename Engine::G1Point pi_a;
+            typename Engine::G1Point pib1;
+            typename Engine::G2Point pi_b;
+            typename Engine::G1Point pi_c;
+        };
+        std::unique_ptr<BaseWitness> base;
+
+        // Signals where 'wtns' differs from the base witness, ascending, and
+        // for each the new value minus the base one. Returns false, leaving
+        // them unset, when more than half of the signals differ.
+        bool diff_base(const typename Engine::FrElement *wtns, std::vector<uint32_t> &indexes,
+                       std::vector<typename Engine::FrElement> &deltas);
+
+        // r = from + MSM of the deltas of the signals from 'first' on, whose
+        // bases start at 'bases'
+        template <typename Curve>
+        void msm_delta(Curve &g, typename Curve::Point &r, typename Curve::Point &from,
+                       typename Curve::PointAffine *bases, const std::vector<uint32_t> &indexes,
+                       const std::vector<typename Engine::FrElement> &deltas, uint32_t first);
+
+        // Adds the blinding factors to the MSM results
+        std::unique_ptr<Proof<Engine>> finalize(
+            typename Engine::G1Point &pi_a,
+            typename Engine::G1Point &pib1,
+            typename Engine::G2Point &pi_b,
+            typename Engine::G1Point &pi_c,
+            typename Engine::G1Point &pih);
+
     public:
         Prover(
             Engine &_E, 
@@ -104,16 +185,41 @@ namespace Groth16 {
             pointsB1(_pointsB1),
             pointsB2(_pointsB2),
             pointsC(_pointsC),
-            pointsH(_pointsH)
+            pointsH(_pointsH),
+            pool(nullptr),
+            control(nullptr),
+            stagesDone(0)
         { 
-            fft = new FFT<typename Engine::Fr>(domainSize*2);
+            fft = new LazyFFT<typename Engine::Fr>(domainSize*2);
         }
 
         ~Prover() {
             delete fft;
         }
 
-        std::unique_ptr<Proof<Engine>> prove(typename Engine::FrElement *wtns);
+        // Runs the proofs on '_pool' instead of the default pool, nullptr
+        // goes back to it. The pool must outlive the proofs.
+        void set_thread_pool(ThreadPool *_pool) { pool = _pool; }
+
+        // Keeps a copy of 'wtns' and its unblinded A, B1, B2 and C MSMs. While
+        // set, prove computes these MSMs as those of the base plus MSMs over
+        // the signals that differ from it, unless more than half do; H is
+        // always computed in full. nullptr drops the base.
+        void set_base_witness(const typename Engine::FrElement *wtns);
+
+        // A cancelled 'control' makes it throw ProveCancelled
+        std::unique_ptr<Proof<Engine>> prove(typename Engine::FrElement *wtns, ProveControl *control = nullptr);
+
+        // A new valid proof of the statement of 'proof' that cannot be linked
+        // to it: A/r1, r1*B + r1*r2*delta2 and C + r2*A for random r1 and r2.
+        // Uses no per-proof state, so it may run alongside prove.
+        std::unique_ptr<Proof<Engine>> rerandomize(const Proof<Engine> &proof);
+
+        // Same proofs as prove on each witness, computed stage by stage for the
+        // whole batch: every point section is swept for all witnesses before the
+        // next one, and the H scratch arrays are allocated once
+        std::vector<std::unique_ptr<Proof<Engine>>> prove_batch(const std::vector<typename Engine::FrElement *> &wtns,
+                                                                ProveControl *control = nullptr);
     };
 
     template <typename Engine>
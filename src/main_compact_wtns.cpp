@@ -0,0 +1,29 @@
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+#include "fileloader.hpp"
+#include "wtns_utils.hpp"
+
+
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        std::cerr << "Invalid number of parameters" << std::endl;
+        std::cerr << "Usage: compact_wtns <witness.wtns> <witness.cwtns>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        BinFileUtils::FileLoader wtns(argv[1]);
+
+        WtnsUtils::writeCompactWitness(wtns.dataBuffer(), wtns.dataSize(), argv[2]);
+
+    } catch (std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+
+    }
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,59 @@
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+#include "fileloader.hpp"
+#include "zkey_prepared.hpp"
+
+
+int main(int argc, char **argv)
+{
+    bool verify = false;
+    bool compress = false;
+    int argi = 1;
+
+    for (; argi < argc && std::string(argv[argi]).compare(0, 2, "--") == 0; argi++) {
+        const std::string flag = argv[argi];
+
+        if (flag == "--verify") {
+            verify = true;
+        } else if (flag == "--compress") {
+            compress = true;
+        } else {
+            std::cerr << "Unknown option " << flag << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if ((verify && compress) || argc - argi != (verify ? 1 : 2)) {
+        std::cerr << "Invalid number of parameters" << std::endl;
+        std::cerr << "Usage: prepare_zkey [--compress] <circuit.zkey> <circuit.pzkey>" << std::endl;
+        std::cerr << "       prepare_zkey --verify <circuit.pzkey>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        if (verify) {
+            BinFileUtils::FileLoader prepared(argv[argi]);
+
+            if (!ZKeyUtils::verifyPreparedChecksum(prepared.dataBuffer(), prepared.dataSize())) {
+                std::cerr << "Checksum mismatch" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            std::cout << "OK" << std::endl;
+
+        } else {
+            BinFileUtils::FileLoader zkey(argv[argi]);
+
+            ZKeyUtils::prepareUltraGrothZKey(zkey.dataBuffer(), zkey.dataSize(), argv[argi + 1], compress);
+        }
+
+    } catch (std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+
+    }
+
+    exit(EXIT_SUCCESS);
+}
@@ -4,6 +4,7 @@
 #include <vector>
 #include <stdexcept>
 #include <cstdint>
+#include <thread>
 #include "prover.h"
 #include "fileloader.hpp"
 
@@ -16,34 +17,115 @@ void first_zero_symbol(std::vector<char> &arr) {
 
 int main(int argc, char **argv)
 {
-    if (argc != 5) {
+    unsigned int loadFlags = 0;
+    bool validate = false;
+    unsigned int validateFlags = 0;
+    std::string validateCache;
+    int argi = 1;
+
+    for (; argi < argc && std::string(argv[argi]).compare(0, 2, "--") == 0; argi++) {
+        const std::string flag = argv[argi];
+
+        if (flag == "--huge-pages") {
+            loadFlags |= BinFileUtils::FileLoader::LOAD_HUGE_PAGES;
+        } else if (flag == "--mlock") {
+            loadFlags |= BinFileUtils::FileLoader::LOAD_MLOCK;
+        } else if (flag == "--populate") {
+            loadFlags |= BinFileUtils::FileLoader::LOAD_POPULATE;
+        } else if (flag == "--read") {
+            loadFlags |= BinFileUtils::FileLoader::LOAD_READ;
+        } else if (flag == "--shared") {
+            loadFlags |= BinFileUtils::FileLoader::LOAD_SHARED;
+        } else if (flag == "--numa-interleave") {
+            loadFlags |= BinFileUtils::FileLoader::LOAD_NUMA_INTERLEAVE;
+        } else if (flag == "--numa-partition") {
+            loadFlags |= BinFileUtils::FileLoader::LOAD_NUMA_PARTITION;
+        } else if (flag == "--validate") {
+            validate = true;
+        } else if (flag.compare(0, 17, "--validate-cache=") == 0) {
+            validate = true;
+            validateCache = flag.substr(17);
+        } else if (flag == "--validate-strict") {
+            validate = true;
+            validateFlags |= PROVER_VALIDATE_STRICT_CACHE;
+        } else if (flag == "--validate-fast") {
+            validate = true;
+            validateFlags |= PROVER_VALIDATE_FAST_CACHE;
+        } else {
+            std::cerr << "Unknown option " << flag << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (argc - argi != 4) {
         std::cerr << "Invalid number of parameters" << std::endl;
-        std::cerr << "Usage: prover <circuit.zkey> <witness.uwtns> <proof.json> <public.json>" << std::endl;
+        std::cerr << "Usage: prover [--huge-pages] [--mlock] [--populate] [--read] [--shared] [--numa-interleave|--numa-partition] [--validate] [--validate-cache=<file>] [--validate-strict|--validate-fast] <circuit.zkey> <witness.uwtns> <proof.json> <public.json>" << std::endl;
         return EXIT_FAILURE;
     }
 
     try {
-        const std::string zkeyFilename = argv[1];
-        const std::string wtnsFilename = argv[2];
-        const std::string proofFilename = argv[3];
-        const std::string publicFilename = argv[4];
+        const std::string zkeyFilename = argv[argi];
+        const std::string wtnsFilename = argv[argi + 1];
+        const std::string proofFilename = argv[argi + 2];
+        const std::string publicFilename = argv[argi + 3];
 
-        BinFileUtils::FileLoader zkeyFile(zkeyFilename);
-        BinFileUtils::FileLoader wtnsFile(wtnsFilename);
+        void                    *prover = nullptr;
         std::vector<char>        publicBuffer;
         std::vector<char>        proofBuffer;
         unsigned long long       publicSize = 0;
         unsigned long long       proofSize = 0;
         char                     errorMsg[1024];
+        int                      error;
+
+        // Loaded by the prover, which then knows the file for the validated-key cache
+        error = ultra_groth_prover_create_zkey_file_flags(
+                    &prover,
+                    zkeyFilename.c_str(),
+                    loadFlags,
+                    errorMsg,
+                    sizeof(errorMsg));
 
-        int error = ultra_groth_public_size_for_zkey_buf(
-                     zkeyFile.dataBuffer(),
-                     zkeyFile.dataSize(),
+        if (error != PROVER_OK) {
+            throw std::runtime_error(errorMsg);
+        }
+
+        // Only a budget of the prover's own spreads its workers over the
+        // nodes the way the points are partitioned
+        if (loadFlags & BinFileUtils::FileLoader::LOAD_NUMA_PARTITION) {
+            error = ultra_groth_prover_set_threads(
+                        prover,
+                        std::thread::hardware_concurrency(),
+                        errorMsg,
+                        sizeof(errorMsg));
+
+            if (error != PROVER_OK) {
+                ultra_groth_prover_destroy(prover);
+                throw std::runtime_error(errorMsg);
+            }
+        }
+
+        if (validate) {
+            error = ultra_groth_prover_validate_flags(
+                        prover,
+                        validateCache.empty() ? nullptr : validateCache.c_str(),
+                        validateFlags,
+                        errorMsg,
+                        sizeof(errorMsg));
+
+            if (error != PROVER_OK) {
+                ultra_groth_prover_destroy(prover);
+                throw std::runtime_error(errorMsg);
+            }
+        }
+
+        error = ultra_groth_public_size_for_zkey_file(
+                     zkeyFilename.c_str(),
                      &publicSize,
                      errorMsg,
                      sizeof(errorMsg));
 
         if (error != PROVER_OK) {
+            ultra_groth_prover_destroy(prover);
             throw std::runtime_error(errorMsg);
         }
 
@@ -52,11 +134,10 @@ int main(int argc, char **argv)
         publicBuffer.resize(publicSize);
         proofBuffer.resize(proofSize);
 
-        error = ultra_groth_prover(
-                   zkeyFile.dataBuffer(),
-                   zkeyFile.dataSize(),
-                   wtnsFile.dataBuffer(),
-                   wtnsFile.dataSize(),
+        // The witness file is mapped and used in place
+        error = ultra_groth_prover_prove_wtns_file(
+                   prover,
+                   wtnsFilename.c_str(),
                    proofBuffer.data(),
                    &proofSize,
                    publicBuffer.data(),
@@ -64,6 +145,8 @@ int main(int argc, char **argv)
                    errorMsg,
                    sizeof(errorMsg));
 
+        ultra_groth_prover_destroy(prover);
+
         if (error != PROVER_OK) {
             throw std::runtime_error(errorMsg);
         }
@@ -0,0 +1,266 @@
+#include <algorithm>
+
+template <typename Curve, typename Field>
+uint64_t MSMMontgomery<Curve, Field>::calcBitsPerChunk(uint64_t n) {
+
+#ifdef MSM_BITS_PER_CHUNK
+    uint64_t bits = MSM_BITS_PER_CHUNK;
+#else
+    uint64_t bits = 0;
+    while ((n >> bits) > 1) {
+        bits++;
+    }
+    bits = bits > 3 ? bits - 3 : 0;
+#endif
+
+    return std::min(std::max(bits, MIN_CHUNK_SIZE_BITS), MAX_CHUNK_SIZE_BITS);
+}
+
+template <typename Curve, typename Field>
+uint64_t MSMMontgomery<Curve, Field>::calcBatchBitsPerChunk(uint64_t n, uint64_t nScalars) {
+
+    // One bit less per doubling of the batch keeps the buckets of all arrays
+    // in about the memory of one array's
+    uint64_t batchBits = 0;
+    while ((1ULL << batchBits) < nScalars) {
+        batchBits++;
+    }
+
+    const uint64_t bits = calcBitsPerChunk(n);
+
+    return std::max(MIN_CHUNK_SIZE_BITS, bits > batchBits ? bits - batchBits : 0);
+}
+
+template <typename Curve, typename Field>
+uint64_t MSMMontgomery<Curve, Field>::batchDigitsSize(uint64_t n, uint64_t nScalars) {
+    return nScalars * calcChunks(calcBatchBitsPerChunk(n, nScalars)) * n * sizeof(int16_t);
+}
+
+template <typename Curve, typename Field>
+void MSMMontgomery<Curve, Field>::sliceScalars(
+    const typename Field::Element *scalars,
+    int16_t *out,
+    ThreadPool &threadPool
+) {
+    const uint64_t chunkMask = (1ULL << bitsPerChunk) - 1;
+    const int64_t  halfChunk = 1LL << (bitsPerChunk - 1);
+
+    threadPool.parallelFor(0, n, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t i = begin; i < end; i++) {
+            typename Field::Element s;
+
+            // The only place the scalar is touched: convert it in registers
+            // and cut it into signed windows straight away.
+            if (montgomery) {
+                fr.fromMontgomery(s, scalars[i]);
+            } else {
+                s = scalars[i];
+            }
+
+            int64_t carry = 0;
+
+            for (uint64_t j = 0; j < nChunks; j++) {
+                const uint64_t bitStart = j * bitsPerChunk;
+                const uint64_t limb = bitStart / 64;
+                const uint64_t offset = bitStart % 64;
+
+                uint64_t raw = 0;
+
+                if (limb < 4) {
+                    raw = s.v[limb] >> offset;
+                    if (offset + bitsPerChunk > 64 && limb + 1 < 4) {
+                        raw |= s.v[limb + 1] << (64 - offset);
+                    }
+                    raw &= chunkMask;
+                }
+
+                int64_t digit = (int64_t)raw + carry;
+
+                if (digit >= halfChunk) {
+                    digit -= (int64_t)1 << bitsPerChunk;
+                    carry = 1;
+                } else {
+                    carry = 0;
+                }
+
+                out[j * n + i] = (int16_t)digit;
+            }
+        }
+    });
+}
+
+template <typename Curve, typename Field>
+void MSMMontgomery<Curve, Field>::accumulateChunk(
+    typename Curve::Point *r,
+    typename Curve::PointAffine *bases,
+    uint64_t chunk,
+    uint64_t begin,
+    uint64_t end,
+    typename Curve::Point *buckets
+) {
+    for (uint64_t b = 0; b < nScalars * nBuckets; b++) {
+        g.copy(buckets[b], g.zero());
+    }
+
+    for (uint64_t i = begin; i < end; i++) {
+        if (control != nullptr && ((i - begin) & (ProveControl::POLL_INTERVAL - 1)) == 0 && control->isCancelled()) {
+            return;
+        }
+
+        typename Curve::PointAffine negBase;
+        bool negated = false;
+
+        // The base is loaded once for the digits of every array
+        for (uint64_t k = 0; k < nScalars; k++) {
+            const int16_t digit = digits[(k * nChunks + chunk) * n + i];
+            typename Curve::Point *kBuckets = buckets + k * nBuckets;
+
+            if (digit > 0) {
+                g.add(kBuckets[digit - 1], kBuckets[digit - 1], bases[i]);
+
+            } else if (digit < 0) {
+                if (!negated) {
+                    g.neg(negBase, bases[i]);
+                    negated = true;
+                }
+                g.add(kBuckets[-digit - 1], kBuckets[-digit - 1], negBase);
+            }
+        }
+    }
+
+    for (uint64_t k = 0; k < nScalars; k++) {
+        typename Curve::Point *kBuckets = buckets + k * nBuckets;
+        typename Curve::Point running;
+
+        g.copy(running, g.zero());
+        g.copy(r[k], g.zero());
+
+        for (int64_t b = nBuckets - 1; b >= 0; b--) {
+            g.add(running, running, kBuckets[b]);
+            g.add(r[k], r[k], running);
+        }
+    }
+}
+
+template <typename Curve, typename Field>
+void MSMMontgomery<Curve, Field>::runScalars(
+    typename Curve::Point *r,
+    typename Curve::PointAffine *bases,
+    const typename Field::Element *const *scalars,
+    uint64_t _nScalars,
+    uint64_t _n,
+    ThreadPool &threadPool
+) {
+    n = _n;
+    nScalars = _nScalars;
+
+    if (nScalars == 0) {
+        return;
+    }
+
+    if (n == 0) {
+        for (uint64_t k = 0; k < nScalars; k++) {
+            g.copy(r[k], g.zero());
+        }
+        return;
+    }
+
+    bitsPerChunk = calcBatchBitsPerChunk(n, nScalars);
+    // Two spare bits above SCALAR_BITS absorb the carry of the signed digits
+    nChunks = calcChunks(bitsPerChunk);
+    nBuckets = 1ULL << (bitsPerChunk - 1);
+
+    digits.resize(nScalars * nChunks * n);
+
+    for (uint64_t k = 0; k < nScalars; k++) {
+        sliceScalars(scalars[k], &digits[k * nChunks * n], threadPool);
+    }
+
+    if (control != nullptr) {
+        control->check();
+    }
+
+    // Tasks are split major, and parallelFor hands each thread a contiguous
+    // run of them: a thread reads the bases of about 1 / nThreads of the
+    // points, in the order numaPartition lays them over the nodes, so with
+    // the pool bound node by node it reads local memory. The splits are a
+    // multiple of the node count for the ranges to line up with the blocks.
+    const uint64_t nThreads = threadPool.getThreadCount();
+    const uint64_t nNodes = BinFileUtils::numaNodeCount();
+    const uint64_t nThreadSplits = std::max<uint64_t>(1, (nThreads + nChunks - 1) / nChunks);
+    const uint64_t nSplits = (nThreadSplits + nNodes - 1) / nNodes * nNodes;
+    const uint64_t nTasks = nChunks * nSplits;
+
+    // partial[t * nScalars + k]: task t for array k
+    std::vector<typename Curve::Point> partial(nTasks * nScalars);
+    std::vector<typename Curve::Point> buckets(nThreads * nScalars * nBuckets);
+
+    threadPool.parallelFor(0, nTasks, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t t = begin; t < end; t++) {
+            const uint64_t split = t / nChunks;
+            const uint64_t chunk = t % nChunks;
+
+            accumulateChunk(
+                &partial[t * nScalars],
+                bases,
+                chunk,
+                n * split / nSplits,
+                n * (split + 1) / nSplits,
+                &buckets[idThread * nScalars * nBuckets]);
+        }
+    });
+
+    digits.clear();
+    digits.shrink_to_fit();
+
+    // The partial sums of cancelled tasks are incomplete
+    if (control != nullptr) {
+        control->check();
+    }
+
+    for (uint64_t k = 0; k < nScalars; k++) {
+        g.copy(r[k], g.zero());
+
+        for (int64_t j = nChunks - 1; j >= 0; j--) {
+            for (uint64_t b = 0; b < bitsPerChunk; b++) {
+                g.dbl(r[k], r[k]);
+            }
+            for (uint64_t s = 0; s < nSplits; s++) {
+                g.add(r[k], r[k], partial[(s * nChunks + j) * nScalars + k]);
+            }
+        }
+    }
+}
+
+template <typename Curve, typename Field>
+void MSMMontgomery<Curve, Field>::run(
+    typename Curve::Point &r,
+    typename Curve::PointAffine *bases,
+    const typename Field::Element *scalars,
+    uint64_t _n,
+    ThreadPool &threadPool
+) {
+    runScalars(&r, bases, &scalars, 1, _n, threadPool);
+}
+
+template <typename Curve, typename Field>
+void MSMMontgomery<Curve, Field>::runBatch(
+    std::vector<typename Curve::Point> &r,
+    typename Curve::PointAffine *bases,
+    const std::vector<const typename Field::Element *> &scalars,
+    uint64_t _n,
+    ThreadPool &threadPool
+) {
+    r.resize(scalars.size());
+
+    for (uint64_t k = 0; k < scalars.size(); ) {
+        uint64_t m = scalars.size() - k;
+
+        while (m > 1 && batchDigitsSize(_n, m) > maxBatchDigitsSize) {
+            m--;
+        }
+
+        runScalars(&r[k], bases, &scalars[k], m, _n, threadPool);
+        k += m;
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef MSM_MONTGOMERY_HPP
+#define MSM_MONTGOMERY_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "threadpool.hpp"
+#include "numa.hpp"
+#include "prove_control.hpp"
+
+// Pippenger multi-scalar multiplication over scalars kept in Montgomery form.
+//
+// The prover produces most of its scalars (the H polynomial evaluations,
+// blinding factors) in Montgomery form. The generic Curve::multiMulByScalarMSM
+// expects normal form, which forced a separate full-array fromMontgomery pass
+// before every such MSM. Here the conversion is done per scalar while the
+// window digits are extracted, so the input array is only read once and is
+// never modified.
+//
+// Constructed with montgomery = false it takes normal form scalars, so that
+// the witness MSMs can run on a thread pool other than the default one.
+//
+// runBatch computes the MSMs of several scalar arrays over the same bases in
+// one pass: every base is read once and added to one bucket set per array,
+// so a batch of proofs reads each point section once instead of once per
+// proof. The windows are narrowed as the batch grows so that the buckets of
+// all arrays take about the memory of one. The window digits of a batch grow
+// faster than the batch, so a batch whose digits would exceed
+// maxBatchDigitsSize is run as several smaller ones, down to one array per
+// pass over the bases.
+//
+// Given a ProveControl, every task polls it each POLL_INTERVAL bases and
+// gives up once it is cancelled; run and runBatch then throw ProveCancelled
+// instead of combining the windows.
+template <typename Curve, typename Field>
+class MSMMontgomery {
+
+    const uint64_t MIN_CHUNK_SIZE_BITS = 3;
+    const uint64_t MAX_CHUNK_SIZE_BITS = 16;
+    const uint64_t SCALAR_BITS = 254;
+
+    static const uint64_t DEFAULT_MAX_BATCH_DIGITS_SIZE = 1ULL << 30;
+
+    Curve &g;
+    Field &fr;
+    bool montgomery;
+    // Polled by the tasks if set, owned by the caller
+    const ProveControl *control;
+
+    // Bytes of window digits a batch may take; one array may exceed it
+    uint64_t maxBatchDigitsSize;
+
+    uint64_t n;
+    uint64_t nScalars;
+    uint64_t bitsPerChunk;
+    uint64_t nChunks;
+    uint64_t nBuckets;
+
+    // Signed window digits, array then chunk major:
+    // digits[(k * nChunks + chunk) * n + i]
+    std::vector<int16_t> digits;
+
+    uint64_t calcBitsPerChunk(uint64_t n);
+
+    // Window width for a batch of nScalars arrays of n scalars
+    uint64_t calcBatchBitsPerChunk(uint64_t n, uint64_t nScalars);
+
+    uint64_t calcChunks(uint64_t bits) { return (SCALAR_BITS + 2 + bits - 1) / bits; }
+
+    // Bytes of the window digits of a batch of nScalars arrays of n scalars
+    uint64_t batchDigitsSize(uint64_t n, uint64_t nScalars);
+
+    void sliceScalars(const typename Field::Element *scalars, int16_t *out, ThreadPool &threadPool);
+
+    // Window 'chunk' of bases [begin, end) for every array, into r[k]. Left
+    // unfinished if the control is cancelled.
+    void accumulateChunk(
+        typename Curve::Point *r,
+        typename Curve::PointAffine *bases,
+        uint64_t chunk,
+        uint64_t begin,
+        uint64_t end,
+        typename Curve::Point *buckets);
+
+    void runScalars(
+        typename Curve::Point *r,
+        typename Curve::PointAffine *bases,
+        const typename Field::Element *const *scalars,
+        uint64_t nScalars,
+        uint64_t n,
+        ThreadPool &threadPool);
+
+public:
+    MSMMontgomery(Curve &_g, Field &_fr, bool _montgomery = true, const ProveControl *_control = nullptr)
+        : g(_g), fr(_fr), montgomery(_montgomery), control(_control),
+          maxBatchDigitsSize(DEFAULT_MAX_BATCH_DIGITS_SIZE) {}
+
+    void setMaxBatchDigitsSize(uint64_t size) { maxBatchDigitsSize = size; }
+
+    void run(
+        typename Curve::Point &r,
+        typename Curve::PointAffine *bases,
+        const typename Field::Element *scalars,
+        uint64_t n,
+        ThreadPool &threadPool = ThreadPool::defaultPool());
+
+    // r[k] = MSM of scalars[k] over the n bases
+    void runBatch(
+        std::vector<typename Curve::Point> &r,
+        typename Curve::PointAffine *bases,
+        const std::vector<const typename Field::Element *> &scalars,
+        uint64_t n,
+        ThreadPool &threadPool = ThreadPool::defaultPool());
+};
+
+#include "msm_montgomery.cpp"
+
+#endif // MSM_MONTGOMERY_HPP
@@ -0,0 +1,144 @@
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "numa.hpp"
+
+namespace BinFileUtils {
+
+// Parses a sysfs list such as "0-3,8-11"
+static std::vector<unsigned> readList(const std::string &path)
+{
+    std::vector<unsigned> ids;
+    std::ifstream file(path);
+    std::string list, range;
+
+    if (!std::getline(file, list)) {
+        return ids;
+    }
+
+    std::istringstream ranges(list);
+
+    while (std::getline(ranges, range, ',')) {
+        unsigned first, last;
+        char dash;
+        std::istringstream in(range);
+
+        if (!(in >> first)) {
+            continue;
+        }
+        last = (in >> dash >> last) ? last : first;
+
+        for (unsigned id = first; id <= last; id++) {
+            ids.push_back(id);
+        }
+    }
+
+    return ids;
+}
+
+static const std::vector<unsigned>& nodes()
+{
+    static const std::vector<unsigned> online = readList("/sys/devices/system/node/online");
+    return online;
+}
+
+unsigned numaNodeCount()
+{
+    return nodes().empty() ? 1 : nodes().size();
+}
+
+unsigned numaCpuNode(unsigned cpu)
+{
+    for (size_t i = 0; i < nodes().size(); i++) {
+        for (unsigned id : readList("/sys/devices/system/node/node" + std::to_string(nodes()[i]) + "/cpulist")) {
+            if (id == cpu) {
+                return i;
+            }
+        }
+    }
+
+    return 0;
+}
+
+unsigned cpuCore(unsigned cpu)
+{
+    const std::vector<unsigned> siblings =
+        readList("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list");
+
+    return siblings.empty() ? cpu : siblings[0];
+}
+
+#ifdef __linux__
+
+// Enough for the node ids of any host mbind accepts
+static const unsigned MAX_NODES = 1024;
+
+static void bindRange(const void *addr, uint64_t size, int mode, const std::vector<unsigned> &ids)
+{
+    const uint64_t mask = sysconf(_SC_PAGESIZE) - 1;
+    const uint64_t start = (uint64_t)addr & ~mask;
+    const uint64_t end = ((uint64_t)addr + size + mask) & ~mask;
+    unsigned long nodeMask[MAX_NODES / (8 * sizeof(unsigned long))] = {};
+
+    if (addr == nullptr || size == 0) {
+        return;
+    }
+
+    for (unsigned id : ids) {
+        if (id < MAX_NODES) {
+            nodeMask[id / (8 * sizeof(unsigned long))] |= 1UL << (id % (8 * sizeof(unsigned long)));
+        }
+    }
+
+    syscall(SYS_mbind, start, end - start, mode, nodeMask, MAX_NODES + 1, MPOL_MF_MOVE);
+}
+
+void numaInterleave(const void *addr, uint64_t size)
+{
+    if (numaNodeCount() > 1) {
+        bindRange(addr, size, MPOL_INTERLEAVE, nodes());
+    }
+}
+
+void numaPartition(const void *addr, uint64_t size)
+{
+    const uint64_t n = numaNodeCount();
+
+    if (n < 2) {
+        return;
+    }
+
+    // Block edges fall on page boundaries, the pages straddling them are
+    // left to the previous block
+    const uint64_t pageSize = sysconf(_SC_PAGESIZE);
+    uint64_t begin = (uint64_t)addr;
+
+    for (uint64_t i = 0; i < n; i++) {
+        uint64_t end = (uint64_t)addr + size * (i + 1) / n;
+
+        end = i + 1 < n ? end & ~(pageSize - 1) : end;
+
+        if (end > begin) {
+            bindRange((const void *)begin, end - begin, MPOL_PREFERRED, {nodes()[i]});
+            begin = end;
+        }
+    }
+}
+
+#else
+
+void numaInterleave(const void *, uint64_t) {}
+void numaPartition(const void *, uint64_t) {}
+
+#endif
+
+} // Namespace
@@ -0,0 +1,36 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <cstdint>
+
+namespace BinFileUtils {
+
+    // Memory placement on NUMA hosts, through the mbind system call and the
+    // topology in sysfs so that libnuma is not needed. Everything is a no-op
+    // on a single node host and outside Linux; placement errors are ignored,
+    // the data stays valid wherever its pages end up.
+
+    // Number of memory nodes, 1 when the host is not NUMA
+    unsigned numaNodeCount();
+
+    // Index of the node of CPU 'cpu', in the order of numaPartition; 0 when
+    // the host is not NUMA or the CPU is not listed
+    unsigned numaCpuNode(unsigned cpu);
+
+    // Lowest numbered SMT sibling of CPU 'cpu': the same for all the hardware
+    // threads of one core, 'cpu' itself when the topology is not known
+    unsigned cpuCore(unsigned cpu);
+
+    // Spreads the pages of [addr, addr + size) round robin over all nodes.
+    // Pages allocated later follow the policy, resident ones are migrated.
+    void numaInterleave(const void *addr, uint64_t size);
+
+    // Splits [addr, addr + size) in one contiguous block per node, the first
+    // block on the first node. With worker t of a pool on node
+    // t * nodes / threads (see ThreadBudget) the blocks line up with the
+    // point ranges MSMMontgomery hands out to the workers.
+    void numaPartition(const void *addr, uint64_t size);
+
+} // Namespace
+
+#endif // NUMA_HPP
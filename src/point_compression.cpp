@@ -0,0 +1,219 @@
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "point_compression.hpp"
+#include "fq2.hpp"
+#include "threadpool.hpp"
+
+namespace ZKeyUtils {
+
+// (q - 1) / 2 in normal form, the largest "small" root
+static const uint64_t HALF_Q[4] = {0x9e10460b6c3e7ea3, 0xcbc0b548b438e546, 0xdc2822db40c0ac2e, 0x183227397098d014};
+
+// Exponents as little-endian limbs: (q + 1) / 4, (q - 3) / 4 and (q - 1) / 2
+static const uint64_t EXP_SQRT[4] = {0x4f082305b61f3f52, 0x65e05aa45a1c72a3, 0x6e14116da0605617, 0x0c19139cb84c680a};
+static const uint64_t EXP_Q_MINUS_3_DIV_4[4] = {0x4f082305b61f3f51, 0x65e05aa45a1c72a3, 0x6e14116da0605617, 0x0c19139cb84c680a};
+static const uint64_t EXP_Q_MINUS_1_DIV_2[4] = {0x9e10460b6c3e7ea3, 0xcbc0b548b438e546, 0xdc2822db40c0ac2e, 0x183227397098d014};
+
+static bool isLargest(const FqElement &a) {
+    FqElement n;
+    RawFq::field.fromMontgomery(n, a);
+
+    for (int i = 3; i >= 0; i--) {
+        if (n.v[i] != HALF_Q[i]) {
+            return n.v[i] > HALF_Q[i];
+        }
+    }
+    return false;
+}
+
+// Square root in Fq for q = 3 mod 4; false if a is not a square
+static bool fqSqrt(FqElement &r, const FqElement &a) {
+    RawFq &F = RawFq::field;
+    FqElement check;
+
+    F.exp(r, a, (uint8_t *)EXP_SQRT, 32);
+    F.square(check, r);
+
+    return F.eq(check, a);
+}
+
+// Square root in Fq2, algorithm 9 of Adj and Rodriguez-Henriquez,
+// "Square root computation over even extension fields"; false if none
+static bool fq2Sqrt(Fq2Element &r, const Fq2Element &a) {
+    RawFq &F = RawFq::field;
+    Fq2Element a1, alpha, conj, a0, x0, check;
+
+    fq2Exp(a1, a, EXP_Q_MINUS_3_DIV_4);
+    fq2Square(alpha, a1);
+    fq2Mul(alpha, alpha, a);
+
+    // alpha^q is the conjugate of alpha
+    F.copy(conj.c0, alpha.c0);
+    F.neg(conj.c1, alpha.c1);
+    fq2Mul(a0, conj, alpha);
+
+    if (F.eq(a0.c0, F.negOne()) && F.isZero(a0.c1)) {
+        return false;
+    }
+
+    fq2Mul(x0, a1, a);
+
+    if (F.eq(alpha.c0, F.negOne()) && F.isZero(alpha.c1)) {
+        // u * x0
+        FqElement t;
+        F.neg(t, x0.c1);
+        F.copy(r.c1, x0.c0);
+        F.copy(r.c0, t);
+
+    } else {
+        Fq2Element b;
+        F.add(b.c0, alpha.c0, F.one());
+        F.copy(b.c1, alpha.c1);
+        fq2Exp(b, b, EXP_Q_MINUS_1_DIV_2);
+        fq2Mul(r, b, x0);
+    }
+
+    fq2Square(check, r);
+    return fq2Eq(check, a);
+}
+
+static void throwInvalidPoint(uint64_t index) {
+    throw std::invalid_argument("Compressed point #" + std::to_string(index) + " is not on the curve");
+}
+
+void compressG1Points(uint8_t *out, const void *points, uint64_t n) {
+    const FqElement *p = (const FqElement *)points;
+
+    ThreadPool::defaultPool().parallelFor(0, n, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t i = begin; i < end; i++) {
+            const FqElement &x = p[2 * i];
+            const FqElement &y = p[2 * i + 1];
+            uint8_t *c = out + i * G1_COMPRESSED_SIZE;
+
+            memcpy(c, &x, G1_COMPRESSED_SIZE);
+
+            if (RawFq::field.isZero(x) && RawFq::field.isZero(y)) {
+                c[G1_COMPRESSED_SIZE - 1] |= COMPRESSED_INFINITY;
+            } else if (isLargest(y)) {
+                c[G1_COMPRESSED_SIZE - 1] |= COMPRESSED_Y_LARGEST;
+            }
+        }
+    });
+}
+
+void compressG2Points(uint8_t *out, const void *points, uint64_t n) {
+    const Fq2Element *p = (const Fq2Element *)points;
+
+    ThreadPool::defaultPool().parallelFor(0, n, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t i = begin; i < end; i++) {
+            const Fq2Element &x = p[2 * i];
+            const Fq2Element &y = p[2 * i + 1];
+            uint8_t *c = out + i * G2_COMPRESSED_SIZE;
+
+            memcpy(c, &x, G2_COMPRESSED_SIZE);
+
+            const bool infinity = RawFq::field.isZero(x.c0) && RawFq::field.isZero(x.c1) &&
+                                  RawFq::field.isZero(y.c0) && RawFq::field.isZero(y.c1);
+
+            if (infinity) {
+                c[G2_COMPRESSED_SIZE - 1] |= COMPRESSED_INFINITY;
+            } else if (RawFq::field.isZero(y.c1) ? isLargest(y.c0) : isLargest(y.c1)) {
+                c[G2_COMPRESSED_SIZE - 1] |= COMPRESSED_Y_LARGEST;
+            }
+        }
+    });
+}
+
+void decompressG1Points(void *points, const uint8_t *in, uint64_t n) {
+    FqElement *p = (FqElement *)points;
+    const FqElement &b = curveConstants().b1;
+    std::atomic<int64_t> invalid(-1);
+
+    ThreadPool::defaultPool().parallelFor(0, n, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        RawFq &F = RawFq::field;
+
+        for (int64_t i = begin; i < end; i++) {
+            FqElement &x = p[2 * i];
+            FqElement &y = p[2 * i + 1];
+            const uint8_t flags = in[(i + 1) * G1_COMPRESSED_SIZE - 1];
+
+            memcpy(&x, in + i * G1_COMPRESSED_SIZE, G1_COMPRESSED_SIZE);
+            x.v[3] &= 0x3fffffffffffffffULL;
+
+            if (flags & COMPRESSED_INFINITY) {
+                F.copy(y, F.zero());
+                continue;
+            }
+
+            FqElement rhs;
+            F.square(rhs, x);
+            F.mul(rhs, rhs, x);
+            F.add(rhs, rhs, b);
+
+            if (!fqSqrt(y, rhs)) {
+                invalid = i;
+                return;
+            }
+
+            if (isLargest(y) != ((flags & COMPRESSED_Y_LARGEST) != 0)) {
+                F.neg(y, y);
+            }
+        }
+    });
+
+    if (invalid >= 0) {
+        throwInvalidPoint(invalid);
+    }
+}
+
+void decompressG2Points(void *points, const uint8_t *in, uint64_t n) {
+    Fq2Element *p = (Fq2Element *)points;
+    const Fq2Element &b = curveConstants().b2;
+    std::atomic<int64_t> invalid(-1);
+
+    ThreadPool::defaultPool().parallelFor(0, n, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        RawFq &F = RawFq::field;
+
+        for (int64_t i = begin; i < end; i++) {
+            Fq2Element &x = p[2 * i];
+            Fq2Element &y = p[2 * i + 1];
+            const uint8_t flags = in[(i + 1) * G2_COMPRESSED_SIZE - 1];
+
+            memcpy(&x, in + i * G2_COMPRESSED_SIZE, G2_COMPRESSED_SIZE);
+            x.c1.v[3] &= 0x3fffffffffffffffULL;
+
+            if (flags & COMPRESSED_INFINITY) {
+                F.copy(y.c0, F.zero());
+                F.copy(y.c1, F.zero());
+                continue;
+            }
+
+            Fq2Element rhs;
+            fq2Square(rhs, x);
+            fq2Mul(rhs, rhs, x);
+            F.add(rhs.c0, rhs.c0, b.c0);
+            F.add(rhs.c1, rhs.c1, b.c1);
+
+            if (!fq2Sqrt(y, rhs)) {
+                invalid = i;
+                return;
+            }
+
+            const bool largest = F.isZero(y.c1) ? isLargest(y.c0) : isLargest(y.c1);
+
+            if (largest != ((flags & COMPRESSED_Y_LARGEST) != 0)) {
+                F.neg(y.c0, y.c0);
+                F.neg(y.c1, y.c1);
+            }
+        }
+    });
+
+    if (invalid >= 0) {
+        throwInvalidPoint(invalid);
+    }
+}
+
+} // namespace
@@ -0,0 +1,38 @@
+#ifndef POINT_COMPRESSION_HPP
+#define POINT_COMPRESSION_HPP
+
+#include <cstdint>
+
+// Compressed encoding of the BN254 affine points of a zkey.
+//
+// Uncompressed points are stored as in a snarkjs zkey: G1 as x, y and G2 as
+// x.c0, x.c1, y.c0, y.c1, every coordinate an Fq element in Montgomery form,
+// the point at infinity as all zeros. A compressed point keeps x only; since
+// x < q < 2^254 the two top bits of its last byte are free and hold
+//
+//   COMPRESSED_INFINITY  the point at infinity (x is zero)
+//   COMPRESSED_Y_LARGEST y is the larger of the two roots, comparing the
+//                        normal forms of y (G1) or of y.c1, or y.c0 when
+//                        y.c1 is zero (G2)
+//
+// so G1 points take 32 bytes instead of 64 and G2 points 64 instead of 128.
+
+namespace ZKeyUtils {
+
+    const uint64_t G1_COMPRESSED_SIZE = 32;
+    const uint64_t G2_COMPRESSED_SIZE = 64;
+
+    const uint8_t COMPRESSED_INFINITY = 0x80;
+    const uint8_t COMPRESSED_Y_LARGEST = 0x40;
+
+    // Compress n points from 'points' into 'out', in parallel
+    void compressG1Points(uint8_t *out, const void *points, uint64_t n);
+    void compressG2Points(uint8_t *out, const void *points, uint64_t n);
+
+    // Expand n compressed points from 'in' into 'points', in parallel.
+    // Throws if an x coordinate has no point on the curve.
+    void decompressG1Points(void *points, const uint8_t *in, uint64_t n);
+    void decompressG2Points(void *points, const uint8_t *in, uint64_t n);
+}
+
+#endif // POINT_COMPRESSION_HPP
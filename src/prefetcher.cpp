@@ -0,0 +1,126 @@
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "prefetcher.hpp"
+#include "threadpool.hpp"
+
+namespace BinFileUtils {
+
+static uint64_t pageSize() {
+    static const uint64_t size = sysconf(_SC_PAGESIZE);
+    return size;
+}
+
+void adviseRange(const void *addr, uint64_t size, int advice) {
+    if (addr == nullptr || size == 0) {
+        return;
+    }
+
+    const uint64_t mask = pageSize() - 1;
+    const uint64_t start = (uint64_t)addr & ~mask;
+    const uint64_t end = ((uint64_t)addr + size + mask) & ~mask;
+
+    madvise((void *)start, end - start, advice);
+}
+
+void touchRange(const void *addr, uint64_t size, ThreadPool &pool) {
+    if (addr == nullptr || size == 0) {
+        return;
+    }
+
+    const uint64_t step = pageSize();
+    const uint64_t start = (uint64_t)addr & ~(step - 1);
+    const uint64_t nPages = ((uint64_t)addr + size - start + step - 1) / step;
+
+    adviseRange(addr, size, MADV_WILLNEED);
+
+    pool.parallelFor(0, nPages, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        uint8_t sink = 0;
+
+        for (int64_t page = begin; page < end; page++) {
+            // The first page may start before addr, read inside the range
+            const uint64_t at = std::max<uint64_t>(start + page * step, (uint64_t)addr);
+
+            sink ^= *(const volatile uint8_t *)at;
+        }
+        (void)sink;
+    });
+}
+
+Prefetcher::Prefetcher()
+    : stopping(false)
+{
+}
+
+Prefetcher::~Prefetcher()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    cv.notify_one();
+
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void Prefetcher::prefetch(const void *addr, uint64_t size)
+{
+    if (addr == nullptr || size == 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+
+        if (!worker.joinable()) {
+            worker = std::thread(&Prefetcher::run, this);
+        }
+        queue.push_back(std::make_pair(addr, size));
+    }
+    cv.notify_one();
+}
+
+void Prefetcher::run()
+{
+    const uint64_t step = pageSize();
+
+    for (;;) {
+        std::pair<const void *, uint64_t> range;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return stopping || !queue.empty(); });
+
+            if (stopping) {
+                return;
+            }
+            range = queue.front();
+            queue.pop_front();
+        }
+
+        adviseRange(range.first, range.second, MADV_WILLNEED);
+
+        const volatile uint8_t *bytes = (const volatile uint8_t *)range.first;
+        uint8_t sink = 0;
+
+        for (uint64_t offset = 0; offset < range.second; offset += step) {
+            sink ^= bytes[offset];
+
+            // Cheap check so destruction does not wait for a large range
+            if ((offset & ((step << 8) - 1)) == 0) {
+                std::lock_guard<std::mutex> guard(mutex);
+                if (stopping) {
+                    return;
+                }
+            }
+        }
+        (void)sink;
+    }
+}
+
+} // Namespace
@@ -0,0 +1,52 @@
+#ifndef PREFETCHER_HPP
+#define PREFETCHER_HPP
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <condition_variable>
+
+class ThreadPool;
+
+namespace BinFileUtils {
+
+    // madvise over the pages covering [addr, addr + size); errors are ignored,
+    // advice is only a hint
+    void adviseRange(const void *addr, uint64_t size, int advice);
+
+    // Faults in the pages covering [addr, addr + size) from all threads of
+    // 'pool', reading one byte per page; returns once they are resident
+    void touchRange(const void *addr, uint64_t size, ThreadPool &pool);
+
+    // Background thread faulting in ranges of a mapped file ahead of use.
+    //
+    // Each queued range gets MADV_WILLNEED and then has one byte per page read,
+    // so the page faults (and the disk reads behind them on a cold cache) are
+    // taken by this thread while the caller computes on the previous stage.
+    // Ranges are handled in FIFO order; pending ones are dropped on destruction.
+    class Prefetcher {
+
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::pair<const void *, uint64_t>> queue;
+        bool stopping;
+
+        void run();
+
+    public:
+        Prefetcher();
+        ~Prefetcher();
+
+        Prefetcher(const Prefetcher&) = delete;
+        Prefetcher& operator=(const Prefetcher&) = delete;
+
+        // Returns immediately; the worker thread is started on first use
+        void prefetch(const void *addr, uint64_t size);
+    };
+
+} // Namespace
+
+#endif // PREFETCHER_HPP
@@ -0,0 +1,100 @@
+#ifndef PROVE_CONTROL_HPP
+#define PROVE_CONTROL_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+#include "thread_budget.hpp"
+
+// Thrown out of a proof whose ProveControl was cancelled
+class ProveCancelled : public std::runtime_error
+{
+public:
+    ProveCancelled()
+        : std::runtime_error("Proof cancelled") {}
+};
+
+// Cancellation token and progress reporting for proofs, shared between the
+// prover and its caller.
+//
+// cancel() may be called from any thread. The provers poll the token between
+// stages, every POLL_INTERVAL points of their MSMs and every POLL_INTERVAL
+// iterations of their coefficient loops, then unwind with ProveCancelled; an
+// FFT that has started runs to its end. A token may be shared by several
+// proofs, which are then all cancelled together.
+class ProveControl
+{
+public:
+    // Called on the proving thread after each stage, 'done' out of 'total'
+    typedef void (*ProgressCallback)(void *userData, const char *stage, unsigned int done, unsigned int total);
+
+    explicit ProveControl(ProgressCallback _progress = nullptr, void *_userData = nullptr)
+        : cancelled(false), progress(_progress), userData(_userData), nThreads(0) {}
+
+    ProveControl(const ProveControl&) = delete;
+    ProveControl& operator=(const ProveControl&) = delete;
+
+    void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+
+    // Makes the token usable for another proof
+    void reset() { cancelled.store(false, std::memory_order_relaxed); }
+
+    bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+
+    void check() const {
+        if (isCancelled()) {
+            throw ProveCancelled();
+        }
+    }
+
+    // Reports a completed stage, then checks for cancellation
+    void stageDone(const char *stage, unsigned int done, unsigned int total) {
+        if (progress != nullptr) {
+            progress(userData, stage, done, total);
+        }
+        check();
+    }
+
+    // Thread budget of the proofs run under this control, 0 for that of the
+    // prover. Waits for the proof running on the budget, if any.
+    void setThreads(unsigned int n) {
+        std::lock_guard<std::mutex> guard(budgetMutex);
+        nThreads = n;
+    }
+
+    // The budget of threads() threads for a proof, built on first use and
+    // kept until the count changes, with 'lock' holding it for that proof:
+    // proofs under one control with a thread count run in turn, whichever
+    // prover objects they use. nullptr, with 'lock' released, for 0 threads.
+    ThreadBudget *lockBudget(std::unique_lock<std::mutex> &lock) {
+        lock = std::unique_lock<std::mutex>(budgetMutex);
+
+        if (nThreads == 0) {
+            lock.unlock();
+            return nullptr;
+        }
+
+        if (!budget || budget->threadCount() != nThreads) {
+            // Give the cores of the old budget back before reserving new ones
+            budget.reset();
+            budget.reset(new ThreadBudget(nThreads));
+        }
+
+        return budget.get();
+    }
+
+    // Iterations between two polls in the parallel loops, a power of two
+    static const uint64_t POLL_INTERVAL = 4096;
+
+private:
+    std::atomic<bool> cancelled;
+    ProgressCallback progress;
+    void *userData;
+    std::mutex budgetMutex;
+    unsigned int nThreads;
+    std::unique_ptr<ThreadBudget> budget;
+};
+
+#endif // PROVE_CONTROL_HPP
@@ -0,0 +1,80 @@
+#include <algorithm>
+
+#include "prove_queue.hpp"
+
+ProveQueue::ProveQueue()
+    : running(nullptr),
+      stopping(false)
+{
+}
+
+ProveQueue::~ProveQueue()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    cv.notify_one();
+
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+ProveQueue& ProveQueue::instance()
+{
+    static ProveQueue *queue = new ProveQueue();
+
+    return *queue;
+}
+
+void ProveQueue::enqueue(const void *owner, std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+
+        if (!worker.joinable()) {
+            worker = std::thread(&ProveQueue::run, this);
+        }
+        queue.push_back(Job{owner, std::move(job)});
+    }
+    cv.notify_one();
+}
+
+void ProveQueue::drain(const void *owner)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    done.wait(lock, [this, owner] {
+        return running != owner &&
+               std::none_of(queue.begin(), queue.end(), [owner] (const Job &job) { return job.owner == owner; });
+    });
+}
+
+void ProveQueue::run()
+{
+    for (;;) {
+        Job job;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return stopping || !queue.empty(); });
+
+            if (stopping) {
+                return;
+            }
+            job = std::move(queue.front());
+            queue.pop_front();
+            running = job.owner;
+        }
+
+        job.run();
+
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            running = nullptr;
+        }
+        done.notify_all();
+    }
+}
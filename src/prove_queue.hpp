@@ -0,0 +1,58 @@
+#ifndef PROVE_QUEUE_HPP
+#define PROVE_QUEUE_HPP
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+// Background thread running the proofs of the asynchronous C API, one job at
+// a time in FIFO order.
+//
+// The process-wide instance serves the prover handles without a thread
+// budget: their proofs all run on the default pool, each already spreading
+// over its threads, so queueing more of them only costs their pending
+// entries. A handle with a budget of its own has a queue of its own, so that
+// its proofs run alongside those of the other handles on their own cores.
+// Each job is tagged with the prover handle it uses, so that destroying a
+// handle can wait for its jobs.
+class ProveQueue {
+
+    struct Job {
+        const void *owner;
+        std::function<void()> run;
+    };
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable cv;
+    // Signalled whenever a job completes
+    std::condition_variable done;
+    std::deque<Job> queue;
+    // Owner of the job being run, nullptr if none
+    const void *running;
+    bool stopping;
+
+    void run();
+
+public:
+    ProveQueue();
+    ~ProveQueue();
+
+    ProveQueue(const ProveQueue&) = delete;
+    ProveQueue& operator=(const ProveQueue&) = delete;
+
+    // Process-wide queue, never destroyed so that proofs still queued at exit
+    // do not hold it up
+    static ProveQueue& instance();
+
+    // Returns immediately; the worker thread is started on first use
+    void enqueue(const void *owner, std::function<void()> job);
+
+    // Waits until no job of 'owner' is queued or running. Must not be called
+    // from a job.
+    void drain(const void *owner);
+};
+
+#endif // PROVE_QUEUE_HPP
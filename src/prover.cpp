@@ -1,6 +1,11 @@
+#include <sys/mman.h>
 #include <gmp.h>
 #include <string>
 #include <cstring>
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <cstdint>
 #include <alt_bn128.hpp>
@@ -9,12 +14,35 @@
 #include "groth16.hpp"
 #include "ultra_groth.hpp"
 #include "zkey_utils.hpp"
+#include "zkey_prepared.hpp"
+#include "zkey_validation.hpp"
 #include "wtns_utils.hpp"
 #include "binfile_utils.hpp"
 #include "fileloader.hpp"
+#include "section_streamer.hpp"
+#include "prove_queue.hpp"
+#include "prove_control.hpp"
+#include "thread_budget.hpp"
+#include "field_bytes.hpp"
+#include "field_decimal.hpp"
+#include "numa.hpp"
+#include "threadpool.hpp"
 
 using json = nlohmann::json;
 
+static_assert(PROVER_LOAD_HUGE_PAGES == BinFileUtils::FileLoader::LOAD_HUGE_PAGES &&
+              PROVER_LOAD_MLOCK == BinFileUtils::FileLoader::LOAD_MLOCK &&
+              PROVER_LOAD_POPULATE == BinFileUtils::FileLoader::LOAD_POPULATE &&
+              PROVER_LOAD_READ == BinFileUtils::FileLoader::LOAD_READ &&
+              PROVER_LOAD_SHARED == BinFileUtils::FileLoader::LOAD_SHARED &&
+              PROVER_LOAD_NUMA_INTERLEAVE == BinFileUtils::FileLoader::LOAD_NUMA_INTERLEAVE &&
+              PROVER_LOAD_NUMA_PARTITION == BinFileUtils::FileLoader::LOAD_NUMA_PARTITION,
+              "load flags are passed to FileLoader as is");
+
+static const unsigned int PROVER_LOAD_ALL =
+    PROVER_LOAD_HUGE_PAGES | PROVER_LOAD_MLOCK | PROVER_LOAD_POPULATE | PROVER_LOAD_READ |
+    PROVER_LOAD_SHARED | PROVER_LOAD_NUMA_INTERLEAVE | PROVER_LOAD_NUMA_PARTITION;
+
 
 class ShortBufferException : public std::invalid_argument
 {
@@ -23,6 +51,13 @@ public:
         : std::invalid_argument(msg) {}
 };
 
+// Encoding of the proofs and public signals returned by the prover objects
+enum OutputFormat {
+    OUTPUT_JSON,
+    // Big-endian coordinates and signals, see *_prover_prove_binary
+    OUTPUT_BINARY
+};
+
 class InvalidWitnessLengthException : public std::invalid_argument
 {
 public:
@@ -89,7 +124,8 @@ PrimeIsValid(mpz_srcptr prime)
 static std::string
 BuildPublicStringUltraGroth(AltBn128::FrElement *wtnsData, uint32_t nPublic, uint32_t rand_indx)
 {
-    json jsonPublic;
+    std::string strPublic;
+    FieldDecimal::ArrayWriter writer(strPublic, nPublic);
     AltBn128::FrElement aux;
     for (uint32_t i=1; i<= nPublic; i++) {
         // signal corresponding to rand index is skipped because it derived from rounds commitments hash during verification
@@ -97,25 +133,117 @@ BuildPublicStringUltraGroth(AltBn128::FrElement *wtnsData, uint32_t nPublic, uin
             continue;
         }
 
-        AltBn128::Fr.toMontgomery(aux, wtnsData[i]);
-        jsonPublic.push_back(AltBn128::Fr.toString(aux));
+        aux = wtnsData[i];
+        FieldDecimal::reduce(aux.v, FrInline::q);
+        writer.add(aux.v);
     }
+    writer.close();
 
-    return jsonPublic.dump();
+    return strPublic;
 }
 static std::string
 BuildPublicString(AltBn128::FrElement *wtnsData, uint32_t nPublic)
 {
-    json jsonPublic;
+    return BuildPublicStringUltraGroth(wtnsData, nPublic, 0);
+}
+
+// Public signals as 32-byte big-endian words, in the order of the JSON output
+// (rand_indx is skipped when set, as for UltraGroth), reduced like it
+static std::string
+BuildPublicBinary(AltBn128::FrElement *wtnsData, uint32_t nPublic, uint32_t rand_indx)
+{
+    std::string binPublic;
+    uint8_t word[32];
     AltBn128::FrElement aux;
+
+    binPublic.reserve((size_t)nPublic * sizeof(word));
+
     for (uint32_t i=1; i<= nPublic; i++) {
-        AltBn128::Fr.toMontgomery(aux, wtnsData[i]);
-        jsonPublic.push_back(AltBn128::Fr.toString(aux));
+        if (i == rand_indx) {
+            continue;
+        }
+
+        aux = wtnsData[i];
+        FieldDecimal::reduce(aux.v, FrInline::q);
+        normalToBytesBE(aux, word);
+        binPublic.append((const char *)word, sizeof(word));
     }
 
-    return jsonPublic.dump();
+    return binPublic;
+}
+
+// Prepared zkeys (see zkey_prepared.hpp) are accepted wherever an UltraGroth zkey is
+static std::string
+UltraGrothZKeyType(const void *zkey_buffer, unsigned long long zkey_size)
+{
+    return ZKeyUtils::isPrepared(zkey_buffer, zkey_size) ? "pzky" : "zkey";
+}
+
+static uint32_t
+UltraGrothZKeyVersion(const void *zkey_buffer, unsigned long long zkey_size)
+{
+    return ZKeyUtils::isPrepared(zkey_buffer, zkey_size) ? ZKeyUtils::PREPARED_VERSION : 1;
+}
+
+// Lays each point section out as one block per NUMA node, for zkeys loaded
+// with LOAD_NUMA_PARTITION. The thread budget of the prover object then
+// spreads its workers over the nodes in the same order.
+static void
+PartitionPoints(const std::vector<std::pair<const void *, uint64_t>> &sections)
+{
+    for (const auto &section : sections) {
+        BinFileUtils::numaPartition(section.first, section.second);
+    }
 }
 
+// Thread pool of one proof of a prover object, held for the length of the
+// proof: the budget of 'control' if it sets a thread count, else the object's
+// 'budget' of 'threads' threads, built on first use and spread over the NUMA
+// nodes if 'partitioned', else for 0 threads the default pool (nullptr).
+// Neither budget is rebuilt from one proof to the next. The calling thread is
+// pinned to the budget until release().
+class ProofPool
+{
+    std::unique_lock<std::mutex> controlLock;
+    ThreadBudget *budget;
+    ThreadBudget::CallerPin pin;
+
+    static ThreadBudget *
+    select(std::unique_lock<std::mutex> &controlLock, std::unique_ptr<ThreadBudget> &budget,
+           unsigned int threads, bool partitioned, ProveControl *control)
+    {
+        ThreadBudget *controlBudget = control != nullptr ? control->lockBudget(controlLock) : nullptr;
+
+        if (controlBudget != nullptr) {
+            return controlBudget;
+        }
+
+        if (threads > 0 && !budget) {
+            budget.reset(new ThreadBudget(threads, partitioned));
+        }
+
+        return budget.get();
+    }
+
+public:
+    ProofPool(std::unique_ptr<ThreadBudget> &objectBudget, unsigned int threads, bool partitioned,
+              ProveControl *control)
+        : budget(select(controlLock, objectBudget, threads, partitioned, control)),
+          pin(budget)
+    {
+    }
+
+    ThreadPool *threadPool() { return budget != nullptr ? &budget->threadPool() : nullptr; }
+
+    void release()
+    {
+        pin.restore();
+        if (controlLock.owns_lock()) {
+            controlLock.unlock();
+        }
+    }
+};
+
 static void
 CheckAndUpdateBufferSizes(
     unsigned long long   proofCalcSize,
@@ -140,20 +268,246 @@ CheckAndUpdateBufferSizes(
     }
 }
 
+// Shared by the single proof functions taking other inputs than a wtns
+// buffer: checks the output buffers around 'prove', which fills the strings
+template <class ProverT, class ProveFn>
+static void
+ProveToBuffers(
+    ProverT             *prover,
+    char                *proof_buffer,
+    unsigned long long  *proof_size,
+    char                *public_buffer,
+    unsigned long long  *public_size,
+    ProveFn              prove)
+{
+    if (proof_buffer == NULL) {
+        throw std::invalid_argument("Null proof buffer");
+    }
+
+    if (proof_size == NULL) {
+        throw std::invalid_argument("Null proof size");
+    }
+
+    if (public_buffer == NULL) {
+        throw std::invalid_argument("Null public buffer");
+    }
+
+    if (public_size == NULL) {
+        throw std::invalid_argument("Null public size");
+    }
+
+    CheckAndUpdateBufferSizes(prover->proofBufferMinSize(), proof_size,
+                              prover->publicBufferMinSize(), public_size,
+                              "Minimum");
+
+    std::string stringProof;
+    std::string stringPublic;
+
+    prove(stringProof, stringPublic);
+
+    CheckAndUpdateBufferSizes(stringProof.length(), proof_size,
+                              stringPublic.length(), public_size,
+                              "Required");
+
+    std::strncpy(proof_buffer, stringProof.c_str(), *proof_size);
+    std::strncpy(public_buffer, stringPublic.c_str(), *public_size);
+}
+
+// Same for the *_prove_binary functions. The binary sizes are exact, so they
+// are checked before proving; on return, or on a short buffer, the sizes hold
+// the bytes required.
+template <class ProverT, class ProveFn>
+static void
+ProveToBinaryBuffers(
+    ProverT             *prover,
+    void                *proof_buffer,
+    unsigned long long  *proof_size,
+    void                *public_buffer,
+    unsigned long long  *public_size,
+    ProveFn              prove)
+{
+    if (proof_buffer == NULL) {
+        throw std::invalid_argument("Null proof buffer");
+    }
+
+    if (proof_size == NULL) {
+        throw std::invalid_argument("Null proof size");
+    }
+
+    if (public_buffer == NULL) {
+        throw std::invalid_argument("Null public buffer");
+    }
+
+    if (public_size == NULL) {
+        throw std::invalid_argument("Null public size");
+    }
+
+    try {
+        CheckAndUpdateBufferSizes(prover->proofBinarySize(), proof_size,
+                                  prover->publicBinarySize(), public_size,
+                                  "Required");
+
+    } catch (ShortBufferException&) {
+        *proof_size = prover->proofBinarySize();
+        *public_size = prover->publicBinarySize();
+        throw;
+    }
+
+    std::string binProof;
+    std::string binPublic;
+
+    prove(binProof, binPublic);
+
+    std::memcpy(proof_buffer, binProof.data(), binProof.size());
+    std::memcpy(public_buffer, binPublic.data(), binPublic.size());
+
+    *proof_size = binProof.size();
+    *public_size = binPublic.size();
+}
+
+// Shared by the *_prover_prove_batch functions; fills all outputs or none.
+// A null 'control' leaves the prover object's in effect.
+template <class ProverT>
+static void
+ProveBatch(
+    ProverT                   *prover,
+    ProveControl              *control,
+    unsigned long long         count,
+    const void *const         *wtns_buffers,
+    const unsigned long long  *wtns_sizes,
+    char                     **proof_buffers,
+    unsigned long long        *proof_sizes,
+    char                     **public_buffers,
+    unsigned long long        *public_sizes)
+{
+    if (count == 0) {
+        return;
+    }
+
+    if (wtns_buffers == NULL || wtns_sizes == NULL) {
+        throw std::invalid_argument("Null witness buffers");
+    }
+
+    if (proof_buffers == NULL || proof_sizes == NULL) {
+        throw std::invalid_argument("Null proof buffers");
+    }
+
+    if (public_buffers == NULL || public_sizes == NULL) {
+        throw std::invalid_argument("Null public buffers");
+    }
+
+    for (unsigned long long k = 0; k < count; k++) {
+        if (wtns_buffers[k] == NULL || proof_buffers[k] == NULL || public_buffers[k] == NULL) {
+            throw std::invalid_argument("Null buffer for witness " + std::to_string(k));
+        }
+
+        CheckAndUpdateBufferSizes(prover->proofBufferMinSize(), &proof_sizes[k],
+                                  prover->publicBufferMinSize(), &public_sizes[k],
+                                  "Witness " + std::to_string(k) + " minimum");
+    }
+
+    std::vector<std::string> stringProofs;
+    std::vector<std::string> stringPublics;
+
+    prover->proveBatch(count, wtns_buffers, wtns_sizes, stringProofs, stringPublics, control);
+
+    for (unsigned long long k = 0; k < count; k++) {
+        CheckAndUpdateBufferSizes(stringProofs[k].length(), &proof_sizes[k],
+                                  stringPublics[k].length(), &public_sizes[k],
+                                  "Witness " + std::to_string(k) + " required");
+    }
+
+    for (unsigned long long k = 0; k < count; k++) {
+        std::strncpy(proof_buffers[k], stringProofs[k].c_str(), proof_sizes[k]);
+        std::strncpy(public_buffers[k], stringPublics[k].c_str(), public_sizes[k]);
+    }
+}
+
+// Shared by the *_prover_prove_async functions; runs on the ProveQueue worker
+// of the prover object.
+// A null 'control' leaves the prover object's in effect.
+template <class ProverT>
+static void
+ProveAsync(
+    ProverT                     *prover,
+    ProveControl                *control,
+    const void                  *wtns_buffer,
+    unsigned long long           wtns_size,
+    prover_completion_callback   callback,
+    void                        *user_data)
+{
+    if (wtns_buffer == NULL) {
+        throw std::invalid_argument("Null witness buffer");
+    }
+
+    if (callback == NULL) {
+        throw std::invalid_argument("Null callback");
+    }
+
+    prover->asyncQueue().enqueue(prover, [=] () {
+        std::string stringProof;
+        std::string stringPublic;
+        std::string error;
+        int status = PROVER_OK;
+
+        try {
+            prover->prove(wtns_buffer, wtns_size, stringProof, stringPublic, OUTPUT_JSON, control);
+
+        } catch(InvalidWitnessLengthException& e) {
+            error = e.what();
+            status = PROVER_INVALID_WITNESS_LENGTH;
+
+        } catch(ProveCancelled& e) {
+            error = e.what();
+            status = PROVER_ERROR_CANCELLED;
+
+        } catch (std::exception& e) {
+            error = e.what();
+            status = PROVER_ERROR;
+
+        } catch (std::exception *e) {
+            error = e->what();
+            delete e;
+            status = PROVER_ERROR;
+
+        } catch (...) {
+            error = "unknown error";
+            status = PROVER_ERROR;
+        }
+
+        if (status == PROVER_OK) {
+            callback(user_data, status, stringProof.c_str(), stringProof.length(),
+                     stringPublic.c_str(), stringPublic.length(), NULL);
+        } else {
+            callback(user_data, status, NULL, 0, NULL, 0, error.c_str());
+        }
+    });
+}
 
 class Groth16Prover
 {
+    // Set when the prover owns the mapping that zkey points into
+    std::unique_ptr<BinFileUtils::FileLoader> zkeyLoader;
     BinFileUtils::BinFile zkey;
     std::unique_ptr<ZKeyUtils::Header> zkeyHeader;
     std::unique_ptr<Groth16::Prover<AltBn128::Engine>> prover;
-
-public:
-    Groth16Prover(
-        const void         *zkey_buffer,
-        unsigned long long  zkey_size
-    ):
-        zkey(zkey_buffer, zkey_size, "zkey", 1),
-        zkeyHeader(ZKeyUtils::loadHeader(&zkey))
+    // Polled by the proofs that are not given a control of their own, if
+    // set; owned by the caller
+    ProveControl *control = nullptr;
+    // Threads of the proofs, 0 for the default pool
+    unsigned int threads = 0;
+    std::unique_ptr<ThreadBudget> budget;
+    // Set for LOAD_NUMA_PARTITION, whose budget spreads over the nodes
+    bool partitioned = false;
+    // Set on the first asynchronous proof with a budget; 'queueMutex' guards
+    // it and, with 'mutex', 'threads'
+    std::unique_ptr<ProveQueue> queue;
+    std::mutex queueMutex;
+    // Held while the prover computes a proof and while its settings change:
+    // calls on one object from several threads run their proofs in turn
+    std::mutex mutex;
+
+    void init()
     {
         if (!PrimeIsValid(zkeyHeader->rPrime)) {
             throw std::invalid_argument("zkey curve not supported");
@@ -176,15 +530,44 @@ public:
             zkey.getSectionData(8),    // pointsC
             zkey.getSectionData(9)     // pointsH1
         );
+
+        if (zkeyLoader && (zkeyLoader->loadFlags() & BinFileUtils::FileLoader::LOAD_NUMA_PARTITION)) {
+            std::vector<std::pair<const void *, uint64_t>> sections;
+
+            for (uint32_t id = 5; id <= 9; id++) {
+                sections.emplace_back(zkey.getSectionData(id), zkey.getSectionSize(id));
+            }
+            PartitionPoints(sections);
+            partitioned = true;
+        }
     }
 
-    void prove(
-        const void         *wtns_buffer,
-        unsigned long long  wtns_size,
-        std::string        &stringProof,
-        std::string        &stringPublic
+public:
+    Groth16Prover(
+        const void         *zkey_buffer,
+        unsigned long long  zkey_size
+    ):
+        zkey(zkey_buffer, zkey_size, "zkey", 1),
+        zkeyHeader(ZKeyUtils::loadHeader(&zkey))
+    {
+        init();
+    }
+
+    Groth16Prover(
+        std::unique_ptr<BinFileUtils::FileLoader> loader
+    ):
+        zkeyLoader(std::move(loader)),
+        zkey(zkeyLoader->dataBuffer(), zkeyLoader->dataSize(), "zkey", 1),
+        zkeyHeader(ZKeyUtils::loadHeader(&zkey))
+    {
+        init();
+    }
+
+    // Plain witnesses are used in place, compact ones are decoded into 'decoded'
+    AltBn128::FrElement *loadWitness(
+        BinFileUtils::BinFile             &wtns,
+        std::vector<AltBn128::FrElement>  &decoded
     ) {
-        BinFileUtils::BinFile wtns(wtns_buffer, wtns_size, "wtns", 2);
         auto wtnsHeader = WtnsUtils::loadHeader(&wtns);
 
         if (zkeyHeader->nVars != wtnsHeader->nVars) {
@@ -198,12 +581,181 @@ public:
             throw std::invalid_argument("different wtns curve");
         }
 
-        AltBn128::FrElement *wtnsData = (AltBn128::FrElement *)wtns.getSectionData(2);
+        if (WtnsUtils::isCompact(&wtns)) {
+            decoded.resize(zkeyHeader->nVars);
+            WtnsUtils::loadSignals(&wtns, *wtnsHeader, decoded.data());
+            return decoded.data();
+        }
+
+        return (AltBn128::FrElement *)wtns.getSectionData(2);
+    }
+
+    void prove(
+        const void         *wtns_buffer,
+        unsigned long long  wtns_size,
+        std::string        &stringProof,
+        std::string        &stringPublic,
+        OutputFormat        format = OUTPUT_JSON,
+        ProveControl       *callControl = nullptr
+    ) {
+        BinFileUtils::BinFile wtns(wtns_buffer, wtns_size, "wtns", WtnsUtils::COMPACT_VERSION);
+        std::vector<AltBn128::FrElement> decoded;
+
+        proveSignals(loadWitness(wtns, decoded), zkeyHeader->nVars, stringProof, stringPublic, format, callControl);
+    }
+
+    // The file is mapped, a plain witness is used in place
+    void proveWtnsFile(
+        const std::string  &wtnsFileName,
+        std::string        &stringProof,
+        std::string        &stringPublic
+    ) {
+        BinFileUtils::FileLoader loader(wtnsFileName);
+        BinFileUtils::BinFile wtns(loader.dataBuffer(), loader.dataSize(), "wtns", WtnsUtils::COMPACT_VERSION);
+        std::vector<AltBn128::FrElement> decoded;
+
+        proveSignals(loadWitness(wtns, decoded), zkeyHeader->nVars, stringProof, stringPublic);
+    }
+
+    void proveSignals(
+        AltBn128::FrElement  *signals,
+        unsigned long long    signalsCount,
+        std::string          &stringProof,
+        std::string          &stringPublic,
+        OutputFormat          format = OUTPUT_JSON,
+        ProveControl         *callControl = nullptr
+    ) {
+        if (signalsCount != zkeyHeader->nVars) {
+            throw InvalidWitnessLengthException("Invalid witness length. Circuit: "
+                                        + std::to_string(zkeyHeader->nVars)
+                                        + ", witness: "
+                                        + std::to_string(signalsCount));
+        }
 
-        auto proof = prover->prove(wtnsData);
+        std::unique_lock<std::mutex> lock(mutex);
+        ProveControl *proofControl = callControl != nullptr ? callControl : control;
+        ProofPool pool(budget, threads, partitioned, proofControl);
+        prover->set_thread_pool(pool.threadPool());
+        auto proof = prover->prove(signals, proofControl);
+        pool.release();
+        lock.unlock();
+
+        if (format == OUTPUT_BINARY) {
+            stringProof.resize(proof->EVM_SIZE);
+            proof->toEvm((uint8_t *)&stringProof[0]);
+            stringPublic = BuildPublicBinary(signals, zkeyHeader->nPublic, 0);
+            return;
+        }
 
         stringProof = proof->toJson().dump();
-        stringPublic = BuildPublicString(wtnsData, zkeyHeader->nPublic);
+        stringPublic = BuildPublicString(signals, zkeyHeader->nPublic);
+    }
+
+    void proveBatch(
+        unsigned long long                 count,
+        const void *const                 *wtns_buffers,
+        const unsigned long long          *wtns_sizes,
+        std::vector<std::string>          &stringProofs,
+        std::vector<std::string>          &stringPublics,
+        ProveControl                      *callControl = nullptr
+    ) {
+        std::vector<std::unique_ptr<BinFileUtils::BinFile>> files;
+        std::vector<std::vector<AltBn128::FrElement>> decoded(count);
+        std::vector<AltBn128::FrElement *> wtnsData(count);
+
+        for (unsigned long long k = 0; k < count; k++) {
+            try {
+                files.emplace_back(new BinFileUtils::BinFile(wtns_buffers[k], wtns_sizes[k], "wtns", WtnsUtils::COMPACT_VERSION));
+                wtnsData[k] = loadWitness(*files[k], decoded[k]);
+
+            } catch (InvalidWitnessLengthException& e) {
+                throw InvalidWitnessLengthException("Witness " + std::to_string(k) + ": " + e.what());
+
+            } catch (std::invalid_argument& e) {
+                throw std::invalid_argument("Witness " + std::to_string(k) + ": " + e.what());
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        ProveControl *proofControl = callControl != nullptr ? callControl : control;
+        ProofPool pool(budget, threads, partitioned, proofControl);
+        prover->set_thread_pool(pool.threadPool());
+        auto proofs = prover->prove_batch(wtnsData, proofControl);
+        pool.release();
+        lock.unlock();
+
+        for (unsigned long long k = 0; k < count; k++) {
+            stringProofs.push_back(proofs[k]->toJson().dump());
+            stringPublics.push_back(BuildPublicString(wtnsData[k], zkeyHeader->nPublic));
+        }
+    }
+
+    // Reads only the verification key, so it does not wait for the proofs
+    std::string rerandomize(const char *proof)
+    {
+        Groth16::Proof<AltBn128::Engine> input(AltBn128::Engine::engine);
+
+        input.fromJson(json::parse(proof));
+
+        return prover->rerandomize(input)->toJson().dump();
+    }
+
+    // A null buffer drops the base witness
+    void setBaseWitness(
+        const void         *wtns_buffer,
+        unsigned long long  wtns_size
+    ) {
+        if (wtns_buffer == nullptr) {
+            std::lock_guard<std::mutex> guard(mutex);
+            prover->set_base_witness(nullptr);
+            return;
+        }
+
+        BinFileUtils::BinFile wtns(wtns_buffer, wtns_size, "wtns", WtnsUtils::COMPACT_VERSION);
+        std::vector<AltBn128::FrElement> decoded;
+        AltBn128::FrElement *signals = loadWitness(wtns, decoded);
+
+        std::lock_guard<std::mutex> guard(mutex);
+        ProofPool pool(budget, threads, partitioned, control);
+        prover->set_thread_pool(pool.threadPool());
+        prover->set_base_witness(signals);
+    }
+
+    void setControl(ProveControl *_control) {
+        std::lock_guard<std::mutex> guard(mutex);
+        control = _control;
+    }
+
+    void setThreads(unsigned int _threads) {
+        std::lock_guard<std::mutex> guard(mutex);
+        std::lock_guard<std::mutex> queueGuard(queueMutex);
+
+        if (_threads != threads) {
+            budget.reset();
+        }
+        threads = _threads;
+    }
+
+    // Queue of the asynchronous proofs: once the object has a budget, a
+    // worker of its own, so that they run alongside those of other objects
+    ProveQueue &asyncQueue() {
+        std::lock_guard<std::mutex> guard(queueMutex);
+
+        if (threads == 0) {
+            return ProveQueue::instance();
+        }
+        if (!queue) {
+            queue.reset(new ProveQueue());
+        }
+        return *queue;
+    }
+
+    // Waits for the asynchronous proofs of the object
+    void drainAsync() {
+        ProveQueue::instance().drain(this);
+        if (queue) {
+            queue->drain(this);
+        }
     }
 
     unsigned long long proofBufferMinSize() const {
@@ -213,28 +765,83 @@ public:
     unsigned long long publicBufferMinSize() const {
         return PublicBufferMinSize(zkeyHeader->nPublic);
     }
+
+    unsigned long long proofBinarySize() const {
+        return Groth16::Proof<AltBn128::Engine>::EVM_SIZE;
+    }
+
+    unsigned long long publicBinarySize() const {
+        return (unsigned long long)zkeyHeader->nPublic * sizeof(AltBn128::FrElement);
+    }
 };
 
 
 class UltraGrothProver
 {
+    // Set when the prover owns the mapping that zkey points into
+    std::unique_ptr<BinFileUtils::FileLoader> zkeyLoader;
     BinFileUtils::BinFile zkey;
     std::unique_ptr<ZKeyUtils::UltraGrothHeader> zkeyHeader;
+    std::unique_ptr<ZKeyUtils::PreparedCoefs> preparedCoefs;
+    // Point sections that the prepared zkey stores compressed, expanded into
+    // expandedStorage or, with LOAD_SHARED, into the shared segment
+    ZKeyUtils::PointSections expandedPoints;
+    std::vector<uint8_t> expandedStorage;
+    // Set for out-of-core MSMs; outlives the prover that points to it
+    std::unique_ptr<BinFileUtils::SectionStreamer> streamer;
     std::unique_ptr<UltraGroth::Prover<AltBn128::Engine>> prover;
+    // Polled by the proofs that are not given a control of their own, if
+    // set; owned by the caller
+    ProveControl *control = nullptr;
+    // Threads of the proofs, 0 for the default pool
+    unsigned int threads = 0;
+    std::unique_ptr<ThreadBudget> budget;
+    // Set for LOAD_NUMA_PARTITION, whose budget spreads over the nodes
+    bool partitioned = false;
+    // Set on the first asynchronous proof with a budget; 'queueMutex' guards
+    // it and, with 'mutex', 'threads'
+    std::unique_ptr<ProveQueue> queue;
+    std::mutex queueMutex;
+    // Held while the prover computes a proof and while its settings change:
+    // calls on one object from several threads run their proofs in turn
+    std::mutex mutex;
+
+    void *pointSection(uint32_t id)
+    {
+        auto it = expandedPoints.find(id);
 
-public:
-    UltraGrothProver(
-        const void         *zkey_buffer,
-        unsigned long long  zkey_size
-    ):
-        zkey(zkey_buffer, zkey_size, "zkey", 1),
-        zkeyHeader(ZKeyUtils::ultra_groth_loadHeader(&zkey))
+        return it != expandedPoints.end() ? (void *)it->second.data : zkey.getSectionData(id);
+    }
+
+    uint64_t pointSectionSize(uint32_t id)
+    {
+        auto it = expandedPoints.find(id);
+
+        return it != expandedPoints.end() ? it->second.size : zkey.getSectionSize(id);
+    }
+
+    void init(bool prepared)
     {
         if (!PrimeIsValid(zkeyHeader->rPrime)) {
             throw std::invalid_argument("zkey curve not supported");
         }
 
-         prover = UltraGroth::makeProver<AltBn128::Engine>(
+        if (prepared) {
+            const uint8_t *expanded = nullptr;
+
+            // Expanded once by the process that filled the shared segment
+            if (zkeyLoader && zkeyLoader->sharedExtra() != nullptr) {
+                expanded = (const uint8_t *)zkeyLoader->sharedExtra();
+            } else {
+                expandedStorage.resize(ZKeyUtils::expandedPointsSize(&zkey));
+                ZKeyUtils::expandPreparedPoints(&zkey, expandedStorage.data());
+                expanded = expandedStorage.data();
+            }
+
+            expandedPoints = ZKeyUtils::expandedPointSections(&zkey, expanded);
+        }
+
+        prover = UltraGroth::makeProver<AltBn128::Engine>(
             zkeyHeader->nVars,
             zkeyHeader->nPublic,
             zkeyHeader->domainSize,
@@ -250,28 +857,93 @@ public:
             zkeyHeader->final_delta1,  // final delta 1
             zkeyHeader->final_delta2,  // final delta 2
             zkeyHeader->round_delta1,  // round delta 1
-            zkey.getSectionData(4),    // Coefs
-            zkey.getSectionData(5),    // pointsA
-            zkey.getSectionData(6),    // pointsB1
-            zkey.getSectionData(7),    // pointsB2
-            zkey.getSectionData(9),    // final points C
-            zkey.getSectionData(8),    // round points C
-            zkey.getSectionData(12)    // pointsH1
+            prepared ? nullptr : zkey.getSectionData(4),    // Coefs
+            pointSection(5),           // pointsA
+            pointSection(6),           // pointsB1
+            pointSection(7),           // pointsB2
+            pointSection(9),           // final points C
+            pointSection(8),           // round points C
+            pointSection(12)           // pointsH1
         );
-    }
 
-    void prove(
-        const void         *wtns_buffer,
-        unsigned long long  wtns_size,
-        std::string        &stringProof,
-        std::string        &stringPublic
-    ) {
-        BinFileUtils::BinFile wtns(wtns_buffer, wtns_size, "wtns", 2);
-        auto wtnsHeader = WtnsUtils::loadHeader(&wtns);
+        // The prover never reads these; keep faults in them from reading ahead
+        zkey.adviseSection(3, MADV_RANDOM);    // IC
+        zkey.adviseSection(13, MADV_RANDOM);   // contributions
 
-        if (zkeyHeader->nVars != wtnsHeader->nVars) {
-            throw InvalidWitnessLengthException("Invalid witness length. Circuit: "
-                                        + std::to_string(zkeyHeader->nVars)
+        if (zkeyLoader && (zkeyLoader->loadFlags() & BinFileUtils::FileLoader::LOAD_NUMA_PARTITION)) {
+            std::vector<std::pair<const void *, uint64_t>> sections;
+
+            for (uint32_t id : {5, 6, 7, 8, 9, 12}) {
+                sections.emplace_back(pointSection(id), pointSectionSize(id));
+            }
+            PartitionPoints(sections);
+            partitioned = true;
+        }
+
+        if (prepared) {
+            preparedCoefs = ZKeyUtils::loadPreparedCoefs(&zkey, zkeyHeader->domainSize, zkeyHeader->n8r);
+
+            UltraGroth::CoefMatrix<AltBn128::Engine> a = {
+                preparedCoefs->a.rows,
+                preparedCoefs->a.signals,
+                (const AltBn128::FrElement *)preparedCoefs->a.values
+            };
+            UltraGroth::CoefMatrix<AltBn128::Engine> b = {
+                preparedCoefs->b.rows,
+                preparedCoefs->b.signals,
+                (const AltBn128::FrElement *)preparedCoefs->b.values
+            };
+
+            prover->set_prepared_coefs(a, b);
+        }
+    }
+
+public:
+    UltraGrothProver(
+        const void         *zkey_buffer,
+        unsigned long long  zkey_size
+    ):
+        zkey(zkey_buffer, zkey_size,
+             UltraGrothZKeyType(zkey_buffer, zkey_size),
+             UltraGrothZKeyVersion(zkey_buffer, zkey_size)),
+        zkeyHeader(ZKeyUtils::ultra_groth_loadHeader(&zkey))
+    {
+        init(ZKeyUtils::isPrepared(zkey_buffer, zkey_size));
+    }
+
+    UltraGrothProver(
+        std::unique_ptr<BinFileUtils::FileLoader> loader
+    ):
+        zkeyLoader(std::move(loader)),
+        zkey(zkeyLoader->dataBuffer(), zkeyLoader->dataSize(),
+             UltraGrothZKeyType(zkeyLoader->dataBuffer(), zkeyLoader->dataSize()),
+             UltraGrothZKeyVersion(zkeyLoader->dataBuffer(), zkeyLoader->dataSize())),
+        zkeyHeader(ZKeyUtils::ultra_groth_loadHeader(&zkey))
+    {
+        init(ZKeyUtils::isPrepared(zkeyLoader->dataBuffer(), zkeyLoader->dataSize()));
+    }
+
+    // Decodes the signals of 'wtns' into 'signals', nVars elements; the lookup
+    // info points into 'wtns'
+    UltraGroth::LookupInfo loadWitness(
+        BinFileUtils::BinFile  &wtns,
+        AltBn128::FrElement    *signals
+    ) {
+        auto wtnsHeader = checkWitness(wtns);
+
+        // Can't modify values on pointer from wtns.getSectionData(2) so I copy it to another
+        WtnsUtils::loadSignals(&wtns, *wtnsHeader, signals);
+
+        return lookupInfoOf(wtns);
+    }
+
+    std::unique_ptr<WtnsUtils::Header> checkWitness(BinFileUtils::BinFile &wtns)
+    {
+        auto wtnsHeader = WtnsUtils::loadHeader(&wtns);
+
+        if (zkeyHeader->nVars != wtnsHeader->nVars) {
+            throw InvalidWitnessLengthException("Invalid witness length. Circuit: "
+                                        + std::to_string(zkeyHeader->nVars)
                                         + ", witness: "
                                         + std::to_string(wtnsHeader->nVars));
         }
@@ -280,23 +952,324 @@ public:
             throw std::invalid_argument("different wtns curve");
         }
 
-        AltBn128::FrElement* signals = new AltBn128::FrElement[zkeyHeader->nVars];
-        // Can't modify values on pointer from wtns.getSectionData(2) so I copy it to another
-        memcpy(signals, wtns.getSectionData(2), wtns.getSectionSize(2));
+        return wtnsHeader;
+    }
 
-        UltraGroth::LookupInfo lookupInfo = UltraGroth::LookupInfo(
+    static UltraGroth::LookupInfo lookupInfoOf(BinFileUtils::BinFile &wtns)
+    {
+        return UltraGroth::LookupInfo(
             (uint32_t *)wtns.getSectionData(3), wtns.getSectionSize(3) >> 2,
             (uint32_t *)wtns.getSectionData(4), wtns.getSectionSize(4) >> 2,
             (uint32_t *)wtns.getSectionData(5), wtns.getSectionSize(5) >> 2,
             (uint32_t *)wtns.getSectionData(6), wtns.getSectionSize(6) >> 2
         );
-        
-        auto proof = prover->prove(signals, lookupInfo);
+    }
+
+    void prove(
+        const void         *wtns_buffer,
+        unsigned long long  wtns_size,
+        std::string        &stringProof,
+        std::string        &stringPublic,
+        OutputFormat        format = OUTPUT_JSON,
+        ProveControl       *callControl = nullptr
+    ) {
+        BinFileUtils::BinFile wtns(wtns_buffer, wtns_size, "wtns", WtnsUtils::COMPACT_VERSION);
+        std::vector<AltBn128::FrElement> signals(zkeyHeader->nVars);
+        UltraGroth::LookupInfo lookupInfo = loadWitness(wtns, signals.data());
+
+        proveSignals(signals.data(), zkeyHeader->nVars, lookupInfo, stringProof, stringPublic, format, callControl);
+    }
+
+    // The file is mapped copy-on-write and a plain witness is used in place,
+    // only the pages that receive lookup signals are copied
+    void proveWtnsFile(
+        const std::string  &wtnsFileName,
+        std::string        &stringProof,
+        std::string        &stringPublic
+    ) {
+        BinFileUtils::FileLoader loader(wtnsFileName);
+        BinFileUtils::BinFile wtns(loader.dataBuffer(), loader.dataSize(), "wtns", WtnsUtils::COMPACT_VERSION);
+        auto wtnsHeader = checkWitness(wtns);
+        std::vector<AltBn128::FrElement> decoded;
+        AltBn128::FrElement *signals;
+
+        if (WtnsUtils::isCompact(&wtns)) {
+            decoded.resize(zkeyHeader->nVars);
+            WtnsUtils::loadSignals(&wtns, *wtnsHeader, decoded.data());
+            signals = decoded.data();
+        } else {
+            if (wtns.getSectionSize(2) != (uint64_t)zkeyHeader->nVars * sizeof(AltBn128::FrElement)) {
+                throw std::invalid_argument("Invalid witness section size");
+            }
+            loader.makeWritable();
+            signals = (AltBn128::FrElement *)wtns.getSectionData(2);
+        }
+
+        UltraGroth::LookupInfo lookupInfo = lookupInfoOf(wtns);
+
+        proveSignals(signals, zkeyHeader->nVars, lookupInfo, stringProof, stringPublic);
+    }
+
+    // 'signals' is the witness in place: the prover writes the lookup signals
+    // into it
+    void proveSignals(
+        AltBn128::FrElement     *signals,
+        unsigned long long       signalsCount,
+        UltraGroth::LookupInfo  &lookupInfo,
+        std::string             &stringProof,
+        std::string             &stringPublic,
+        OutputFormat             format = OUTPUT_JSON,
+        ProveControl            *callControl = nullptr
+    ) {
+        if (signalsCount != zkeyHeader->nVars) {
+            throw InvalidWitnessLengthException("Invalid witness length. Circuit: "
+                                        + std::to_string(zkeyHeader->nVars)
+                                        + ", witness: "
+                                        + std::to_string(signalsCount));
+        }
+
+        checkLookupInfo(lookupInfo);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        ProveControl *proofControl = callControl != nullptr ? callControl : control;
+        ProofPool pool(budget, threads, partitioned, proofControl);
+        prover->set_thread_pool(pool.threadPool());
+        auto proof = prover->prove(signals, lookupInfo, proofControl);
+        pool.release();
+        lock.unlock();
+
+        if (format == OUTPUT_BINARY) {
+            stringProof.resize(proof->EVM_SIZE);
+            proof->toEvm((uint8_t *)&stringProof[0]);
+            stringPublic = BuildPublicBinary(signals, zkeyHeader->nPublic, zkeyHeader->rand_indx);
+            return;
+        }
 
         stringProof = proof->toJson().dump();
         stringPublic = BuildPublicStringUltraGroth(signals, zkeyHeader->nPublic, zkeyHeader->rand_indx);
-        
-        delete[] signals;
+    }
+
+    // The lookup indexes are used unchecked by the prover
+    void checkLookupInfo(const UltraGroth::LookupInfo &info)
+    {
+        const uint64_t pushSize = 1 + info.chunks_len + 2 * info.frequencies_len;
+
+        if (info.chunks_len > 0 && info.chunks == nullptr) {
+            throw std::invalid_argument("Null lookup chunks");
+        }
+
+        if (info.frequencies_len > 0 && info.frequencies == nullptr) {
+            throw std::invalid_argument("Null lookup frequencies");
+        }
+
+        if (info.wtns_indxs_len != info.push_indxs_len) {
+            throw std::invalid_argument("Lookup witness and push indexes differ in length");
+        }
+
+        if (info.wtns_indxs_len > 0 && (info.wtns_indxs == nullptr || info.push_indxs == nullptr)) {
+            throw std::invalid_argument("Null lookup indexes");
+        }
+
+        for (uint64_t i = 0; i < info.chunks_len; i++) {
+            if (info.chunks[i] >= info.frequencies_len) {
+                throw std::invalid_argument("Lookup chunk " + std::to_string(i) + " out of the table");
+            }
+        }
+
+        for (uint64_t i = 0; i < info.wtns_indxs_len; i++) {
+            if (info.wtns_indxs[i] >= zkeyHeader->nVars || info.push_indxs[i] >= pushSize) {
+                throw std::invalid_argument("Lookup index " + std::to_string(i) + " out of range");
+            }
+        }
+    }
+
+    void proveBatch(
+        unsigned long long                 count,
+        const void *const                 *wtns_buffers,
+        const unsigned long long          *wtns_sizes,
+        std::vector<std::string>          &stringProofs,
+        std::vector<std::string>          &stringPublics,
+        ProveControl                      *callControl = nullptr
+    ) {
+        std::vector<std::unique_ptr<BinFileUtils::BinFile>> files;
+        std::vector<AltBn128::FrElement> signals(count * zkeyHeader->nVars);
+        std::vector<AltBn128::FrElement *> wtnsData(count);
+        std::vector<UltraGroth::LookupInfo> lookupInfos;
+        std::vector<UltraGroth::LookupInfo *> lookupInfoPtrs(count);
+
+        lookupInfos.reserve(count);
+
+        for (unsigned long long k = 0; k < count; k++) {
+            wtnsData[k] = signals.data() + k * zkeyHeader->nVars;
+
+            try {
+                files.emplace_back(new BinFileUtils::BinFile(wtns_buffers[k], wtns_sizes[k], "wtns", WtnsUtils::COMPACT_VERSION));
+                lookupInfos.push_back(loadWitness(*files[k], wtnsData[k]));
+                checkLookupInfo(lookupInfos.back());
+
+            } catch (InvalidWitnessLengthException& e) {
+                throw InvalidWitnessLengthException("Witness " + std::to_string(k) + ": " + e.what());
+
+            } catch (std::invalid_argument& e) {
+                throw std::invalid_argument("Witness " + std::to_string(k) + ": " + e.what());
+            }
+
+            lookupInfoPtrs[k] = &lookupInfos[k];
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        ProveControl *proofControl = callControl != nullptr ? callControl : control;
+        ProofPool pool(budget, threads, partitioned, proofControl);
+        prover->set_thread_pool(pool.threadPool());
+        auto proofs = prover->prove_batch(wtnsData, lookupInfoPtrs, proofControl);
+        pool.release();
+        lock.unlock();
+
+        for (unsigned long long k = 0; k < count; k++) {
+            stringProofs.push_back(proofs[k]->toJson().dump());
+            stringPublics.push_back(BuildPublicStringUltraGroth(wtnsData[k], zkeyHeader->nPublic, zkeyHeader->rand_indx));
+        }
+    }
+
+    void setMsmMemoryLimit(unsigned long long limit) {
+        if (limit == 0) {
+            prover->set_streamer(nullptr);
+            streamer.reset();
+            return;
+        }
+
+        if (!zkeyLoader) {
+            throw std::invalid_argument("Out-of-core MSMs need a prover created from a zkey file");
+        }
+
+        if (!expandedPoints.empty()) {
+            throw std::invalid_argument("Out-of-core MSMs need a zkey with uncompressed points");
+        }
+
+        if (limit < 2 * sizeof(AltBn128::Engine::G2PointAffine)) {
+            throw std::invalid_argument("MSM memory limit is too small: " + std::to_string(limit));
+        }
+
+        std::unique_ptr<BinFileUtils::SectionStreamer> s(new BinFileUtils::SectionStreamer(
+            zkeyLoader->fileDescriptor(), zkeyLoader->dataBuffer(), limit));
+
+        prover->set_streamer(s.get());
+        streamer = std::move(s);
+    }
+
+    void warmup() {
+        std::lock_guard<std::mutex> guard(mutex);
+
+        ProofPool pool(budget, threads, partitioned, control);
+        prover->set_thread_pool(pool.threadPool());
+        prover->warmup();
+    }
+
+    // Key of the zkey in the validated-key cache: a hash of all of its data,
+    // or if 'fast' the identity of the file it was loaded from, which does
+    // not need the zkey read
+    void validationKey(uint8_t *digest, bool fast) {
+        if (fast && zkeyLoader) {
+            zkeyLoader->fileIdentity(digest);
+        } else {
+            ZKeyUtils::treeHash(digest, zkey.data(), zkey.dataSize());
+        }
+    }
+
+    // Throws ZKeyUtils::InvalidZKey if the zkey is malformed
+    void validate(const char *cachePath, bool fast) {
+        uint8_t digest[32];
+
+        if (cachePath != nullptr) {
+            validationKey(digest, fast);
+
+            if (ZKeyUtils::isValidatedInCache(cachePath, digest)) {
+                return;
+            }
+        }
+
+        ZKeyUtils::validateUltraGrothZKey(&zkey, *zkeyHeader, expandedPoints);
+
+        if (cachePath != nullptr) {
+            ZKeyUtils::addToValidatedCache(cachePath, digest);
+        }
+    }
+
+    // A null buffer drops the base witness
+    void setBaseWitness(
+        const void         *wtns_buffer,
+        unsigned long long  wtns_size
+    ) {
+        if (wtns_buffer == nullptr) {
+            std::lock_guard<std::mutex> guard(mutex);
+            prover->set_base_witness(nullptr, nullptr);
+            return;
+        }
+
+        BinFileUtils::BinFile wtns(wtns_buffer, wtns_size, "wtns", WtnsUtils::COMPACT_VERSION);
+        std::vector<AltBn128::FrElement> signals(zkeyHeader->nVars);
+        UltraGroth::LookupInfo lookupInfo = loadWitness(wtns, signals.data());
+
+        checkLookupInfo(lookupInfo);
+
+        std::lock_guard<std::mutex> guard(mutex);
+        ProofPool pool(budget, threads, partitioned, control);
+        prover->set_thread_pool(pool.threadPool());
+        prover->set_base_witness(signals.data(), &lookupInfo);
+    }
+
+    void setOption(int option, unsigned long long value) {
+        std::lock_guard<std::mutex> guard(mutex);
+
+        switch (option) {
+        case PROVER_OPTION_LOW_MEMORY:
+            prover->set_low_memory(value != 0);
+            break;
+
+        case PROVER_OPTION_MSM_MEMORY_LIMIT:
+            setMsmMemoryLimit(value);
+            break;
+
+        default:
+            throw std::invalid_argument("Unknown prover option: " + std::to_string(option));
+        }
+    }
+
+    void setControl(ProveControl *_control) {
+        std::lock_guard<std::mutex> guard(mutex);
+        control = _control;
+    }
+
+    void setThreads(unsigned int _threads) {
+        std::lock_guard<std::mutex> guard(mutex);
+        std::lock_guard<std::mutex> queueGuard(queueMutex);
+
+        if (_threads != threads) {
+            budget.reset();
+        }
+        threads = _threads;
+    }
+
+    // Queue of the asynchronous proofs: once the object has a budget, a
+    // worker of its own, so that they run alongside those of other objects
+    ProveQueue &asyncQueue() {
+        std::lock_guard<std::mutex> guard(queueMutex);
+
+        if (threads == 0) {
+            return ProveQueue::instance();
+        }
+        if (!queue) {
+            queue.reset(new ProveQueue());
+        }
+        return *queue;
+    }
+
+    // Waits for the asynchronous proofs of the object
+    void drainAsync() {
+        ProveQueue::instance().drain(this);
+        if (queue) {
+            queue->drain(this);
+        }
     }
 
     unsigned long long proofBufferMinSize() const {
@@ -306,20 +1279,1255 @@ public:
     unsigned long long publicBufferMinSize() const {
         return PublicBufferMinSize((zkeyHeader->nPublic) - 1);
     }
+
+    unsigned long long proofBinarySize() const {
+        return UltraGroth::Proof<AltBn128::Engine>::EVM_SIZE;
+    }
+
+    unsigned long long publicBinarySize() const {
+        const bool skipped = zkeyHeader->rand_indx >= 1 && zkeyHeader->rand_indx <= zkeyHeader->nPublic;
+
+        return (unsigned long long)(zkeyHeader->nPublic - (skipped ? 1 : 0)) * sizeof(AltBn128::FrElement);
+    }
 };
 
-int
-groth16_public_size_for_zkey_file(
-    const char          *zkey_fname,
-    unsigned long long  *public_size,
-    char                *error_msg,
-    unsigned long long   error_msg_maxsize
-) {
-    try {
-        auto zkey = BinFileUtils::openExisting(zkey_fname, "zkey", 1);
-        auto zkeyHeader = ZKeyUtils::loadHeader(zkey.get());
+int
+groth16_public_size_for_zkey_file(
+    const char          *zkey_fname,
+    unsigned long long  *public_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+) {
+    try {
+        auto zkey = BinFileUtils::openExisting(zkey_fname, "zkey", 1);
+        auto zkeyHeader = ZKeyUtils::loadHeader(zkey.get());
+
+        *public_size = PublicBufferMinSize(zkeyHeader->nPublic);
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+int
+ultra_groth_public_size_for_zkey_file(
+    const char          *zkey_fname,
+    unsigned long long  *public_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+) {
+    try {
+        BinFileUtils::FileLoader loader(zkey_fname);
+        BinFileUtils::BinFile zkey(loader.dataBuffer(), loader.dataSize(),
+                                   UltraGrothZKeyType(loader.dataBuffer(), loader.dataSize()),
+                                   UltraGrothZKeyVersion(loader.dataBuffer(), loader.dataSize()));
+        auto zkeyHeader = ZKeyUtils::ultra_groth_loadHeader(&zkey);
+
+        *public_size = PublicBufferMinSize(zkeyHeader->nPublic);
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+void
+groth16_proof_size(
+    unsigned long long *proof_size
+) {
+    *proof_size = ProofBufferMinSize();
+}
+void
+ultra_groth_proof_size(
+    unsigned long long *proof_size
+) {
+    *proof_size = ProofBufferMinSizeUltraGroth();
+}
+
+void
+groth16_proof_binary_size(
+    unsigned long long *proof_size
+) {
+    *proof_size = Groth16::Proof<AltBn128::Engine>::EVM_SIZE;
+}
+void
+ultra_groth_proof_binary_size(
+    unsigned long long *proof_size
+) {
+    *proof_size = UltraGroth::Proof<AltBn128::Engine>::EVM_SIZE;
+}
+
+int
+groth16_prover_create(
+    void                **prover_object,
+    const void          *zkey_buffer,
+    unsigned long long   zkey_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+) {
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        if (zkey_buffer == NULL) {
+            throw std::invalid_argument("Null zkey buffer");
+        }
+
+        Groth16Prover *prover = new Groth16Prover(zkey_buffer, zkey_size);
+
+        *prover_object = prover;
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (std::exception *e) {
+        CopyError(error_msg, error_msg_maxsize, *e);
+        delete e;
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+ultra_groth_prover_create(
+    void                **prover_object,
+    const void          *zkey_buffer,
+    unsigned long long   zkey_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+) {
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        if (zkey_buffer == NULL) {
+            throw std::invalid_argument("Null zkey buffer");
+        }
+
+        UltraGrothProver *prover = new UltraGrothProver(zkey_buffer, zkey_size);
+
+        *prover_object = prover;
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (std::exception *e) {
+        CopyError(error_msg, error_msg_maxsize, *e);
+        delete e;
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+groth16_prover_create_zkey_file(
+    void                **prover_object,
+    const char          *zkey_file_path,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+) {
+    return groth16_prover_create_zkey_file_flags(prover_object, zkey_file_path, 0, error_msg, error_msg_maxsize);
+}
+
+int
+groth16_prover_create_zkey_file_flags(
+    void                **prover_object,
+    const char          *zkey_file_path,
+    unsigned int         load_flags,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+) {
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        if (load_flags & ~PROVER_LOAD_ALL) {
+            throw std::invalid_argument("Unknown load flags: " + std::to_string(load_flags));
+        }
+
+        // The prover keeps the file loaded for as long as it lives
+        std::unique_ptr<BinFileUtils::FileLoader> loader(new BinFileUtils::FileLoader(zkey_file_path, load_flags,
+                                                                                      &ZKeyUtils::zkeySharedSegment()));
+
+        Groth16Prover *prover = new Groth16Prover(std::move(loader));
+
+        *prover_object = prover;
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (std::exception *e) {
+        CopyError(error_msg, error_msg_maxsize, *e);
+        delete e;
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+ultra_groth_prover_create_zkey_file(
+    void                **prover_object,
+    const char          *zkey_file_path,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+) {
+    return ultra_groth_prover_create_zkey_file_flags(prover_object, zkey_file_path, 0, error_msg, error_msg_maxsize);
+}
+
+int
+ultra_groth_prover_create_zkey_file_flags(
+    void                **prover_object,
+    const char          *zkey_file_path,
+    unsigned int         load_flags,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+) {
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        if (load_flags & ~PROVER_LOAD_ALL) {
+            throw std::invalid_argument("Unknown load flags: " + std::to_string(load_flags));
+        }
+
+        // The prover keeps the file loaded for as long as it lives
+        std::unique_ptr<BinFileUtils::FileLoader> loader(new BinFileUtils::FileLoader(zkey_file_path, load_flags,
+                                                                                      &ZKeyUtils::zkeySharedSegment()));
+
+        UltraGrothProver *prover = new UltraGrothProver(std::move(loader));
+
+        *prover_object = prover;
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (std::exception *e) {
+        CopyError(error_msg, error_msg_maxsize, *e);
+        delete e;
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+groth16_prover_prove(
+    void                *prover_object,
+    const void          *wtns_buffer,
+    unsigned long long   wtns_size,
+    char                *proof_buffer,
+    unsigned long long  *proof_size,
+    char                *public_buffer,
+    unsigned long long  *public_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize)
+{
+    return groth16_prover_prove_control(prover_object, NULL, wtns_buffer, wtns_size, proof_buffer,
+                                        proof_size, public_buffer, public_size, error_msg,
+                                        error_msg_maxsize);
+}
+
+int
+groth16_prover_prove_control(
+    void                *prover_object,
+    void                *control,
+    const void          *wtns_buffer,
+    unsigned long long   wtns_size,
+    char                *proof_buffer,
+    unsigned long long  *proof_size,
+    char                *public_buffer,
+    unsigned long long  *public_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        if (wtns_buffer == NULL) {
+            throw std::invalid_argument("Null witness buffer");
+        }
+
+        if (proof_buffer == NULL) {
+            throw std::invalid_argument("Null proof buffer");
+        }
+
+        if (proof_size == NULL) {
+            throw std::invalid_argument("Null proof size");
+        }
+
+        if (public_buffer == NULL) {
+            throw std::invalid_argument("Null public buffer");
+        }
+
+        if (public_size == NULL) {
+            throw std::invalid_argument("Null public size");
+        }
+
+        Groth16Prover *prover = static_cast<Groth16Prover*>(prover_object);
+
+        CheckAndUpdateBufferSizes(prover->proofBufferMinSize(), proof_size,
+                                  prover->publicBufferMinSize(), public_size,
+                                  "Minimum");
+
+        std::string stringProof;
+        std::string stringPublic;
+
+        prover->prove(wtns_buffer, wtns_size, stringProof, stringPublic, OUTPUT_JSON,
+                      static_cast<ProveControl*>(control));
+
+        CheckAndUpdateBufferSizes(stringProof.length(), proof_size,
+                                  stringPublic.length(), public_size,
+                                  "Required");
+
+        std::strncpy(proof_buffer, stringProof.c_str(), *proof_size);
+        std::strncpy(public_buffer, stringPublic.c_str(), *public_size);
+
+    } catch(InvalidWitnessLengthException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_INVALID_WITNESS_LENGTH;
+
+    } catch(ShortBufferException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_SHORT_BUFFER;
+
+    } catch(ProveCancelled& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_CANCELLED;
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (std::exception *e) {
+        CopyError(error_msg, error_msg_maxsize, *e);
+        delete e;
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+int
+ultra_groth_prover_prove(
+    void                *prover_object,
+    const void          *wtns_buffer,
+    unsigned long long   wtns_size,
+    char                *proof_buffer,
+    unsigned long long  *proof_size,
+    char                *public_buffer,
+    unsigned long long  *public_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize)
+{
+    return ultra_groth_prover_prove_control(prover_object, NULL, wtns_buffer, wtns_size,
+                                            proof_buffer, proof_size, public_buffer, public_size,
+                                            error_msg, error_msg_maxsize);
+}
+
+int
+ultra_groth_prover_prove_control(
+    void                *prover_object,
+    void                *control,
+    const void          *wtns_buffer,
+    unsigned long long   wtns_size,
+    char                *proof_buffer,
+    unsigned long long  *proof_size,
+    char                *public_buffer,
+    unsigned long long  *public_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        if (wtns_buffer == NULL) {
+            throw std::invalid_argument("Null witness buffer");
+        }
+
+        if (proof_buffer == NULL) {
+            throw std::invalid_argument("Null proof buffer");
+        }
+
+        if (proof_size == NULL) {
+            throw std::invalid_argument("Null proof size");
+        }
+
+        if (public_buffer == NULL) {
+            throw std::invalid_argument("Null public buffer");
+        }
+
+        if (public_size == NULL) {
+            throw std::invalid_argument("Null public size");
+        }
+
+        UltraGrothProver *prover = static_cast<UltraGrothProver*>(prover_object);
+
+
+        CheckAndUpdateBufferSizes(prover->proofBufferMinSize(), proof_size,
+                                  prover->publicBufferMinSize(), public_size,
+                                  "Minimum");
+
+        std::string stringProof;
+        std::string stringPublic;
+
+        prover->prove(wtns_buffer, wtns_size, stringProof, stringPublic, OUTPUT_JSON,
+                      static_cast<ProveControl*>(control));
+
+        CheckAndUpdateBufferSizes(stringProof.length(), proof_size,
+                                  stringPublic.length(), public_size,
+                                  "Required");
+
+        std::strncpy(proof_buffer, stringProof.c_str(), *proof_size);
+        std::strncpy(public_buffer, stringPublic.c_str(), *public_size);
+
+    } catch(InvalidWitnessLengthException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_INVALID_WITNESS_LENGTH;
+
+    } catch(ShortBufferException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_SHORT_BUFFER;
+
+    } catch(ProveCancelled& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_CANCELLED;
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (std::exception *e) {
+        CopyError(error_msg, error_msg_maxsize, *e);
+        delete e;
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+groth16_prover_prove_binary(
+    void                *prover_object,
+    const void          *wtns_buffer,
+    unsigned long long   wtns_size,
+    void                *proof_buffer,
+    unsigned long long  *proof_size,
+    void                *public_buffer,
+    unsigned long long  *public_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        if (wtns_buffer == NULL) {
+            throw std::invalid_argument("Null witness buffer");
+        }
+
+        Groth16Prover *prover = static_cast<Groth16Prover*>(prover_object);
+
+        ProveToBinaryBuffers(prover, proof_buffer, proof_size, public_buffer, public_size,
+                             [&] (std::string &binProof, std::string &binPublic) {
+            prover->prove(wtns_buffer, wtns_size, binProof, binPublic, OUTPUT_BINARY);
+        });
+
+    } catch(InvalidWitnessLengthException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_INVALID_WITNESS_LENGTH;
+
+    } catch(ShortBufferException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_SHORT_BUFFER;
+
+    } catch(ProveCancelled& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_CANCELLED;
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (std::exception *e) {
+        CopyError(error_msg, error_msg_maxsize, *e);
+        delete e;
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+ultra_groth_prover_prove_binary(
+    void                *prover_object,
+    const void          *wtns_buffer,
+    unsigned long long   wtns_size,
+    void                *proof_buffer,
+    unsigned long long  *proof_size,
+    void                *public_buffer,
+    unsigned long long  *public_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        if (wtns_buffer == NULL) {
+            throw std::invalid_argument("Null witness buffer");
+        }
+
+        UltraGrothProver *prover = static_cast<UltraGrothProver*>(prover_object);
+
+        ProveToBinaryBuffers(prover, proof_buffer, proof_size, public_buffer, public_size,
+                             [&] (std::string &binProof, std::string &binPublic) {
+            prover->prove(wtns_buffer, wtns_size, binProof, binPublic, OUTPUT_BINARY);
+        });
+
+    } catch(InvalidWitnessLengthException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_INVALID_WITNESS_LENGTH;
+
+    } catch(ShortBufferException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_SHORT_BUFFER;
+
+    } catch(ProveCancelled& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_CANCELLED;
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (std::exception *e) {
+        CopyError(error_msg, error_msg_maxsize, *e);
+        delete e;
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+groth16_prover_prove_signals(
+    void                     *prover_object,
+    const void               *signals,
+    unsigned long long        signals_count,
+    char                     *proof_buffer,
+    unsigned long long       *proof_size,
+    char                     *public_buffer,
+    unsigned long long       *public_size,
+    char                     *error_msg,
+    unsigned long long        error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        if (signals == NULL) {
+            throw std::invalid_argument("Null signals");
+        }
+
+        Groth16Prover *prover = static_cast<Groth16Prover*>(prover_object);
+
+        ProveToBuffers(prover, proof_buffer, proof_size, public_buffer, public_size,
+                       [&] (std::string &stringProof, std::string &stringPublic) {
+            prover->proveSignals((AltBn128::FrElement *)signals, signals_count, stringProof, stringPublic);
+        });
+
+    } catch(InvalidWitnessLengthException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_INVALID_WITNESS_LENGTH;
+
+    } catch(ShortBufferException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_SHORT_BUFFER;
+
+    } catch(ProveCancelled& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_CANCELLED;
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (std::exception *e) {
+        CopyError(error_msg, error_msg_maxsize, *e);
+        delete e;
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+ultra_groth_prover_prove_signals(
+    void                     *prover_object,
+    void                     *signals,
+    unsigned long long        signals_count,
+    const unsigned int       *lookup_chunks,
+    unsigned long long        lookup_chunks_count,
+    const unsigned int       *lookup_frequencies,
+    unsigned long long        lookup_frequencies_count,
+    const unsigned int       *lookup_wtns_indexes,
+    const unsigned int       *lookup_push_indexes,
+    unsigned long long        lookup_indexes_count,
+    char                     *proof_buffer,
+    unsigned long long       *proof_size,
+    char                     *public_buffer,
+    unsigned long long       *public_size,
+    char                     *error_msg,
+    unsigned long long        error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        if (signals == NULL) {
+            throw std::invalid_argument("Null signals");
+        }
+
+        UltraGrothProver *prover = static_cast<UltraGrothProver*>(prover_object);
+
+        // Only read, the LookupInfo fields are not const
+        UltraGroth::LookupInfo lookupInfo(
+            (uint32_t *)lookup_chunks, lookup_chunks_count,
+            (uint32_t *)lookup_frequencies, lookup_frequencies_count,
+            (uint32_t *)lookup_wtns_indexes, lookup_indexes_count,
+            (uint32_t *)lookup_push_indexes, lookup_indexes_count
+        );
+
+        ProveToBuffers(prover, proof_buffer, proof_size, public_buffer, public_size,
+                       [&] (std::string &stringProof, std::string &stringPublic) {
+            prover->proveSignals((AltBn128::FrElement *)signals, signals_count, lookupInfo, stringProof, stringPublic);
+        });
+
+    } catch(InvalidWitnessLengthException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_INVALID_WITNESS_LENGTH;
+
+    } catch(ShortBufferException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_SHORT_BUFFER;
+
+    } catch(ProveCancelled& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_CANCELLED;
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (std::exception *e) {
+        CopyError(error_msg, error_msg_maxsize, *e);
+        delete e;
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+groth16_prover_prove_wtns_file(
+    void                     *prover_object,
+    const char               *wtns_file_name,
+    char                     *proof_buffer,
+    unsigned long long       *proof_size,
+    char                     *public_buffer,
+    unsigned long long       *public_size,
+    char                     *error_msg,
+    unsigned long long        error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        if (wtns_file_name == NULL) {
+            throw std::invalid_argument("Null witness file name");
+        }
+
+        Groth16Prover *prover = static_cast<Groth16Prover*>(prover_object);
+
+        ProveToBuffers(prover, proof_buffer, proof_size, public_buffer, public_size,
+                       [&] (std::string &stringProof, std::string &stringPublic) {
+            prover->proveWtnsFile(wtns_file_name, stringProof, stringPublic);
+        });
+
+    } catch(InvalidWitnessLengthException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_INVALID_WITNESS_LENGTH;
+
+    } catch(ShortBufferException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_SHORT_BUFFER;
+
+    } catch(ProveCancelled& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_CANCELLED;
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (std::exception *e) {
+        CopyError(error_msg, error_msg_maxsize, *e);
+        delete e;
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+ultra_groth_prover_prove_wtns_file(
+    void                     *prover_object,
+    const char               *wtns_file_name,
+    char                     *proof_buffer,
+    unsigned long long       *proof_size,
+    char                     *public_buffer,
+    unsigned long long       *public_size,
+    char                     *error_msg,
+    unsigned long long        error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        if (wtns_file_name == NULL) {
+            throw std::invalid_argument("Null witness file name");
+        }
+
+        UltraGrothProver *prover = static_cast<UltraGrothProver*>(prover_object);
+
+        ProveToBuffers(prover, proof_buffer, proof_size, public_buffer, public_size,
+                       [&] (std::string &stringProof, std::string &stringPublic) {
+            prover->proveWtnsFile(wtns_file_name, stringProof, stringPublic);
+        });
+
+    } catch(InvalidWitnessLengthException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_INVALID_WITNESS_LENGTH;
+
+    } catch(ShortBufferException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_SHORT_BUFFER;
+
+    } catch(ProveCancelled& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_CANCELLED;
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (std::exception *e) {
+        CopyError(error_msg, error_msg_maxsize, *e);
+        delete e;
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+groth16_prover_prove_batch(
+    void                      *prover_object,
+    unsigned long long         count,
+    const void *const         *wtns_buffers,
+    const unsigned long long  *wtns_sizes,
+    char                     **proof_buffers,
+    unsigned long long        *proof_sizes,
+    char                     **public_buffers,
+    unsigned long long        *public_sizes,
+    char                      *error_msg,
+    unsigned long long         error_msg_maxsize)
+{
+    return groth16_prover_prove_batch_control(prover_object, NULL, count, wtns_buffers, wtns_sizes,
+                                              proof_buffers, proof_sizes, public_buffers,
+                                              public_sizes, error_msg, error_msg_maxsize);
+}
+
+int
+groth16_prover_prove_batch_control(
+    void                      *prover_object,
+    void                      *control,
+    unsigned long long         count,
+    const void *const         *wtns_buffers,
+    const unsigned long long  *wtns_sizes,
+    char                     **proof_buffers,
+    unsigned long long        *proof_sizes,
+    char                     **public_buffers,
+    unsigned long long        *public_sizes,
+    char                      *error_msg,
+    unsigned long long         error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        Groth16Prover *prover = static_cast<Groth16Prover*>(prover_object);
+
+        ProveBatch(prover, static_cast<ProveControl*>(control), count, wtns_buffers, wtns_sizes,
+                   proof_buffers, proof_sizes, public_buffers, public_sizes);
+
+    } catch(InvalidWitnessLengthException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_INVALID_WITNESS_LENGTH;
+
+    } catch(ShortBufferException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_SHORT_BUFFER;
+
+    } catch(ProveCancelled& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_CANCELLED;
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (std::exception *e) {
+        CopyError(error_msg, error_msg_maxsize, *e);
+        delete e;
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+ultra_groth_prover_prove_batch(
+    void                      *prover_object,
+    unsigned long long         count,
+    const void *const         *wtns_buffers,
+    const unsigned long long  *wtns_sizes,
+    char                     **proof_buffers,
+    unsigned long long        *proof_sizes,
+    char                     **public_buffers,
+    unsigned long long        *public_sizes,
+    char                      *error_msg,
+    unsigned long long         error_msg_maxsize)
+{
+    return ultra_groth_prover_prove_batch_control(prover_object, NULL, count, wtns_buffers,
+                                                  wtns_sizes, proof_buffers, proof_sizes,
+                                                  public_buffers, public_sizes, error_msg,
+                                                  error_msg_maxsize);
+}
+
+int
+ultra_groth_prover_prove_batch_control(
+    void                      *prover_object,
+    void                      *control,
+    unsigned long long         count,
+    const void *const         *wtns_buffers,
+    const unsigned long long  *wtns_sizes,
+    char                     **proof_buffers,
+    unsigned long long        *proof_sizes,
+    char                     **public_buffers,
+    unsigned long long        *public_sizes,
+    char                      *error_msg,
+    unsigned long long         error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        UltraGrothProver *prover = static_cast<UltraGrothProver*>(prover_object);
+
+        ProveBatch(prover, static_cast<ProveControl*>(control), count, wtns_buffers, wtns_sizes,
+                   proof_buffers, proof_sizes, public_buffers, public_sizes);
+
+    } catch(InvalidWitnessLengthException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_INVALID_WITNESS_LENGTH;
+
+    } catch(ShortBufferException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_SHORT_BUFFER;
+
+    } catch(ProveCancelled& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_CANCELLED;
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (std::exception *e) {
+        CopyError(error_msg, error_msg_maxsize, *e);
+        delete e;
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+groth16_prover_prove_async(
+    void                        *prover_object,
+    const void                  *wtns_buffer,
+    unsigned long long           wtns_size,
+    prover_completion_callback   callback,
+    void                        *user_data,
+    char                        *error_msg,
+    unsigned long long           error_msg_maxsize)
+{
+    return groth16_prover_prove_async_control(prover_object, NULL, wtns_buffer, wtns_size, callback,
+                                              user_data, error_msg, error_msg_maxsize);
+}
+
+int
+groth16_prover_prove_async_control(
+    void                        *prover_object,
+    void                        *control,
+    const void                  *wtns_buffer,
+    unsigned long long           wtns_size,
+    prover_completion_callback   callback,
+    void                        *user_data,
+    char                        *error_msg,
+    unsigned long long           error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        Groth16Prover *prover = static_cast<Groth16Prover*>(prover_object);
+
+        ProveAsync(prover, static_cast<ProveControl*>(control), wtns_buffer, wtns_size, callback, user_data);
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+ultra_groth_prover_prove_async(
+    void                        *prover_object,
+    const void                  *wtns_buffer,
+    unsigned long long           wtns_size,
+    prover_completion_callback   callback,
+    void                        *user_data,
+    char                        *error_msg,
+    unsigned long long           error_msg_maxsize)
+{
+    return ultra_groth_prover_prove_async_control(prover_object, NULL, wtns_buffer, wtns_size,
+                                                  callback, user_data, error_msg,
+                                                  error_msg_maxsize);
+}
+
+int
+ultra_groth_prover_prove_async_control(
+    void                        *prover_object,
+    void                        *control,
+    const void                  *wtns_buffer,
+    unsigned long long           wtns_size,
+    prover_completion_callback   callback,
+    void                        *user_data,
+    char                        *error_msg,
+    unsigned long long           error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        UltraGrothProver *prover = static_cast<UltraGrothProver*>(prover_object);
+
+        ProveAsync(prover, static_cast<ProveControl*>(control), wtns_buffer, wtns_size, callback, user_data);
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+prover_control_create(
+    void                      **control,
+    prover_progress_callback    progress,
+    void                       *user_data,
+    char                       *error_msg,
+    unsigned long long          error_msg_maxsize)
+{
+    try {
+        if (control == NULL) {
+            throw std::invalid_argument("Null control");
+        }
+
+        *control = new ProveControl(progress, user_data);
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+void
+prover_control_cancel(void *control)
+{
+    if (control != NULL) {
+        static_cast<ProveControl*>(control)->cancel();
+    }
+}
+
+void
+prover_control_reset(void *control)
+{
+    if (control != NULL) {
+        static_cast<ProveControl*>(control)->reset();
+    }
+}
+
+void
+prover_control_set_threads(void *control, unsigned int n_threads)
+{
+    if (control != NULL) {
+        static_cast<ProveControl*>(control)->setThreads(n_threads);
+    }
+}
+
+void
+prover_control_destroy(void *control)
+{
+    if (control != NULL) {
+        delete static_cast<ProveControl*>(control);
+    }
+}
+
+int
+groth16_prover_set_control(
+    void                *prover_object,
+    void                *control,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        static_cast<Groth16Prover*>(prover_object)->setControl(static_cast<ProveControl*>(control));
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+ultra_groth_prover_set_control(
+    void                *prover_object,
+    void                *control,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        static_cast<UltraGrothProver*>(prover_object)->setControl(static_cast<ProveControl*>(control));
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+groth16_prover_set_threads(
+    void                *prover_object,
+    unsigned int         n_threads,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        static_cast<Groth16Prover*>(prover_object)->setThreads(n_threads);
+
+    } catch (std::exception& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
+    }
+
+    return PROVER_OK;
+}
+
+int
+groth16_proof_rerandomize(
+    void                *prover_object,
+    const char          *proof,
+    char                *proof_buffer,
+    unsigned long long  *proof_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize)
+{
+    try {
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
+
+        if (proof == NULL) {
+            throw std::invalid_argument("Null proof");
+        }
+
+        if (proof_buffer == NULL) {
+            throw std::invalid_argument("Null proof buffer");
+        }
+
+        if (proof_size == NULL) {
+            throw std::invalid_argument("Null proof size");
+        }
+
+        Groth16Prover *prover = static_cast<Groth16Prover*>(prover_object);
+
+        std::string stringProof = prover->rerandomize(proof);
+
+        if (*proof_size < stringProof.length() + 1) {
+            const unsigned long long actualSize = *proof_size;
+
+            *proof_size = stringProof.length() + 1;
+            throw ShortBufferException("Proof buffer is too short. Required size: "
+                                       + std::to_string(*proof_size) +
+                                       ", actual size: "
+                                       + std::to_string(actualSize));
+        }
+
+        std::strncpy(proof_buffer, stringProof.c_str(), *proof_size);
 
-        *public_size = PublicBufferMinSize(zkeyHeader->nPublic);
+    } catch(ShortBufferException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_ERROR_SHORT_BUFFER;
 
     } catch (std::exception& e) {
         CopyError(error_msg, error_msg_maxsize, e);
@@ -332,18 +2540,25 @@ groth16_public_size_for_zkey_file(
 
     return PROVER_OK;
 }
+
 int
-ultra_groth_public_size_for_zkey_file(
-    const char          *zkey_fname,
-    unsigned long long  *public_size,
+groth16_prover_set_base_witness(
+    void                *prover_object,
+    const void          *wtns_buffer,
+    unsigned long long   wtns_size,
     char                *error_msg,
-    unsigned long long   error_msg_maxsize
-) {
+    unsigned long long   error_msg_maxsize)
+{
     try {
-        auto zkey = BinFileUtils::openExisting(zkey_fname, "zkey", 1);
-        auto zkeyHeader = ZKeyUtils::ultra_groth_loadHeader(zkey.get());
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
 
-        *public_size = PublicBufferMinSize(zkeyHeader->nPublic);
+        static_cast<Groth16Prover*>(prover_object)->setBaseWitness(wtns_buffer, wtns_size);
+
+    } catch(InvalidWitnessLengthException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_INVALID_WITNESS_LENGTH;
 
     } catch (std::exception& e) {
         CopyError(error_msg, error_msg_maxsize, e);
@@ -357,49 +2572,29 @@ ultra_groth_public_size_for_zkey_file(
     return PROVER_OK;
 }
 
-void
-groth16_proof_size(
-    unsigned long long *proof_size
-) {
-    *proof_size = ProofBufferMinSize();
-}
-void
-ultra_groth_proof_size(
-    unsigned long long *proof_size
-) {
-    *proof_size = ProofBufferMinSizeUltraGroth();
-}
-
 int
-groth16_prover_create(
-    void                **prover_object,
-    const void          *zkey_buffer,
-    unsigned long long   zkey_size,
+ultra_groth_prover_set_base_witness(
+    void                *prover_object,
+    const void          *wtns_buffer,
+    unsigned long long   wtns_size,
     char                *error_msg,
-    unsigned long long   error_msg_maxsize
-) {
+    unsigned long long   error_msg_maxsize)
+{
     try {
         if (prover_object == NULL) {
             throw std::invalid_argument("Null prover object");
         }
 
-        if (zkey_buffer == NULL) {
-            throw std::invalid_argument("Null zkey buffer");
-        }
-
-        Groth16Prover *prover = new Groth16Prover(zkey_buffer, zkey_size);
+        static_cast<UltraGrothProver*>(prover_object)->setBaseWitness(wtns_buffer, wtns_size);
 
-        *prover_object = prover;
+    } catch(InvalidWitnessLengthException& e) {
+        CopyError(error_msg, error_msg_maxsize, e);
+        return PROVER_INVALID_WITNESS_LENGTH;
 
     } catch (std::exception& e) {
         CopyError(error_msg, error_msg_maxsize, e);
         return PROVER_ERROR;
 
-    } catch (std::exception *e) {
-        CopyError(error_msg, error_msg_maxsize, *e);
-        delete e;
-        return PROVER_ERROR;
-
     } catch (...) {
         CopyError(error_msg, error_msg_maxsize, "unknown error");
         return PROVER_ERROR;
@@ -409,35 +2604,23 @@ groth16_prover_create(
 }
 
 int
-ultra_groth_prover_create(
-    void                **prover_object,
-    const void          *zkey_buffer,
-    unsigned long long   zkey_size,
+ultra_groth_prover_set_threads(
+    void                *prover_object,
+    unsigned int         n_threads,
     char                *error_msg,
-    unsigned long long   error_msg_maxsize
-) {
+    unsigned long long   error_msg_maxsize)
+{
     try {
         if (prover_object == NULL) {
             throw std::invalid_argument("Null prover object");
         }
 
-        if (zkey_buffer == NULL) {
-            throw std::invalid_argument("Null zkey buffer");
-        }
-
-        UltraGrothProver *prover = new UltraGrothProver(zkey_buffer, zkey_size);
-
-        *prover_object = prover;
+        static_cast<UltraGrothProver*>(prover_object)->setThreads(n_threads);
 
     } catch (std::exception& e) {
         CopyError(error_msg, error_msg_maxsize, e);
         return PROVER_ERROR;
 
-    } catch (std::exception *e) {
-        CopyError(error_msg, error_msg_maxsize, *e);
-        delete e;
-        return PROVER_ERROR;
-
     } catch (...) {
         CopyError(error_msg, error_msg_maxsize, "unknown error");
         return PROVER_ERROR;
@@ -447,66 +2630,37 @@ ultra_groth_prover_create(
 }
 
 int
-groth16_prover_create_zkey_file(
-    void                **prover_object,
-    const char          *zkey_file_path,
+ultra_groth_prover_set_option(
+    void                *prover_object,
+    int                  option,
+    unsigned long long   value,
     char                *error_msg,
-    unsigned long long   error_msg_maxsize
-) {
-    BinFileUtils::FileLoader fileLoader;
-
+    unsigned long long   error_msg_maxsize)
+{
     try {
-        fileLoader.load(zkey_file_path);
-
-    } catch (std::exception& e) {
-        CopyError(error_msg, error_msg_maxsize, e);
-        return PROVER_ERROR;
-    }
-
-    return groth16_prover_create(
-        prover_object,
-        fileLoader.dataBuffer(),
-        fileLoader.dataSize(),
-        error_msg,
-        error_msg_maxsize
-    );
-}
+        if (prover_object == NULL) {
+            throw std::invalid_argument("Null prover object");
+        }
 
-int
-ultra_groth_prover_create_zkey_file(
-    void                **prover_object,
-    const char          *zkey_file_path,
-    char                *error_msg,
-    unsigned long long   error_msg_maxsize
-) {
-    BinFileUtils::FileLoader fileLoader;
+        UltraGrothProver *prover = static_cast<UltraGrothProver*>(prover_object);
 
-    try {
-        fileLoader.load(zkey_file_path);
+        prover->setOption(option, value);
 
     } catch (std::exception& e) {
         CopyError(error_msg, error_msg_maxsize, e);
         return PROVER_ERROR;
+
+    } catch (...) {
+        CopyError(error_msg, error_msg_maxsize, "unknown error");
+        return PROVER_ERROR;
     }
 
-    return ultra_groth_prover_create(
-        prover_object,
-        fileLoader.dataBuffer(),
-        fileLoader.dataSize(),
-        error_msg,
-        error_msg_maxsize
-    );
+    return PROVER_OK;
 }
 
 int
-groth16_prover_prove(
+ultra_groth_prover_warmup(
     void                *prover_object,
-    const void          *wtns_buffer,
-    unsigned long long   wtns_size,
-    char                *proof_buffer,
-    unsigned long long  *proof_size,
-    char                *public_buffer,
-    unsigned long long  *public_size,
     char                *error_msg,
     unsigned long long   error_msg_maxsize)
 {
@@ -515,61 +2669,12 @@ groth16_prover_prove(
             throw std::invalid_argument("Null prover object");
         }
 
-        if (wtns_buffer == NULL) {
-            throw std::invalid_argument("Null witness buffer");
-        }
-
-        if (proof_buffer == NULL) {
-            throw std::invalid_argument("Null proof buffer");
-        }
-
-        if (proof_size == NULL) {
-            throw std::invalid_argument("Null proof size");
-        }
-
-        if (public_buffer == NULL) {
-            throw std::invalid_argument("Null public buffer");
-        }
-
-        if (public_size == NULL) {
-            throw std::invalid_argument("Null public size");
-        }
-
-        Groth16Prover *prover = static_cast<Groth16Prover*>(prover_object);
-
-        CheckAndUpdateBufferSizes(prover->proofBufferMinSize(), proof_size,
-                                  prover->publicBufferMinSize(), public_size,
-                                  "Minimum");
-
-        std::string stringProof;
-        std::string stringPublic;
-
-        prover->prove(wtns_buffer, wtns_size, stringProof, stringPublic);
-
-        CheckAndUpdateBufferSizes(stringProof.length(), proof_size,
-                                  stringPublic.length(), public_size,
-                                  "Required");
-
-        std::strncpy(proof_buffer, stringProof.c_str(), *proof_size);
-        std::strncpy(public_buffer, stringPublic.c_str(), *public_size);
-
-    } catch(InvalidWitnessLengthException& e) {
-        CopyError(error_msg, error_msg_maxsize, e);
-        return PROVER_INVALID_WITNESS_LENGTH;
-
-    } catch(ShortBufferException& e) {
-        CopyError(error_msg, error_msg_maxsize, e);
-        return PROVER_ERROR_SHORT_BUFFER;
+        static_cast<UltraGrothProver*>(prover_object)->warmup();
 
     } catch (std::exception& e) {
         CopyError(error_msg, error_msg_maxsize, e);
         return PROVER_ERROR;
 
-    } catch (std::exception *e) {
-        CopyError(error_msg, error_msg_maxsize, *e);
-        delete e;
-        return PROVER_ERROR;
-
     } catch (...) {
         CopyError(error_msg, error_msg_maxsize, "unknown error");
         return PROVER_ERROR;
@@ -577,15 +2682,22 @@ groth16_prover_prove(
 
     return PROVER_OK;
 }
+
 int
-ultra_groth_prover_prove(
+ultra_groth_prover_validate(
     void                *prover_object,
-    const void          *wtns_buffer,
-    unsigned long long   wtns_size,
-    char                *proof_buffer,
-    unsigned long long  *proof_size,
-    char                *public_buffer,
-    unsigned long long  *public_size,
+    const char          *cache_path,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize)
+{
+    return ultra_groth_prover_validate_flags(prover_object, cache_path, 0, error_msg, error_msg_maxsize);
+}
+
+int
+ultra_groth_prover_validate_flags(
+    void                *prover_object,
+    const char          *cache_path,
+    unsigned int         flags,
     char                *error_msg,
     unsigned long long   error_msg_maxsize)
 {
@@ -594,62 +2706,26 @@ ultra_groth_prover_prove(
             throw std::invalid_argument("Null prover object");
         }
 
-        if (wtns_buffer == NULL) {
-            throw std::invalid_argument("Null witness buffer");
-        }
-
-        if (proof_buffer == NULL) {
-            throw std::invalid_argument("Null proof buffer");
-        }
-
-        if (proof_size == NULL) {
-            throw std::invalid_argument("Null proof size");
-        }
-
-        if (public_buffer == NULL) {
-            throw std::invalid_argument("Null public buffer");
+        if (flags & ~(PROVER_VALIDATE_STRICT_CACHE | PROVER_VALIDATE_FAST_CACHE)) {
+            throw std::invalid_argument("Unknown validate flags: " + std::to_string(flags));
         }
 
-        if (public_size == NULL) {
-            throw std::invalid_argument("Null public size");
+        if ((flags & PROVER_VALIDATE_STRICT_CACHE) && (flags & PROVER_VALIDATE_FAST_CACHE)) {
+            throw std::invalid_argument("PROVER_VALIDATE_STRICT_CACHE and PROVER_VALIDATE_FAST_CACHE exclude each other");
         }
 
         UltraGrothProver *prover = static_cast<UltraGrothProver*>(prover_object);
 
+        prover->validate(cache_path, flags & PROVER_VALIDATE_FAST_CACHE);
 
-        CheckAndUpdateBufferSizes(prover->proofBufferMinSize(), proof_size,
-                                  prover->publicBufferMinSize(), public_size,
-                                  "Minimum");
-
-        std::string stringProof;
-        std::string stringPublic;
-
-        prover->prove(wtns_buffer, wtns_size, stringProof, stringPublic);
-
-        CheckAndUpdateBufferSizes(stringProof.length(), proof_size,
-                                  stringPublic.length(), public_size,
-                                  "Required");
-
-        std::strncpy(proof_buffer, stringProof.c_str(), *proof_size);
-        std::strncpy(public_buffer, stringPublic.c_str(), *public_size);
-
-    } catch(InvalidWitnessLengthException& e) {
-        CopyError(error_msg, error_msg_maxsize, e);
-        return PROVER_INVALID_WITNESS_LENGTH;
-
-    } catch(ShortBufferException& e) {
+    } catch (ZKeyUtils::InvalidZKey& e) {
         CopyError(error_msg, error_msg_maxsize, e);
-        return PROVER_ERROR_SHORT_BUFFER;
+        return PROVER_INVALID_ZKEY;
 
     } catch (std::exception& e) {
         CopyError(error_msg, error_msg_maxsize, e);
         return PROVER_ERROR;
 
-    } catch (std::exception *e) {
-        CopyError(error_msg, error_msg_maxsize, *e);
-        delete e;
-        return PROVER_ERROR;
-
     } catch (...) {
         CopyError(error_msg, error_msg_maxsize, "unknown error");
         return PROVER_ERROR;
@@ -664,6 +2740,7 @@ groth16_prover_destroy(void *prover_object)
     if (prover_object != NULL) {
         Groth16Prover *prover = static_cast<Groth16Prover*>(prover_object);
 
+        prover->drainAsync();
         delete prover;
     }
 }
@@ -674,6 +2751,7 @@ ultra_groth_prover_destroy(void *prover_object)
     if (prover_object != NULL) {
         UltraGrothProver *prover = static_cast<UltraGrothProver*>(prover_object);
 
+        prover->drainAsync();
         delete prover;
     }
 }
@@ -873,7 +2951,9 @@ ultra_groth_public_size_for_zkey_buf(
     unsigned long long   error_msg_maxsize)
 {
     try {
-        BinFileUtils::BinFile zkey(zkey_buffer, zkey_size, "zkey", 1);
+        BinFileUtils::BinFile zkey(zkey_buffer, zkey_size,
+                                   UltraGrothZKeyType(zkey_buffer, zkey_size),
+                                   UltraGrothZKeyVersion(zkey_buffer, zkey_size));
         auto zkeyHeader = ZKeyUtils::ultra_groth_loadHeader(&zkey);
 
         *public_size = PublicBufferMinSize(zkeyHeader->nPublic);
@@ -10,6 +10,25 @@ extern "C" {
 #define PROVER_ERROR                  0x1
 #define PROVER_ERROR_SHORT_BUFFER     0x2
 #define PROVER_INVALID_WITNESS_LENGTH 0x3
+#define PROVER_INVALID_ZKEY           0x4
+#define PROVER_ERROR_CANCELLED        0x5
+
+//Options accepted by ultra_groth_prover_set_option.
+#define PROVER_OPTION_LOW_MEMORY      0x1
+#define PROVER_OPTION_MSM_MEMORY_LIMIT 0x2
+
+//Flags accepted by *_prover_create_zkey_file_flags, combinable.
+#define PROVER_LOAD_HUGE_PAGES        0x1
+#define PROVER_LOAD_MLOCK             0x2
+#define PROVER_LOAD_POPULATE          0x4
+#define PROVER_LOAD_READ              0x8
+#define PROVER_LOAD_SHARED            0x10
+#define PROVER_LOAD_NUMA_INTERLEAVE   0x20
+#define PROVER_LOAD_NUMA_PARTITION    0x40
+
+//Flags accepted by ultra_groth_prover_validate_flags, combinable.
+#define PROVER_VALIDATE_STRICT_CACHE  0x1
+#define PROVER_VALIDATE_FAST_CACHE    0x2
 
 /**
  * Calculates buffer size to output public signals as json string
@@ -71,6 +90,21 @@ ultra_groth_proof_size(
     unsigned long long *proof_size
 );
 
+/**
+ * Returns the size of a proof output by *_prover_prove_binary
+ */
+void
+groth16_proof_binary_size(
+    unsigned long long *proof_size
+);
+/**
+ * Returns the size of a proof output by *_prover_prove_binary
+ */
+void
+ultra_groth_proof_binary_size(
+    unsigned long long *proof_size
+);
+
 /**
  * Initializes 'prover_object' with a pointer to a new prover object.
  * @return error code:
@@ -117,6 +151,65 @@ ultra_groth_prover_create_zkey_file(
     unsigned long long   error_msg_maxsize
 );
 
+/**
+ * Same as *_prover_create_zkey_file, with control over how the zkey is kept
+ * in memory. 'load_flags' is 0 or a combination of:
+ *
+ * PROVER_LOAD_HUGE_PAGES - copy the zkey into 2 MiB huge pages instead of
+ *                          mapping it, to cut TLB misses in the MSMs. Uses
+ *                          reserved hugetlbfs pages when available and
+ *                          transparent huge pages otherwise.
+ * PROVER_LOAD_MLOCK      - lock the zkey in RAM; fails if RLIMIT_MEMLOCK
+ *                          is too low.
+ * PROVER_LOAD_POPULATE   - read the whole zkey in parallel at creation so
+ *                          that no proof takes a major page fault.
+ * PROVER_LOAD_READ       - read the zkey into memory with many concurrent
+ *                          large requests instead of mapping it; uses
+ *                          io_uring when built with USE_IO_URING.
+ * PROVER_LOAD_SHARED     - keep the zkey in a POSIX shared memory segment
+ *                          named after its contents (the checksum of a
+ *                          prepared zkey, a hash of the file otherwise), so
+ *                          that every process on the host loading the same
+ *                          zkey shares one copy. The first process fills
+ *                          it, expanding compressed points into it; the
+ *                          others attach read-only and check it against
+ *                          its name. The segment stays in /dev/shm until
+ *                          the host reboots or new contents of the same
+ *                          file path get a segment, which unlinks it.
+ * PROVER_LOAD_NUMA_INTERLEAVE - spread the zkey pages evenly over the NUMA
+ *                          nodes so that no socket serves every MSM read.
+ *                          Implies PROVER_LOAD_READ without
+ *                          PROVER_LOAD_SHARED.
+ * PROVER_LOAD_NUMA_PARTITION - as above, then split every point section
+ *                          into one block per node. The thread budget of
+ *                          the prover object (*_prover_set_threads) pins
+ *                          its workers over the nodes in the same order
+ *                          and its MSMs hand each worker a point range, so
+ *                          that each mostly reads local memory. Without a
+ *                          budget, or on a control's, the blocks are only
+ *                          spread as with PROVER_LOAD_NUMA_INTERLEAVE.
+ * @return error code:
+ *         PROVER_OK - in case of success
+ *         PPOVER_ERROR - in case of an error
+ */
+int
+groth16_prover_create_zkey_file_flags(
+    void                **prover_object,
+    const char          *zkey_file_path,
+    unsigned int         load_flags,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+int
+ultra_groth_prover_create_zkey_file_flags(
+    void                **prover_object,
+    const char          *zkey_file_path,
+    unsigned int         load_flags,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
 /**
  * Proves 'wtns_buffer' and saves results to 'proof_buffer' and 'public_buffer'.
  * @return error code:
@@ -151,7 +244,604 @@ ultra_groth_prover_prove(
 );
 
 /**
- * Destroys 'prover_object'.
+ * Like *_prover_prove, with the witness given as 'signals_count' field
+ * elements at 'signals' in the layout of the wtns signals section (32 bytes
+ * each, little-endian, not in Montgomery form) instead of a wtns buffer.
+ *
+ * For UltraGroth the lookup data of the wtns sections 3 to 6 is given as
+ * arrays too: the chunks, the table frequencies, and the pairs of witness and
+ * push vector indexes. 'signals' is used in place: the prover writes the
+ * lookup signals into it, so it holds the complete witness on return. Nothing
+ * is copied.
+ * @return error code: as *_prover_prove
+ */
+int
+groth16_prover_prove_signals(
+    void                     *prover_object,
+    const void               *signals,
+    unsigned long long        signals_count,
+    char                     *proof_buffer,
+    unsigned long long       *proof_size,
+    char                     *public_buffer,
+    unsigned long long       *public_size,
+    char                     *error_msg,
+    unsigned long long        error_msg_maxsize
+);
+
+int
+ultra_groth_prover_prove_signals(
+    void                     *prover_object,
+    void                     *signals,
+    unsigned long long        signals_count,
+    const unsigned int       *lookup_chunks,
+    unsigned long long        lookup_chunks_count,
+    const unsigned int       *lookup_frequencies,
+    unsigned long long        lookup_frequencies_count,
+    const unsigned int       *lookup_wtns_indexes,
+    const unsigned int       *lookup_push_indexes,
+    unsigned long long        lookup_indexes_count,
+    char                     *proof_buffer,
+    unsigned long long       *proof_size,
+    char                     *public_buffer,
+    unsigned long long       *public_size,
+    char                     *error_msg,
+    unsigned long long        error_msg_maxsize
+);
+
+/**
+ * Like *_prover_prove, reading the witness from the file 'wtns_file_name'
+ * (plain or compact). The file is mapped, not read: the signals of a plain
+ * witness are used from the mapping, and the pages UltraGroth writes lookup
+ * signals into are copied on write, the file is never modified.
+ * @return error code: as *_prover_prove
+ */
+int
+groth16_prover_prove_wtns_file(
+    void                     *prover_object,
+    const char               *wtns_file_name,
+    char                     *proof_buffer,
+    unsigned long long       *proof_size,
+    char                     *public_buffer,
+    unsigned long long       *public_size,
+    char                     *error_msg,
+    unsigned long long        error_msg_maxsize
+);
+
+int
+ultra_groth_prover_prove_wtns_file(
+    void                     *prover_object,
+    const char               *wtns_file_name,
+    char                     *proof_buffer,
+    unsigned long long       *proof_size,
+    char                     *public_buffer,
+    unsigned long long       *public_size,
+    char                     *error_msg,
+    unsigned long long        error_msg_maxsize
+);
+
+/**
+ * Like *_prover_prove, with the proof and public signals output as raw
+ * big-endian 32-byte words in the layout of EVM verifier calldata instead of
+ * JSON:
+ *
+ * Groth16    (256 bytes): pi_a.x, pi_a.y, pi_b.x.c1, pi_b.x.c0, pi_b.y.c1,
+ *                         pi_b.y.c0, pi_c.x, pi_c.y
+ * UltraGroth (320 bytes): pi_a.x, pi_a.y, pi_b.x.c1, pi_b.x.c0, pi_b.y.c1,
+ *                         pi_b.y.c0, pi_f.x, pi_f.y, pi_r.x, pi_r.y
+ *
+ * The public signals are in the order of the JSON output, 32 bytes each; for
+ * UltraGroth the signal at rand_indx is left out as well. A point at infinity
+ * is written as zeros. The sizes are exact: on success and on
+ * PROVER_ERROR_SHORT_BUFFER, proof_size and public_size are set to the number
+ * of bytes of the proof (see *_proof_binary_size) and of the public signals.
+ * @return error code: as *_prover_prove
+ */
+int
+groth16_prover_prove_binary(
+    void                *prover_object,
+    const void          *wtns_buffer,
+    unsigned long long   wtns_size,
+    void                *proof_buffer,
+    unsigned long long  *proof_size,
+    void                *public_buffer,
+    unsigned long long  *public_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+int
+ultra_groth_prover_prove_binary(
+    void                *prover_object,
+    const void          *wtns_buffer,
+    unsigned long long   wtns_size,
+    void                *proof_buffer,
+    unsigned long long  *proof_size,
+    void                *public_buffer,
+    unsigned long long  *public_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+/**
+ * Proves the 'count' witnesses 'wtns_buffers[i]' ('wtns_sizes[i]' bytes each)
+ * against the same zkey, saving results to 'proof_buffers[i]' and
+ * 'public_buffers[i]', whose sizes are passed in and returned through
+ * 'proof_sizes[i]' and 'public_sizes[i]'. The proofs are the same as those of
+ * *_prover_prove, but are computed stage by stage for the whole batch: each
+ * zkey point section is read once for all of the witnesses (once per chunk
+ * with PROVER_OPTION_MSM_MEMORY_LIMIT) and the H polynomial buffers are
+ * allocated once. Peak memory grows with 'count' by the decoded witnesses
+ * plus, during each MSM, their window digits (about as much again), which are
+ * kept under 1 GiB: a batch whose digits would take more is split into
+ * several passes over the points, down to one per witness for large zkeys.
+ * @return error code:
+ *         PROVER_OK - in case of success, all the buffers are filled
+ *         PPOVER_ERROR - in case of an error, no buffer is filled
+ *         PROVER_ERROR_SHORT_BUFFER - in case of a short buffer error, error_msg names the witness
+ *         PROVER_INVALID_WITNESS_LENGTH - a witness does not match the zkey, error_msg names it
+ */
+int
+groth16_prover_prove_batch(
+    void                      *prover_object,
+    unsigned long long         count,
+    const void *const         *wtns_buffers,
+    const unsigned long long  *wtns_sizes,
+    char                     **proof_buffers,
+    unsigned long long        *proof_sizes,
+    char                     **public_buffers,
+    unsigned long long        *public_sizes,
+    char                      *error_msg,
+    unsigned long long         error_msg_maxsize
+);
+
+int
+ultra_groth_prover_prove_batch(
+    void                      *prover_object,
+    unsigned long long         count,
+    const void *const         *wtns_buffers,
+    const unsigned long long  *wtns_sizes,
+    char                     **proof_buffers,
+    unsigned long long        *proof_sizes,
+    char                     **public_buffers,
+    unsigned long long        *public_sizes,
+    char                      *error_msg,
+    unsigned long long         error_msg_maxsize
+);
+
+/**
+ * Called by *_prover_prove_async with the outcome of a proof. 'status' is one
+ * of the error codes of *_prover_prove (never PROVER_ERROR_SHORT_BUFFER). On
+ * PROVER_OK 'proof' and 'public_signals' hold the NUL-terminated results and
+ * 'error_msg' is NULL; otherwise 'error_msg' says what failed. The strings are
+ * valid only during the call.
+ *
+ * The callback runs on the library's prover thread and delays the next queued
+ * proof until it returns: it should hand the results over (e.g. copy them and
+ * write to an eventfd watched by the event loop) rather than process them.
+ */
+typedef void (*prover_completion_callback)(
+    void                *user_data,
+    int                  status,
+    const char          *proof,
+    unsigned long long   proof_size,
+    const char          *public_signals,
+    unsigned long long   public_size,
+    const char          *error_msg
+);
+
+/**
+ * Queues a proof of 'wtns_buffer' and returns without waiting for it. Queued
+ * proofs of the prover objects without a thread budget (see
+ * *_prover_set_threads) run one at a time, each on the default pool, on a
+ * single library thread; an object with a budget has a thread of its own
+ * running its queued proofs, alongside those of other objects. 'callback' is
+ * then called with 'user_data' and the results. 'wtns_buffer' must stay valid
+ * until the callback is called.
+ *
+ * *_prover_destroy waits for the queued proofs of 'prover_object', and so must
+ * not be called from a callback for that same object.
+ * @return error code:
+ *         PROVER_OK - the proof is queued, the callback will be called once
+ *         PPOVER_ERROR - in case of an error, the callback will not be called
+ */
+int
+groth16_prover_prove_async(
+    void                        *prover_object,
+    const void                  *wtns_buffer,
+    unsigned long long           wtns_size,
+    prover_completion_callback   callback,
+    void                        *user_data,
+    char                        *error_msg,
+    unsigned long long           error_msg_maxsize
+);
+
+int
+ultra_groth_prover_prove_async(
+    void                        *prover_object,
+    const void                  *wtns_buffer,
+    unsigned long long           wtns_size,
+    prover_completion_callback   callback,
+    void                        *user_data,
+    char                        *error_msg,
+    unsigned long long           error_msg_maxsize
+);
+
+/**
+ * Runs the proofs of 'prover_object' on a thread pool of 'n_threads' threads
+ * of its own instead of the default pool shared by every prover object of the
+ * process; 0 goes back to the default pool. On Linux the pool reserves as many
+ * CPUs, out of those the process may run on, and pins its workers to them
+ * while it exists, so that prover objects proving at the same time each get
+ * their own physical cores, on one NUMA node when it has enough; the default
+ * pool, which also decodes the witnesses, moves off the reserved CPUs. If not
+ * enough CPUs are left, the workers are not pinned.
+ * The thread calling into the prover object takes part in the proof: it is
+ * pinned to the first reserved CPU for the length of the proof, and gets its
+ * previous affinity back afterwards.
+ *
+ * A prover object may be used from several threads at once: proofs, batches
+ * and asynchronous proofs on the same object run one after the other (witness
+ * decoding and output formatting overlap), and the *_set_* functions wait for
+ * the proof in progress. Proofs on different objects run concurrently. Only
+ * *_prover_destroy must not race with other calls on the object.
+ * @return error code:
+ *         PROVER_OK - in case of success
+ *         PPOVER_ERROR - in case of an error
+ */
+int
+groth16_prover_set_threads(
+    void                *prover_object,
+    unsigned int         n_threads,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+int
+ultra_groth_prover_set_threads(
+    void                *prover_object,
+    unsigned int         n_threads,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+/**
+ * Writes to 'proof_buffer' a new proof of the same statement as 'proof', a JSON
+ * proof for the zkey of 'prover_object', that cannot be linked to it. It takes
+ * a few scalar multiplications instead of a whole proof; the public signals of
+ * 'proof' apply unchanged. It does not wait for the proofs of the object.
+ * @return error code:
+ *         PROVER_OK - in case of success
+ *         PROVER_ERROR_SHORT_BUFFER - in case of a short buffer error, also updates proof_size with the required size
+ *         PPOVER_ERROR - in case of an error (e.g. malformed proof)
+ */
+int
+groth16_proof_rerandomize(
+    void                *prover_object,
+    const char          *proof,
+    char                *proof_buffer,
+    unsigned long long  *proof_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+/**
+ * Makes 'wtns_buffer' the base witness of 'prover_object': it keeps a copy of
+ * the signals and their unblinded A, B1, B2 and C MSMs (and for UltraGroth the
+ * round MSM). The next proofs of witnesses that differ from the base in at
+ * most half of the signals compute these MSMs as the base ones plus MSMs over
+ * the changed signals only, which is much faster when few change; H is always
+ * computed in full and the proofs get fresh blinding as usual. A NULL
+ * 'wtns_buffer' drops the base. Batched proofs do not use it.
+ *
+ * The lookup signals of an UltraGroth witness are derived from the round
+ * commitment, which is blinded afresh for every proof: they count as changed
+ * in every proof, and a circuit where they make up more than half of the
+ * signals is always proved in full. The round MSM does not depend on them.
+ * @return error code:
+ *         PROVER_OK - in case of success
+ *         PROVER_INVALID_WITNESS_LENGTH - in case of an invalid witness length
+ *         PPOVER_ERROR - in case of an error
+ */
+int
+groth16_prover_set_base_witness(
+    void                *prover_object,
+    const void          *wtns_buffer,
+    unsigned long long   wtns_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+int
+ultra_groth_prover_set_base_witness(
+    void                *prover_object,
+    const void          *wtns_buffer,
+    unsigned long long   wtns_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+/**
+ * Sets a tuning option of 'prover_object', applied to all subsequent proofs.
+ *
+ * PROVER_OPTION_LOW_MEMORY - non-zero 'value' keeps at most two domain-sized
+ *                            arrays alive while computing the H polynomial,
+ *                            and none between proofs, at the cost of a
+ *                            somewhat slower proof.
+ * PROVER_OPTION_MSM_MEMORY_LIMIT - non-zero 'value' makes the MSMs read the
+ *                            point sections from the zkey file in chunks,
+ *                            double-buffered within 'value' bytes, instead of
+ *                            through the mapping; for zkeys larger than RAM.
+ *                            Needs a prover created from a zkey file; 0
+ *                            switches back to the mapping.
+ * @return error code:
+ *         PROVER_OK - in case of success
+ *         PPOVER_ERROR - in case of an error (e.g. unknown option)
+ */
+int
+ultra_groth_prover_set_option(
+    void                *prover_object,
+    int                  option,
+    unsigned long long   value,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+/**
+ * Called after each stage of a proof controlled by a prover control, on the
+ * proving thread: 'stage' names it and 'done' out of 'total' stages are
+ * complete. A batch reports each stage once for the whole batch.
+ */
+typedef void (*prover_progress_callback)(
+    void                *user_data,
+    const char          *stage,
+    unsigned int         done,
+    unsigned int         total
+);
+
+/**
+ * Initializes 'control' with a new prover control: a cancellation token plus
+ * an optional 'progress' callback (may be NULL) called with 'user_data'.
+ * @return error code:
+ *         PROVER_OK - in case of success
+ *         PPOVER_ERROR - in case of an error
+ */
+int
+prover_control_create(
+    void                      **control,
+    prover_progress_callback    progress,
+    void                       *user_data,
+    char                       *error_msg,
+    unsigned long long          error_msg_maxsize
+);
+
+/**
+ * Cancels the proofs running or started under 'control', from any thread.
+ * They return PROVER_ERROR_CANCELLED once their threads next poll the
+ * control: MSMs and the coefficient loops poll it every few thousand points
+ * or coefficients, so a proof stops within milliseconds of the call unless an
+ * FFT is in progress, which runs to its end (up to a fraction of a second on
+ * large domains). The control stays cancelled until prover_control_reset.
+ */
+void
+prover_control_cancel(
+    void *control
+);
+
+void
+prover_control_reset(
+    void *control
+);
+
+/**
+ * Runs the proofs started under 'control' on a pool of 'n_threads' threads of
+ * their own, as *_prover_set_threads does for a whole prover object; 0 leaves
+ * the choice to the prover object. The pool belongs to the control and is
+ * kept from one proof to the next, so proofs under one control run one at a
+ * time, on whichever prover objects. Takes effect from the next proof.
+ */
+void
+prover_control_set_threads(
+    void           *control,
+    unsigned int    n_threads
+);
+
+/**
+ * Destroys 'control', which must no longer be set on any prover object nor
+ * used by a proof in progress.
+ */
+void
+prover_control_destroy(
+    void *control
+);
+
+/**
+ * Sets the prover control polled by the subsequent proofs of 'prover_object',
+ * synchronous, batched or asynchronous, that are not given one of their own
+ * by a *_control function; NULL removes it. A cancelled proof returns (or
+ * completes with) PROVER_ERROR_CANCELLED. Every such proof of the object
+ * shares the control, so cancelling it cancels them all: callers sharing a
+ * prover object pass a control per proof instead.
+ * @return error code:
+ *         PROVER_OK - in case of success
+ *         PPOVER_ERROR - in case of an error
+ */
+int
+groth16_prover_set_control(
+    void                *prover_object,
+    void                *control,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+int
+ultra_groth_prover_set_control(
+    void                *prover_object,
+    void                *control,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+/**
+ * Same as *_prover_prove, *_prover_prove_batch and *_prover_prove_async,
+ * polling 'control' instead of the control set on 'prover_object', so that
+ * cancelling it stops only this proof (or batch). A NULL 'control' falls back
+ * to that of the prover object. 'control' must outlive the proof; for an
+ * asynchronous proof, until its callback is called.
+ * @return error code: as the functions without a control
+ */
+int
+groth16_prover_prove_control(
+    void                *prover_object,
+    void                *control,
+    const void          *wtns_buffer,
+    unsigned long long   wtns_size,
+    char                *proof_buffer,
+    unsigned long long  *proof_size,
+    char                *public_buffer,
+    unsigned long long  *public_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+int
+ultra_groth_prover_prove_control(
+    void                *prover_object,
+    void                *control,
+    const void          *wtns_buffer,
+    unsigned long long   wtns_size,
+    char                *proof_buffer,
+    unsigned long long  *proof_size,
+    char                *public_buffer,
+    unsigned long long  *public_size,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+int
+groth16_prover_prove_batch_control(
+    void                      *prover_object,
+    void                      *control,
+    unsigned long long         count,
+    const void *const         *wtns_buffers,
+    const unsigned long long  *wtns_sizes,
+    char                     **proof_buffers,
+    unsigned long long        *proof_sizes,
+    char                     **public_buffers,
+    unsigned long long        *public_sizes,
+    char                      *error_msg,
+    unsigned long long         error_msg_maxsize
+);
+
+int
+ultra_groth_prover_prove_batch_control(
+    void                      *prover_object,
+    void                      *control,
+    unsigned long long         count,
+    const void *const         *wtns_buffers,
+    const unsigned long long  *wtns_sizes,
+    char                     **proof_buffers,
+    unsigned long long        *proof_sizes,
+    char                     **public_buffers,
+    unsigned long long        *public_sizes,
+    char                      *error_msg,
+    unsigned long long         error_msg_maxsize
+);
+
+int
+groth16_prover_prove_async_control(
+    void                        *prover_object,
+    void                        *control,
+    const void                  *wtns_buffer,
+    unsigned long long           wtns_size,
+    prover_completion_callback   callback,
+    void                        *user_data,
+    char                        *error_msg,
+    unsigned long long           error_msg_maxsize
+);
+
+int
+ultra_groth_prover_prove_async_control(
+    void                        *prover_object,
+    void                        *control,
+    const void                  *wtns_buffer,
+    unsigned long long           wtns_size,
+    prover_completion_callback   callback,
+    void                        *user_data,
+    char                        *error_msg,
+    unsigned long long           error_msg_maxsize
+);
+
+/**
+ * Makes the first proof of 'prover_object' as fast as the later ones, for
+ * services that report ready only once they prove at full speed. On the
+ * threads of the prover object, faults in every zkey section the proofs read
+ * (point sections are skipped when PROVER_OPTION_MSM_MEMORY_LIMIT streams
+ * them), builds the FFT coset table, and allocates and faults in the arrays
+ * of the H polynomial, which the prover object then keeps for its proofs.
+ * With PROVER_OPTION_LOW_MEMORY set the H arrays are not kept, so that they
+ * only take memory while a proof computes H, and setting the option frees
+ * those kept by an earlier warmup.
+ * @return error code:
+ *         PROVER_OK - in case of success
+ *         PPOVER_ERROR - in case of an error
+ */
+int
+ultra_groth_prover_warmup(
+    void                *prover_object,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+/**
+ * Fully checks the zkey of 'prover_object': the checksum of a prepared zkey,
+ * section sizes against the header, coefficients and indexes within the
+ * witness and the domain, and every point on its curve and in the prime order
+ * subgroup. The checks run on all threads.
+ *
+ * If 'cache_path' is not NULL it names a validated-key cache file, created if
+ * missing: a zkey whose key is listed there is accepted without checking,
+ * and a zkey that passes is added, so only the first validation of given
+ * contents pays for the point checks. A zkey is keyed by a hash of all of its
+ * data, computed on all threads: the whole zkey is read on every call, which
+ * is still much cheaper than the checks.
+ * @return error code:
+ *         PROVER_OK - the zkey is valid
+ *         PROVER_INVALID_ZKEY - it is not, error_msg says why
+ *         PPOVER_ERROR - in case of an error (e.g. unwritable cache file)
+ */
+int
+ultra_groth_prover_validate(
+    void                *prover_object,
+    const char          *cache_path,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+/**
+ * Same as ultra_groth_prover_validate, with 'flags' 0 or:
+ *
+ * PROVER_VALIDATE_STRICT_CACHE - key every zkey in the cache by a hash of all
+ *                          of its data, as without flags.
+ * PROVER_VALIDATE_FAST_CACHE - key a zkey loaded by
+ *                          *_prover_create_zkey_file* by the device, inode,
+ *                          size, and modification and change times (to the
+ *                          nanosecond) of its file instead, so that a cached
+ *                          zkey is not read. A file rewritten with all of
+ *                          those kept is trusted without being checked.
+ *                          Zkeys given as a buffer are still hashed.
+ */
+int
+ultra_groth_prover_validate_flags(
+    void                *prover_object,
+    const char          *cache_path,
+    unsigned int         flags,
+    char                *error_msg,
+    unsigned long long   error_msg_maxsize
+);
+
+/**
+ * Destroys 'prover_object', once its proofs queued by *_prover_prove_async
+ * have completed.
  */
 void
 groth16_prover_destroy(
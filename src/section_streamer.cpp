@@ -0,0 +1,116 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "section_streamer.hpp"
+
+namespace BinFileUtils {
+
+// Returns 0 or the errno of the failed read
+static int readRange(int fd, uint8_t *buffer, uint64_t offset, uint64_t size) {
+    while (size > 0) {
+        ssize_t n = pread(fd, buffer, size, offset);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return n < 0 ? errno : EIO;
+        }
+        buffer += n;
+        offset += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static void dropFromCache(int fd, uint64_t offset, uint64_t size) {
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(fd, offset, size, POSIX_FADV_DONTNEED);
+#endif
+}
+
+SectionStreamer::SectionStreamer(int _fd, const void *_fileBase, uint64_t memoryLimit)
+    : fd(_fd),
+      fileBase((const uint8_t *)_fileBase),
+      bufferSize(memoryLimit / 2)
+{
+    if (fd < 0) {
+        throw std::invalid_argument("Streaming needs a file-backed zkey");
+    }
+}
+
+void SectionStreamer::forEachChunk(const void *data, uint64_t elementSize, uint64_t n, const ChunkFn &fn) {
+
+    const uint64_t chunkElements = bufferSize / elementSize;
+
+    if (chunkElements == 0) {
+        throw std::invalid_argument("Memory limit of " + std::to_string(bufferSize * 2) +
+            " bytes is too small for elements of " + std::to_string(elementSize) + " bytes");
+    }
+
+    if (n == 0) {
+        return;
+    }
+
+    const uint64_t fileOffset = (const uint8_t *)data - fileBase;
+    const uint64_t nChunks = (n + chunkElements - 1) / chunkElements;
+    const uint64_t chunkBytes = std::min(n, chunkElements) * elementSize;
+
+    for (auto &buffer : buffers) {
+        if (buffer.size() < chunkBytes) {
+            buffer.resize(chunkBytes);
+        }
+    }
+
+    auto chunkCount = [&] (uint64_t k) {
+        return std::min(chunkElements, n - k * chunkElements);
+    };
+
+    auto chunkOffset = [&] (uint64_t k) {
+        return fileOffset + k * chunkElements * elementSize;
+    };
+
+    int error = readRange(fd, buffers[0].data(), chunkOffset(0), chunkCount(0) * elementSize);
+
+    if (error != 0) {
+        throw std::system_error(error, std::generic_category(), "pread");
+    }
+
+    for (uint64_t k = 0; k < nChunks; k++) {
+        std::thread reader;
+
+        if (k + 1 < nChunks) {
+            reader = std::thread([&, k] {
+                error = readRange(fd, buffers[(k + 1) & 1].data(), chunkOffset(k + 1), chunkCount(k + 1) * elementSize);
+            });
+        }
+
+        try {
+            fn(buffers[k & 1].data(), k * chunkElements, chunkCount(k));
+
+        } catch (...) {
+            if (reader.joinable()) {
+                reader.join();
+            }
+            throw;
+        }
+
+        if (reader.joinable()) {
+            reader.join();
+        }
+
+        dropFromCache(fd, chunkOffset(k), chunkCount(k) * elementSize);
+
+        if (error != 0) {
+            throw std::system_error(error, std::generic_category(), "pread");
+        }
+    }
+}
+
+} // Namespace
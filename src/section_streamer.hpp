@@ -0,0 +1,42 @@
+#ifndef SECTION_STREAMER_HPP
+#define SECTION_STREAMER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace BinFileUtils {
+
+    // Reads arrays that live in a file-backed zkey through two fixed-size
+    // buffers instead of touching the mapping, so consumers such as the MSMs
+    // run under a fixed memory ceiling even when the zkey does not fit in RAM.
+    //
+    // The next chunk is read on a background thread while the current one is
+    // processed, and consumed ranges are dropped from the page cache.
+    class SectionStreamer {
+
+        int fd;
+        const uint8_t *fileBase;
+        uint64_t bufferSize;
+
+        std::vector<uint8_t> buffers[2];
+
+    public:
+        typedef std::function<void(void *chunk, uint64_t begin, uint64_t count)> ChunkFn;
+
+        // fileBase: address at which the file (offset 0) is loaded;
+        // memoryLimit: bytes for both buffers together
+        SectionStreamer(int fd, const void *fileBase, uint64_t memoryLimit);
+
+        SectionStreamer(const SectionStreamer&) = delete;
+        SectionStreamer& operator=(const SectionStreamer&) = delete;
+
+        // Calls fn, in order, for consecutive runs of whole elements of the
+        // n-element array at data, which must point into the loaded file.
+        // begin and count are in elements; the chunk is only valid during the call.
+        void forEachChunk(const void *data, uint64_t elementSize, uint64_t n, const ChunkFn &fn);
+    };
+
+} // Namespace
+
+#endif // SECTION_STREAMER_HPP
@@ -0,0 +1,148 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "binfile_utils.hpp"
+#include "wtns_utils.hpp"
+#include "test_utils.hpp"
+
+// Writes a witness with signals of every encoding (small, prime - small,
+// full, and the values at the boundaries between them) over several blocks,
+// compacts it and checks that loadSignals returns the original signals.
+
+static const char *COMPACT_FILE = "test_compact_wtns.cwtns";
+
+// BN254 scalar field
+static const uint64_t PRIME[4] = {
+    0x43e1f593f0000001ULL, 0x2833e84879b97091ULL, 0xb85045b68181585dULL, 0x30644e72e131a029ULL
+};
+
+static const uint32_t N8 = 32;
+
+typedef std::vector<uint64_t> Signal;
+
+static Signal small(uint64_t k)
+{
+    return Signal{k, 0, 0, 0};
+}
+
+static Signal primeMinus(uint64_t k)
+{
+    Signal r(4);
+    uint64_t borrow = 0;
+
+    for (int i = 0; i < 4; i++) {
+        const uint64_t sub = (i == 0 ? k : 0);
+        r[i] = PRIME[i] - sub - borrow;
+        borrow = (PRIME[i] < sub || (PRIME[i] == sub && borrow)) ? 1 : 0;
+    }
+
+    return r;
+}
+
+// Version 2 witness file with a header and a signals section
+static std::vector<uint8_t> makeWitness(const std::vector<Signal> &signals)
+{
+    std::vector<uint8_t> out;
+
+    auto write = [&out] (const void *p, uint64_t len) {
+        out.insert(out.end(), (const uint8_t *)p, (const uint8_t *)p + len);
+    };
+    auto writeU32 = [&write] (uint32_t v) { write(&v, 4); };
+    auto writeU64 = [&write] (uint64_t v) { write(&v, 8); };
+
+    const uint32_t nVars = signals.size();
+
+    write("wtns", 4);
+    writeU32(2);
+    writeU32(2);
+
+    writeU32(1);
+    writeU64(4 + N8 + 4);
+    writeU32(N8);
+    write(PRIME, N8);
+    writeU32(nVars);
+
+    writeU32(2);
+    writeU64((uint64_t)nVars * N8);
+    for (const auto &s : signals) {
+        write(s.data(), N8);
+    }
+
+    return out;
+}
+
+int main()
+{
+    std::mt19937_64 rng(40);
+    std::vector<Signal> signals;
+
+    const uint64_t boundaries[] = {0, 1, 2, 127, 128, 16383, 16384, (1ULL << 62) - 1, 1ULL << 62, ~0ULL};
+
+    for (uint64_t k : boundaries) {
+        signals.push_back(small(k));
+        if (k != 0) {
+            signals.push_back(primeMinus(k));
+        }
+    }
+
+    // A few blocks and a partial one, mostly bits and small values as in
+    // real circuits
+    const uint64_t nVars = 2 * WtnsUtils::COMPACT_BLOCK_SIZE + 1000;
+
+    while (signals.size() < nVars) {
+        switch (rng() % 4) {
+        case 0: signals.push_back(small(rng() % 2)); break;
+        case 1: signals.push_back(small(rng() % 100000)); break;
+        case 2: signals.push_back(primeMinus(1 + rng() % 100000)); break;
+        default: {
+            Signal s(4);
+            for (int i = 0; i < 4; i++) {
+                s[i] = rng();
+            }
+            s[3] &= 0x1fffffffffffffffULL;
+            signals.push_back(s);
+        }
+        }
+    }
+
+    const std::vector<uint8_t> wtns = makeWitness(signals);
+
+    try {
+        WtnsUtils::writeCompactWitness(wtns.data(), wtns.size(), COMPACT_FILE);
+
+        BinFileUtils::BinFile plain(wtns.data(), wtns.size(), "wtns", WtnsUtils::COMPACT_VERSION);
+        auto compact = BinFileUtils::openExisting(COMPACT_FILE, "wtns", WtnsUtils::COMPACT_VERSION);
+
+        TestUtils::expect(!WtnsUtils::isCompact(&plain) && WtnsUtils::isCompact(compact.get()),
+                          "isCompact does not tell the witnesses apart");
+
+        auto header = WtnsUtils::loadHeader(compact.get());
+
+        TestUtils::expect(header->nVars == nVars && header->n8 == N8, "The compact witness header differs");
+
+        if (header->nVars == nVars) {
+            std::vector<uint64_t> decoded(nVars * 4);
+
+            WtnsUtils::loadSignals(compact.get(), *header, decoded.data());
+
+            for (uint64_t i = 0; i < nVars; i++) {
+                TestUtils::expect(memcmp(&decoded[i * 4], signals[i].data(), N8) == 0,
+                                  "Signal #" + std::to_string(i) + " does not survive compaction");
+            }
+
+            TestUtils::expect(compact->dataSize() < wtns.size(), "The compact witness is not smaller");
+        }
+
+    } catch (std::exception &e) {
+        TestUtils::expect(false, std::string("Error: ") + e.what());
+    }
+
+    std::remove(COMPACT_FILE);
+
+    return TestUtils::result();
+}
@@ -0,0 +1,85 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fr.hpp"
+#include "fft.hpp"
+#include "fft_lazy.hpp"
+#include "test_utils.hpp"
+
+// Checks LazyFFT against ffiasm's FFT: the roots, fft, ifft, and
+// cosetTransform against the ifft, shift by w_2n^i, fft sequence it replaces.
+
+typedef RawFr::Element Element;
+
+static RawFr &F = RawFr::field;
+
+static const uint32_t MAX_POW = 11;
+
+static void expectEqual(const std::vector<Element> &a, const std::vector<Element> &b, const std::string &what)
+{
+    TestUtils::expect(memcmp(a.data(), b.data(), a.size() * sizeof(Element)) == 0, what + " differs from ffiasm");
+}
+
+int main()
+{
+    std::mt19937_64 rng(29);
+
+    // The coset shift needs the roots of twice the domain
+    FFT<RawFr> ref(2ULL << MAX_POW);
+    LazyFFT<RawFr> lazy(2ULL << MAX_POW);
+
+    for (uint32_t pw = 0; pw <= MAX_POW; pw++) {
+        const uint64_t n = 1ULL << pw;
+        const std::string size = " of size " + std::to_string(n);
+        std::vector<Element> a(n);
+
+        for (auto &e : a) {
+            for (int i = 0; i < 4; i++) {
+                e.v[i] = rng();
+            }
+            e.v[3] &= 0x1fffffffffffffffULL;
+            F.toMontgomery(e, e);
+        }
+
+        std::vector<Element> expected(n), actual(n);
+
+        for (uint64_t i = 0; i < n; i++) {
+            expected[i] = ref.root(pw, i);
+            actual[i] = lazy.root(pw, i);
+        }
+        expectEqual(expected, actual, "root" + size);
+
+        expected = a;
+        actual = a;
+        ref.fft(expected.data(), n);
+        lazy.fft(actual.data(), n);
+        expectEqual(expected, actual, "fft" + size);
+
+        expected = a;
+        actual = a;
+        ref.ifft(expected.data(), n);
+        lazy.ifft(actual.data(), n);
+        expectEqual(expected, actual, "ifft" + size);
+
+        expected = a;
+        ref.ifft(expected.data(), n);
+        for (uint64_t i = 0; i < n; i++) {
+            F.mul(expected[i], expected[i], ref.root(pw + 1, i));
+        }
+        ref.fft(expected.data(), n);
+
+        // Twice, the second time with the shift table already built
+        for (int k = 0; k < 2; k++) {
+            actual = a;
+            lazy.cosetTransform(actual.data(), n);
+            expectEqual(expected, actual, "cosetTransform" + size);
+        }
+    }
+
+    return TestUtils::result();
+}
@@ -0,0 +1,132 @@
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <gmp.h>
+#include <nlohmann/json.hpp>
+
+#include "field_decimal.hpp"
+#include "test_utils.hpp"
+
+using json = nlohmann::json;
+
+// Checks the decimal conversions against GMP and the array writer and
+// reader against nlohmann::json on random 256-bit values.
+
+using TestUtils::expect;
+
+static std::string gmpDecimal(const uint64_t *v)
+{
+    mpz_t m;
+    mpz_init(m);
+    mpz_import(m, 4, -1, 8, 0, 0, v);
+
+    char *s = mpz_get_str(nullptr, 10, m);
+    std::string r(s);
+
+    void (*freeFunc)(void *, size_t);
+    mp_get_memory_functions(nullptr, nullptr, &freeFunc);
+    freeFunc(s, strlen(s) + 1);
+    mpz_clear(m);
+
+    return r;
+}
+
+static void checkValue(const uint64_t *v)
+{
+    char buf[FieldDecimal::MAX_DIGITS];
+    const size_t len = FieldDecimal::toDecimal(v, buf);
+    const std::string expected = gmpDecimal(v);
+
+    expect(std::string(buf, len) == expected, "toDecimal differs from GMP for " + expected);
+
+    uint64_t back[4];
+    expect(FieldDecimal::fromDecimal(buf, len, back) && memcmp(back, v, sizeof(back)) == 0,
+           "fromDecimal does not invert toDecimal for " + expected);
+}
+
+int main()
+{
+    std::mt19937_64 rng(46);
+    std::vector<std::vector<uint64_t>> values;
+
+    values.push_back({0, 0, 0, 0});
+    values.push_back({1, 0, 0, 0});
+    values.push_back({10000000000000000000ULL, 0, 0, 0});
+    values.push_back({~0ULL, ~0ULL, ~0ULL, ~0ULL});
+
+    for (int k = 0; k < 5000; k++) {
+        std::vector<uint64_t> v(4);
+        for (int i = 0; i < 4; i++) {
+            v[i] = rng();
+        }
+        // Spread the lengths over every digit count
+        const unsigned int shift = rng() % 256;
+        for (int i = 3; i >= 0; i--) {
+            if ((unsigned int)(i * 64) >= 256 - shift) {
+                v[i] = 0;
+            } else if ((unsigned int)(i * 64 + 64) > 256 - shift) {
+                v[i] &= ~0ULL >> ((i * 64 + 64) - (256 - shift));
+            }
+        }
+        values.push_back(v);
+    }
+
+    for (const auto &v : values) {
+        checkValue(v.data());
+    }
+
+    uint64_t r[4];
+    const std::string twoTo256 = "115792089237316195423570985008687907853269984665640564039457584007913129639936";
+    expect(!FieldDecimal::fromDecimal(twoTo256.data(), twoTo256.size(), r), "fromDecimal accepts 2^256");
+    expect(!FieldDecimal::fromDecimal("", 0, r), "fromDecimal accepts an empty string");
+    expect(!FieldDecimal::fromDecimal("12a4", 4, r), "fromDecimal accepts a non-digit");
+
+    // ArrayWriter output is json::dump of the same strings, for 0, 1 and
+    // many elements, and ArrayReader reads it back
+    const size_t counts[] = {0, 1, values.size()};
+
+    for (size_t count : counts) {
+        std::string out;
+        json j;
+        FieldDecimal::ArrayWriter writer(out, count);
+
+        for (size_t i = 0; i < count; i++) {
+            writer.add(values[i].data());
+            j.push_back(gmpDecimal(values[i].data()));
+        }
+        writer.close();
+
+        expect(out == j.dump(), "ArrayWriter differs from json::dump for " + std::to_string(count) + " elements");
+
+        if (count == 0) {
+            continue;
+        }
+
+        FieldDecimal::ArrayReader reader(out.data(), out.size());
+        size_t n = 0;
+
+        while (reader.next(r)) {
+            expect(n < count && memcmp(r, values[n].data(), sizeof(r)) == 0, "ArrayReader does not read back element " + std::to_string(n));
+            n++;
+        }
+        expect(n == count, "ArrayReader read " + std::to_string(n) + " of " + std::to_string(count) + " elements");
+    }
+
+    const char *invalid[] = {"[\"1\",]", "[1]", "[\"1\"] x", "{\"a\":\"1\"}"};
+
+    for (const char *s : invalid) {
+        bool thrown = false;
+        try {
+            FieldDecimal::ArrayReader reader(s, strlen(s));
+            while (reader.next(r)) {}
+        } catch (std::invalid_argument &) {
+            thrown = true;
+        }
+        expect(thrown, std::string("ArrayReader accepts ") + s);
+    }
+
+    return TestUtils::result();
+}
@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fr.hpp"
+#include "fr_inline.hpp"
+#include "test_utils.hpp"
+
+// Checks FrInline, including its lazy [0, 4q) variants, against RawFr on
+// random and edge case elements.
+
+typedef RawFr::Element Element;
+
+static RawFr &F = RawFr::field;
+
+static void expectEqual(const Element &a, const Element &b, const char *op)
+{
+    TestUtils::expect(memcmp(&a, &b, sizeof(Element)) == 0, std::string("FrInline::") + op + " differs from RawFr");
+}
+
+// a + k * q, so the lazy ops see every representation they accept
+static Element addMultipleOfQ(const Element &a, unsigned int k)
+{
+    Element r = a;
+
+    for (unsigned int j = 0; j < k; j++) {
+        unsigned __int128 carry = 0;
+
+        for (int i = 0; i < 4; i++) {
+            carry += (unsigned __int128)r.v[i] + FrInline::q[i];
+            r.v[i] = (uint64_t)carry;
+            carry >>= 64;
+        }
+    }
+    return r;
+}
+
+int main()
+{
+    std::mt19937_64 rng(26);
+    std::vector<Element> values;
+
+    Element qMinusOne;
+    memcpy(qMinusOne.v, FrInline::q, sizeof(qMinusOne.v));
+    qMinusOne.v[0]--;
+
+    values.push_back(F.zero());
+    values.push_back(F.one());
+    values.push_back(qMinusOne);
+
+    for (int k = 0; k < 2000; k++) {
+        Element e;
+        for (int i = 0; i < 4; i++) {
+            e.v[i] = rng();
+        }
+        // Below 2^253 < q
+        e.v[3] &= 0x1fffffffffffffffULL;
+        values.push_back(e);
+    }
+
+    for (size_t k = 0; k < values.size(); k++) {
+        const Element &a = values[k];
+        const Element &b = values[(k * 7 + 1) % values.size()];
+        const Element &c = values[(k * 13 + 2) % values.size()];
+        Element expected, actual, t;
+
+        F.add(expected, a, b);
+        FrInline::add(actual, a, b);
+        expectEqual(expected, actual, "add");
+
+        F.sub(expected, a, b);
+        FrInline::sub(actual, a, b);
+        expectEqual(expected, actual, "sub");
+
+        F.mul(expected, a, b);
+        FrInline::mul(actual, a, b);
+        expectEqual(expected, actual, "mul");
+
+        F.square(expected, a);
+        FrInline::square(actual, a);
+        expectEqual(expected, actual, "square");
+
+        F.mul(t, a, b);
+        F.add(expected, t, c);
+        FrInline::mulAdd(actual, a, b, c);
+        expectEqual(expected, actual, "mulAdd");
+
+        for (unsigned int m = 0; m < 4; m++) {
+            F.mul(expected, a, b);
+            FrInline::mulLazy(actual, addMultipleOfQ(a, m), b);
+            FrInline::reduceFull(actual, actual);
+            expectEqual(expected, actual, "mulLazy");
+
+            F.copy(expected, a);
+            FrInline::reduceLazy(actual, addMultipleOfQ(a, m));
+            FrInline::reduceFull(actual, actual);
+            expectEqual(expected, actual, "reduceLazy");
+        }
+
+        for (unsigned int m = 0; m < 2; m++) {
+            const Element aLazy = addMultipleOfQ(a, m);
+            const Element bLazy = addMultipleOfQ(b, 1 - m);
+
+            F.add(expected, a, b);
+            FrInline::addLazy(actual, aLazy, bLazy);
+            FrInline::reduceFull(actual, actual);
+            expectEqual(expected, actual, "addLazy");
+
+            F.sub(expected, a, b);
+            FrInline::subLazy(actual, aLazy, bLazy);
+            FrInline::reduceFull(actual, actual);
+            expectEqual(expected, actual, "subLazy");
+        }
+    }
+
+    return TestUtils::result();
+}
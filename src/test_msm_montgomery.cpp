@@ -0,0 +1,205 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <alt_bn128.hpp>
+#include "msm_montgomery.hpp"
+#include "test_utils.hpp"
+
+// Checks MSMMontgomery, with normal and Montgomery form scalars and in batch
+// mode, against ffiasm's multiMulByScalarMSM on G1 and G2, and that a
+// cancelled control stops it part way.
+
+typedef AltBn128::Engine Engine;
+typedef Engine::FrElement Scalar;
+
+static Engine &E = Engine::engine;
+
+template <typename Curve>
+static void expectEqual(Curve &g, typename Curve::Point &expected, typename Curve::Point &actual, const std::string &what)
+{
+    TestUtils::expect(g.eq(expected, actual), what + " differs from multiMulByScalarMSM");
+}
+
+static Scalar randomScalar(std::mt19937_64 &rng)
+{
+    Scalar s;
+
+    for (int i = 0; i < 4; i++) {
+        s.v[i] = rng();
+    }
+    s.v[3] &= 0x1fffffffffffffffULL;
+
+    return s;
+}
+
+// n normal form scalars with the edge cases of the signed windows spread in:
+// zero, one and r - 1, the largest one
+static std::vector<Scalar> makeScalars(std::mt19937_64 &rng, uint64_t n)
+{
+    std::vector<Scalar> scalars(n);
+    Scalar rMinusOne;
+
+    E.fr.fromMontgomery(rMinusOne, E.fr.negOne());
+
+    for (uint64_t i = 0; i < n; i++) {
+        switch (rng() % 8) {
+        case 0: scalars[i] = E.fr.zero(); break;
+        case 1: E.fr.fromMontgomery(scalars[i], E.fr.one()); break;
+        case 2: scalars[i] = rMinusOne; break;
+        default: scalars[i] = randomScalar(rng);
+        }
+    }
+
+    return scalars;
+}
+
+template <typename Curve>
+static void checkCurve(Curve &g, const char *name, std::mt19937_64 &rng)
+{
+    typedef typename Curve::Point Point;
+    typedef typename Curve::PointAffine PointAffine;
+
+    const uint64_t sizes[] = {1, 2, 33, 1000};
+    const uint64_t maxSize = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+
+    // Random multiples of the generator, one of them the point at infinity
+    std::vector<PointAffine> bases(maxSize);
+
+    for (uint64_t i = 0; i < maxSize; i++) {
+        Scalar s = randomScalar(rng);
+        Point p;
+
+        g.mulByScalar(p, g.oneAffine(), (uint8_t *)&s, sizeof(s));
+        g.copy(bases[i], p);
+    }
+    g.copy(bases[maxSize / 2], g.zero());
+
+    for (uint64_t n : sizes) {
+        const std::string what = std::string(name) + " MSM of " + std::to_string(n);
+        std::vector<Scalar> scalars = makeScalars(rng, n);
+        Point expected, actual;
+
+        g.multiMulByScalarMSM(expected, bases.data(), (uint8_t *)scalars.data(), sizeof(Scalar), n);
+
+        MSMMontgomery<Curve, Engine::Fr>(g, E.fr, false).run(actual, bases.data(), scalars.data(), n);
+        expectEqual(g, expected, actual, what + " (normal form)");
+
+        std::vector<Scalar> montgomery(n);
+        for (uint64_t i = 0; i < n; i++) {
+            E.fr.toMontgomery(montgomery[i], scalars[i]);
+        }
+
+        MSMMontgomery<Curve, Engine::Fr>(g, E.fr).run(actual, bases.data(), montgomery.data(), n);
+        expectEqual(g, expected, actual, what + " (Montgomery form)");
+
+        // Batches of every size up to 5, the first array being 'scalars', in
+        // one pass, split by a digits limit, and one array per pass
+        const uint64_t digitsLimits[] = {UINT64_MAX, 300 * n, 1};
+        std::vector<std::vector<Scalar>> arrays(1, scalars);
+
+        for (size_t m = 2; m <= 5; m++) {
+            arrays.push_back(makeScalars(rng, n));
+
+            std::vector<const Scalar *> batch;
+            for (const auto &a : arrays) {
+                batch.push_back(a.data());
+            }
+
+            for (uint64_t limit : digitsLimits) {
+                MSMMontgomery<Curve, Engine::Fr> msm(g, E.fr, false);
+                std::vector<Point> results;
+
+                msm.setMaxBatchDigitsSize(limit);
+                msm.runBatch(results, bases.data(), batch, n);
+
+                for (size_t k = 0; k < m; k++) {
+                    g.multiMulByScalarMSM(expected, bases.data(), (uint8_t *)arrays[k].data(), sizeof(Scalar), n);
+                    expectEqual(g, expected, results[k],
+                                what + " (array " + std::to_string(k) + " of a batch of " + std::to_string(m) +
+                                ", digits limit " + std::to_string(limit) + ")");
+                }
+            }
+        }
+    }
+}
+
+// An MSM over CANCEL_SIZE points, far longer than CANCEL_DELAY, is cancelled
+// from another thread once running and must throw within CANCEL_BOUND
+static const uint64_t CANCEL_SIZE = 1 << 20;
+static const std::chrono::milliseconds CANCEL_DELAY(20);
+static const std::chrono::milliseconds CANCEL_BOUND(1000);
+
+static void checkCancel(std::mt19937_64 &rng)
+{
+    typedef Engine::G1Point Point;
+    typedef Engine::G1PointAffine PointAffine;
+
+    const uint64_t nDistinct = 64;
+    std::vector<PointAffine> bases(CANCEL_SIZE);
+    std::vector<Scalar> scalars = makeScalars(rng, CANCEL_SIZE);
+    Point r;
+
+    for (uint64_t i = 0; i < nDistinct; i++) {
+        Scalar s = randomScalar(rng);
+        Point p;
+
+        E.g1.mulByScalar(p, E.g1.oneAffine(), (uint8_t *)&s, sizeof(s));
+        E.g1.copy(bases[i], p);
+    }
+    for (uint64_t i = nDistinct; i < CANCEL_SIZE; i++) {
+        bases[i] = bases[i % nDistinct];
+    }
+
+    ProveControl cancelled;
+    bool thrown = false;
+
+    cancelled.cancel();
+
+    try {
+        MSMMontgomery<Engine::G1, Engine::Fr>(E.g1, E.fr, false, &cancelled).run(r, bases.data(), scalars.data(), CANCEL_SIZE);
+    } catch (ProveCancelled &) {
+        thrown = true;
+    }
+    TestUtils::expect(thrown, "An MSM under a cancelled control runs");
+
+    ProveControl control;
+    std::chrono::steady_clock::time_point cancelTime;
+    std::thread canceller([&control, &cancelTime] {
+        std::this_thread::sleep_for(CANCEL_DELAY);
+        cancelTime = std::chrono::steady_clock::now();
+        control.cancel();
+    });
+
+    thrown = false;
+
+    try {
+        MSMMontgomery<Engine::G1, Engine::Fr>(E.g1, E.fr, false, &control).run(r, bases.data(), scalars.data(), CANCEL_SIZE);
+    } catch (ProveCancelled &) {
+        thrown = true;
+    }
+
+    const auto stopTime = std::chrono::steady_clock::now();
+    canceller.join();
+
+    TestUtils::expect(thrown, "An MSM cancelled while running completes");
+    TestUtils::expect(!thrown || stopTime - cancelTime < CANCEL_BOUND,
+                      "An MSM cancelled while running takes over " + std::to_string(CANCEL_BOUND.count()) + " ms to stop");
+}
+
+int main()
+{
+    std::mt19937_64 rng(26);
+
+    checkCurve(E.g1, "G1", rng);
+    checkCurve(E.g2, "G2", rng);
+    checkCancel(rng);
+
+    return TestUtils::result();
+}
@@ -0,0 +1,114 @@
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <alt_bn128.hpp>
+#include "fq2.hpp"
+#include "point_compression.hpp"
+#include "test_utils.hpp"
+
+// Compresses and decompresses random G1 and G2 points, with both y roots and
+// the point at infinity, and checks that x coordinates without a point are
+// rejected.
+
+typedef AltBn128::Engine Engine;
+
+static Engine &E = Engine::engine;
+
+static const uint64_t N_POINTS = 1000;
+
+using TestUtils::expect;
+
+// Random multiples of the generator and their negations, in the zkey layout,
+// with the point at infinity first
+template <typename Curve>
+static std::vector<typename Curve::PointAffine> makePoints(Curve &g, std::mt19937_64 &rng)
+{
+    std::vector<typename Curve::PointAffine> points(N_POINTS);
+
+    memset(&points[0], 0, sizeof(points[0]));
+
+    for (uint64_t i = 1; i < N_POINTS; i += 2) {
+        typename Engine::FrElement s;
+        typename Curve::Point p;
+
+        for (int k = 0; k < 4; k++) {
+            s.v[k] = rng();
+        }
+        s.v[3] &= 0x1fffffffffffffffULL;
+
+        g.mulByScalar(p, g.oneAffine(), (uint8_t *)&s, sizeof(s));
+        g.copy(points[i], p);
+
+        if (i + 1 < N_POINTS) {
+            g.neg(points[i + 1], points[i]);
+        }
+    }
+
+    return points;
+}
+
+template <typename Curve>
+static void checkRoundTrip(Curve &g, const char *name, uint64_t compressedSize,
+                           void (*compress)(uint8_t *, const void *, uint64_t),
+                           void (*decompress)(void *, const uint8_t *, uint64_t),
+                           std::mt19937_64 &rng)
+{
+    std::vector<typename Curve::PointAffine> points = makePoints(g, rng);
+    std::vector<uint8_t> compressed(N_POINTS * compressedSize);
+    std::vector<typename Curve::PointAffine> decompressed(N_POINTS);
+
+    compress(compressed.data(), points.data(), N_POINTS);
+
+    expect(compressed[compressedSize - 1] & ZKeyUtils::COMPRESSED_INFINITY,
+           std::string(name) + " point at infinity is not flagged");
+
+    decompress(decompressed.data(), compressed.data(), N_POINTS);
+
+    for (uint64_t i = 0; i < N_POINTS; i++) {
+        expect(memcmp(&points[i], &decompressed[i], sizeof(points[i])) == 0,
+               std::string(name) + " point #" + std::to_string(i) + " does not survive compression");
+    }
+}
+
+// Moves the x of a compressed point until it has no point on the curve
+static bool rejectsOffCurve(uint8_t *compressed, uint64_t size,
+                            void (*decompress)(void *, const uint8_t *, uint64_t))
+{
+    std::vector<uint8_t> point(4 * size);
+
+    for (int k = 0; k < 64; k++) {
+        compressed[0]++;
+        try {
+            decompress(point.data(), compressed, 1);
+        } catch (std::invalid_argument &) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int main()
+{
+    std::mt19937_64 rng(36);
+
+    checkRoundTrip(E.g1, "G1", ZKeyUtils::G1_COMPRESSED_SIZE,
+                   ZKeyUtils::compressG1Points, ZKeyUtils::decompressG1Points, rng);
+    checkRoundTrip(E.g2, "G2", ZKeyUtils::G2_COMPRESSED_SIZE,
+                   ZKeyUtils::compressG2Points, ZKeyUtils::decompressG2Points, rng);
+
+    uint8_t g1[ZKeyUtils::G1_COMPRESSED_SIZE];
+    uint8_t g2[ZKeyUtils::G2_COMPRESSED_SIZE];
+
+    ZKeyUtils::compressG1Points(g1, &E.g1.oneAffine(), 1);
+    ZKeyUtils::compressG2Points(g2, &E.g2.oneAffine(), 1);
+
+    expect(rejectsOffCurve(g1, sizeof(g1), ZKeyUtils::decompressG1Points), "G1 decompression accepts any x");
+    expect(rejectsOffCurve(g2, sizeof(g2), ZKeyUtils::decompressG2Points), "G2 decompression accepts any x");
+
+    return TestUtils::result();
+}
@@ -0,0 +1,77 @@
+#include <string>
+#include <vector>
+
+#include "test_utils.hpp"
+
+// Rerandomizes a proof of the witness of testdata with
+// groth16_proof_rerandomize: the new proofs verify with the public signals of
+// the original, differ from it and from each other, and a short buffer or a
+// malformed proof is refused.
+
+static int rerandomize(void *prover, const std::string &proof, std::string &out, unsigned long long &size)
+{
+    std::vector<char> buffer(size + 1);
+    char errorMsg[256] = {0};
+
+    const int status = groth16_proof_rerandomize(prover, proof.c_str(), buffer.data(), &size,
+                                                 errorMsg, sizeof(errorMsg) - 1);
+    if (status == PROVER_OK) {
+        out = buffer.data();
+    }
+
+    return status;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        std::cerr << "Usage: test_proof_rerandomize <testdata>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    TestUtils::Groth16Data data(argv[1]);
+    void *prover = nullptr;
+    char errorMsg[256] = {0};
+
+    if (groth16_prover_create(&prover, data.zkey.data(), data.zkey.size(), errorMsg, sizeof(errorMsg) - 1) != PROVER_OK) {
+        std::cerr << "Error: " << errorMsg << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    TestUtils::ProveResult r = TestUtils::prove(prover, data, data.wtns);
+
+    if (r.status != PROVER_OK) {
+        std::cerr << "Error: " << r.error << std::endl;
+        groth16_prover_destroy(prover);
+        return EXIT_FAILURE;
+    }
+
+    unsigned long long proofSize = 0;
+    std::string first, second;
+
+    groth16_proof_size(&proofSize);
+
+    int status = rerandomize(prover, r.proof, first, proofSize);
+    TestUtils::expect(status == PROVER_OK, "Rerandomizing a proof returns " + std::to_string(status));
+    TestUtils::expect(TestUtils::verify(data, first, r.publicSignals), "A rerandomized proof does not verify");
+    TestUtils::expect(first != r.proof, "A rerandomized proof is the original");
+
+    status = rerandomize(prover, first, second, proofSize);
+    TestUtils::expect(status == PROVER_OK, "Rerandomizing a rerandomized proof returns " + std::to_string(status));
+    TestUtils::expect(TestUtils::verify(data, second, r.publicSignals), "A twice rerandomized proof does not verify");
+    TestUtils::expect(second != first && second != r.proof, "A twice rerandomized proof repeats an earlier one");
+
+    unsigned long long shortSize = 10;
+    std::string unused;
+
+    status = rerandomize(prover, r.proof, unused, shortSize);
+    TestUtils::expect(status == PROVER_ERROR_SHORT_BUFFER, "A short buffer returns " + std::to_string(status));
+    TestUtils::expect(status != PROVER_ERROR_SHORT_BUFFER || shortSize > 10, "A short buffer gets no required size");
+
+    status = rerandomize(prover, "not a proof", unused, proofSize);
+    TestUtils::expect(status == PROVER_ERROR, "A malformed proof returns " + std::to_string(status));
+
+    groth16_prover_destroy(prover);
+
+    return TestUtils::result();
+}
@@ -0,0 +1,81 @@
+#include <string>
+#include <vector>
+
+#include "test_utils.hpp"
+
+// Proves batches of the testdata witness and checks that every proof of the
+// batch verifies, has the public signals of a single proof, and is blinded
+// on its own.
+
+static const unsigned long long BATCH_SIZES[] = {1, 2, 5};
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        std::cerr << "Usage: test_prove_batch <testdata>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    TestUtils::Groth16Data data(argv[1]);
+    void *prover = nullptr;
+    char errorMsg[256] = {0};
+
+    if (groth16_prover_create(&prover, data.zkey.data(), data.zkey.size(), errorMsg, sizeof(errorMsg) - 1) != PROVER_OK) {
+        std::cerr << "Error: " << errorMsg << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const TestUtils::ProveResult single = TestUtils::prove(prover, data, data.wtns);
+
+    TestUtils::expect(single.status == PROVER_OK, "prove: " + single.error);
+
+    unsigned long long proofSize = 0;
+    unsigned long long publicSize = 0;
+
+    groth16_proof_size(&proofSize);
+    groth16_public_size_for_zkey_buf(data.zkey.data(), data.zkey.size(), &publicSize, errorMsg, sizeof(errorMsg) - 1);
+
+    for (unsigned long long count : BATCH_SIZES) {
+        const std::string batch = "Batch of " + std::to_string(count);
+
+        std::vector<const void *> wtnsBuffers(count, data.wtns.data());
+        std::vector<unsigned long long> wtnsSizes(count, data.wtns.size());
+        std::vector<std::vector<char>> proofs(count, std::vector<char>(proofSize));
+        std::vector<std::vector<char>> publics(count, std::vector<char>(publicSize));
+        std::vector<char *> proofBuffers, publicBuffers;
+        std::vector<unsigned long long> proofSizes(count, proofSize), publicSizes(count, publicSize);
+
+        for (unsigned long long k = 0; k < count; k++) {
+            proofBuffers.push_back(proofs[k].data());
+            publicBuffers.push_back(publics[k].data());
+        }
+
+        const int status = groth16_prover_prove_batch(prover, count, wtnsBuffers.data(), wtnsSizes.data(),
+                                                      proofBuffers.data(), proofSizes.data(),
+                                                      publicBuffers.data(), publicSizes.data(),
+                                                      errorMsg, sizeof(errorMsg) - 1);
+
+        TestUtils::expect(status == PROVER_OK, batch + ": " + errorMsg);
+
+        if (status != PROVER_OK) {
+            continue;
+        }
+
+        for (unsigned long long k = 0; k < count; k++) {
+            const std::string what = batch + ", proof " + std::to_string(k);
+            const std::string proof = proofs[k].data();
+            const std::string publicSignals = publics[k].data();
+
+            TestUtils::expect(publicSignals == single.publicSignals, what + " has other public signals");
+            TestUtils::expect(TestUtils::verify(data, proof, publicSignals), what + " does not verify");
+
+            if (k > 0) {
+                TestUtils::expect(proof != std::string(proofs[k - 1].data()), what + " is the previous proof");
+            }
+        }
+    }
+
+    groth16_prover_destroy(prover);
+
+    return TestUtils::result();
+}
@@ -0,0 +1,151 @@
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "binfile_utils.hpp"
+#include "field_decimal.hpp"
+#include "fr_inline.hpp"
+#include "test_utils.hpp"
+
+using json = nlohmann::json;
+
+// Proves the witness of testdata in binary and checks it against the JSON
+// output: the public signals are the same values, and the proof, converted
+// back to JSON, verifies. A witness with its public signals given unreduced
+// (plus r) must output the same public signals in both formats.
+
+static const size_t WORD_SIZE = 32;
+
+static std::string wordDecimal(const uint8_t *word)
+{
+    uint64_t v[4] = {0, 0, 0, 0};
+    char digits[FieldDecimal::MAX_DIGITS];
+
+    for (size_t i = 0; i < WORD_SIZE; i++) {
+        v[3 - i / 8] = (v[3 - i / 8] << 8) | word[i];
+    }
+
+    return std::string(digits, FieldDecimal::toDecimal(v, digits));
+}
+
+// A proof in the EVM calldata layout as snarkjs JSON
+static std::string proofJson(const std::vector<uint8_t> &proof)
+{
+    auto word = [&proof] (size_t i) { return wordDecimal(&proof[i * WORD_SIZE]); };
+    json p;
+
+    p["pi_a"] = {word(0), word(1), "1"};
+    p["pi_b"] = {{word(3), word(2)}, {word(5), word(4)}, {"1", "0"}};
+    p["pi_c"] = {word(6), word(7), "1"};
+    p["protocol"] = "groth16";
+
+    return p.dump();
+}
+
+static std::string publicJson(const std::vector<uint8_t> &publicSignals)
+{
+    json p = json::array();
+
+    for (size_t i = 0; i < publicSignals.size(); i += WORD_SIZE) {
+        p.push_back(wordDecimal(&publicSignals[i]));
+    }
+
+    return p.dump();
+}
+
+// Proves in binary, asking for the buffer sizes with empty buffers first
+static bool proveBinary(void *prover, const std::string &wtns,
+                        std::vector<uint8_t> &proof, std::vector<uint8_t> &publicSignals)
+{
+    unsigned long long proofSize = 0;
+    unsigned long long publicSize = 0;
+    unsigned long long binarySize = 0;
+    uint8_t empty[1];
+    char errorMsg[256] = {0};
+
+    int status = groth16_prover_prove_binary(prover, wtns.data(), wtns.size(), empty, &proofSize,
+                                             empty, &publicSize, errorMsg, sizeof(errorMsg) - 1);
+
+    groth16_proof_binary_size(&binarySize);
+
+    TestUtils::expect(status == PROVER_ERROR_SHORT_BUFFER && proofSize == binarySize,
+                      "prove_binary does not report the proof size");
+
+    proof.resize(proofSize);
+    publicSignals.resize(publicSize);
+
+    status = groth16_prover_prove_binary(prover, wtns.data(), wtns.size(), proof.data(), &proofSize,
+                                         publicSignals.data(), &publicSize, errorMsg, sizeof(errorMsg) - 1);
+
+    TestUtils::expect(status == PROVER_OK, std::string("prove_binary: ") + errorMsg);
+
+    return status == PROVER_OK;
+}
+
+// 'wtns' with r added to its public signals, which stay below 2^256
+static std::string unreducedWitness(const std::string &wtns, uint32_t nPublic)
+{
+    std::string out = wtns;
+    BinFileUtils::BinFile f(out.data(), out.size(), "wtns", 2);
+    uint64_t *signals = (uint64_t *)f.getSectionData(2);
+
+    for (uint32_t i = 1; i <= nPublic; i++) {
+        uint64_t *v = signals + i * 4;
+        unsigned __int128 carry = 0;
+
+        for (int k = 0; k < 4; k++) {
+            carry += (unsigned __int128)v[k] + FrInline::q[k];
+            v[k] = (uint64_t)carry;
+            carry >>= 64;
+        }
+    }
+
+    return out;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        std::cerr << "Usage: test_prove_binary <testdata>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    TestUtils::Groth16Data data(argv[1]);
+    void *prover = nullptr;
+    char errorMsg[256] = {0};
+
+    if (groth16_prover_create(&prover, data.zkey.data(), data.zkey.size(), errorMsg, sizeof(errorMsg) - 1) != PROVER_OK) {
+        std::cerr << "Error: " << errorMsg << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    TestUtils::ProveResult expected = TestUtils::prove(prover, data, data.wtns);
+    std::vector<uint8_t> proof, publicSignals;
+
+    TestUtils::expect(expected.status == PROVER_OK, "prove: " + expected.error);
+
+    if (expected.status == PROVER_OK && proveBinary(prover, data.wtns, proof, publicSignals)) {
+        TestUtils::expect(publicJson(publicSignals) == json::parse(expected.publicSignals).dump(),
+                          "The binary public signals differ from the JSON ones");
+        TestUtils::expect(TestUtils::verify(data, proofJson(proof), expected.publicSignals),
+                          "The binary proof does not verify");
+
+        const uint32_t nPublic = publicSignals.size() / WORD_SIZE;
+        const std::string unreduced = unreducedWitness(data.wtns, nPublic);
+        TestUtils::ProveResult r = TestUtils::prove(prover, data, unreduced);
+
+        TestUtils::expect(r.status == PROVER_OK && r.publicSignals == expected.publicSignals,
+                          "Unreduced public signals change the JSON output");
+
+        if (proveBinary(prover, unreduced, proof, publicSignals)) {
+            TestUtils::expect(publicJson(publicSignals) == json::parse(expected.publicSignals).dump(),
+                              "Unreduced public signals change the binary output");
+        }
+    }
+
+    groth16_prover_destroy(prover);
+
+    return TestUtils::result();
+}
@@ -0,0 +1,155 @@
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "test_utils.hpp"
+
+// Cancels proofs of the testdata circuit through controls passed per proof:
+// a proof cancelled once its first MSM is done returns PROVER_ERROR_CANCELLED
+// within CANCEL_BOUND, and neither that control nor one set on the prover
+// object stops the other proofs of the same object. Cancelling within an MSM
+// is checked on a large MSM by test_msm_montgomery.
+
+static const std::chrono::milliseconds CANCEL_BOUND(1000);
+
+// A control that cancels itself from the progress callback of its proof once
+// 'stages' stages are done, never for 0
+struct SelfCancelling {
+    void *control = nullptr;
+    unsigned int cancelAfter;
+    std::chrono::steady_clock::time_point cancelTime;
+
+    explicit SelfCancelling(unsigned int stages)
+        : cancelAfter(stages)
+    {
+        char errorMsg[256] = {0};
+
+        if (prover_control_create(&control, progress, this, errorMsg, sizeof(errorMsg) - 1) != PROVER_OK) {
+            throw std::runtime_error(std::string("prover_control_create: ") + errorMsg);
+        }
+    }
+
+    ~SelfCancelling() { prover_control_destroy(control); }
+
+    static void progress(void *userData, const char *, unsigned int done, unsigned int)
+    {
+        SelfCancelling *self = static_cast<SelfCancelling *>(userData);
+
+        if (done == self->cancelAfter) {
+            self->cancelTime = std::chrono::steady_clock::now();
+            prover_control_cancel(self->control);
+        }
+    }
+};
+
+// Outcome of an asynchronous proof
+struct AsyncResult {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    int status = PROVER_ERROR;
+    std::string proof;
+    std::string publicSignals;
+
+    static void callback(void *userData, int status, const char *proof, unsigned long long,
+                         const char *publicSignals, unsigned long long, const char *)
+    {
+        AsyncResult *r = static_cast<AsyncResult *>(userData);
+        std::lock_guard<std::mutex> guard(r->mutex);
+
+        r->status = status;
+        if (status == PROVER_OK) {
+            r->proof = proof;
+            r->publicSignals = publicSignals;
+        }
+        r->done = true;
+        r->cv.notify_all();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return done; });
+    }
+};
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        std::cerr << "Usage: test_prove_cancel <testdata>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    TestUtils::Groth16Data data(argv[1]);
+    void *prover = nullptr;
+    char errorMsg[256] = {0};
+
+    if (groth16_prover_create(&prover, data.zkey.data(), data.zkey.size(), errorMsg, sizeof(errorMsg) - 1) != PROVER_OK) {
+        std::cerr << "Error: " << errorMsg << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    SelfCancelling cancelled(1);
+    SelfCancelling other(0);
+
+    TestUtils::ProveResult r = TestUtils::prove(prover, data, data.wtns, cancelled.control);
+    const auto stopTime = std::chrono::steady_clock::now();
+
+    TestUtils::expect(r.status == PROVER_ERROR_CANCELLED, "A proof cancelled after its first MSM returns " + std::to_string(r.status));
+    TestUtils::expect(r.status != PROVER_ERROR_CANCELLED || stopTime - cancelled.cancelTime < CANCEL_BOUND,
+                      "A cancelled proof takes over " + std::to_string(CANCEL_BOUND.count()) + " ms to stop");
+
+    // The cancelled control only belongs to its own proofs
+    TestUtils::expectValidProof(prover, data, data.wtns, "A proof after a cancelled one");
+    TestUtils::expectValidProof(prover, data, data.wtns, "A proof under another control", other.control);
+
+    // A control passed to the proof takes the place of the object's
+    groth16_prover_set_control(prover, cancelled.control, errorMsg, sizeof(errorMsg) - 1);
+
+    TestUtils::expectValidProof(prover, data, data.wtns, "A proof under its own control", other.control);
+    r = TestUtils::prove(prover, data, data.wtns);
+    TestUtils::expect(r.status == PROVER_ERROR_CANCELLED, "A proof under the object's cancelled control returns " + std::to_string(r.status));
+
+    groth16_prover_set_control(prover, nullptr, errorMsg, sizeof(errorMsg) - 1);
+
+    // Batched and asynchronous proofs
+    const void *wtnsBuffers[2] = {data.wtns.data(), data.wtns.data()};
+    unsigned long long wtnsSizes[2] = {data.wtns.size(), data.wtns.size()};
+    unsigned long long proofSizes[2], publicSizes[2];
+    std::vector<char> outputs[4];
+    char *proofBuffers[2], *publicBuffers[2];
+
+    for (int k = 0; k < 2; k++) {
+        groth16_proof_size(&proofSizes[k]);
+        groth16_public_size_for_zkey_buf(data.zkey.data(), data.zkey.size(), &publicSizes[k], errorMsg, sizeof(errorMsg) - 1);
+        outputs[k].resize(proofSizes[k]);
+        outputs[k + 2].resize(publicSizes[k]);
+        proofBuffers[k] = outputs[k].data();
+        publicBuffers[k] = outputs[k + 2].data();
+    }
+
+    int status = groth16_prover_prove_batch_control(prover, cancelled.control, 2, wtnsBuffers, wtnsSizes,
+                                                    proofBuffers, proofSizes, publicBuffers, publicSizes,
+                                                    errorMsg, sizeof(errorMsg) - 1);
+    TestUtils::expect(status == PROVER_ERROR_CANCELLED, "A cancelled batch returns " + std::to_string(status));
+
+    AsyncResult cancelledAsync, otherAsync;
+
+    groth16_prover_prove_async_control(prover, cancelled.control, data.wtns.data(), data.wtns.size(),
+                                       AsyncResult::callback, &cancelledAsync, errorMsg, sizeof(errorMsg) - 1);
+    groth16_prover_prove_async_control(prover, other.control, data.wtns.data(), data.wtns.size(),
+                                       AsyncResult::callback, &otherAsync, errorMsg, sizeof(errorMsg) - 1);
+    cancelledAsync.wait();
+    otherAsync.wait();
+
+    TestUtils::expect(cancelledAsync.status == PROVER_ERROR_CANCELLED,
+                      "A cancelled asynchronous proof completes with " + std::to_string(cancelledAsync.status));
+    TestUtils::expect(otherAsync.status == PROVER_OK && TestUtils::verify(data, otherAsync.proof, otherAsync.publicSignals),
+                      "An asynchronous proof queued after a cancelled one fails");
+
+    groth16_prover_destroy(prover);
+
+    return TestUtils::result();
+}
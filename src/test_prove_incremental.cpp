@@ -0,0 +1,84 @@
+#include <string>
+
+#include "binfile_utils.hpp"
+#include "test_utils.hpp"
+
+// Proves the witness of testdata against base witnesses set with
+// groth16_prover_set_base_witness: the same witness, one that differs in a
+// few signals (the MSMs then run over those only), one that differs in every
+// signal (proved in full), and after the base is dropped. Every proof must
+// verify. There is no UltraGroth circuit to prove in testdata, so
+// ultra_groth_prover_set_base_witness is not run here.
+
+// A copy of 'wtns' with the low bit of each listed signal flipped, which keeps
+// the values below the field prime
+static std::string changeSignals(const std::string &wtns, const std::vector<uint64_t> &signals)
+{
+    BinFileUtils::BinFile f(wtns.data(), wtns.size(), "wtns", 2);
+    const size_t offset = (const char *)f.getSectionData(2) - wtns.data();
+    const uint64_t nSignals = f.getSectionSize(2) / 32;
+    std::string changed = wtns;
+
+    for (uint64_t i : signals) {
+        if (i < nSignals) {
+            changed[offset + i * 32] ^= 1;
+        }
+    }
+
+    return changed;
+}
+
+static int setBase(void *prover, const std::string *wtns)
+{
+    char errorMsg[256] = {0};
+
+    return groth16_prover_set_base_witness(prover, wtns != nullptr ? wtns->data() : nullptr,
+                                           wtns != nullptr ? wtns->size() : 0, errorMsg, sizeof(errorMsg) - 1);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        std::cerr << "Usage: test_prove_incremental <testdata>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    TestUtils::Groth16Data data(argv[1]);
+    void *prover = nullptr;
+    char errorMsg[256] = {0};
+
+    if (groth16_prover_create(&prover, data.zkey.data(), data.zkey.size(), errorMsg, sizeof(errorMsg) - 1) != PROVER_OK) {
+        std::cerr << "Error: " << errorMsg << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    BinFileUtils::BinFile wtns(data.wtns.data(), data.wtns.size(), "wtns", 2);
+    const uint64_t nSignals = wtns.getSectionSize(2) / 32;
+
+    // A public signal, so the C MSM skips it, and the last two private ones
+    const std::string fewChanged = changeSignals(data.wtns, {1, nSignals - 2, nSignals - 1});
+
+    std::vector<uint64_t> every;
+
+    for (uint64_t i = 1; i < nSignals; i++) {
+        every.push_back(i);
+    }
+    const std::string allChanged = changeSignals(data.wtns, every);
+
+    TestUtils::expect(setBase(prover, &data.wtns) == PROVER_OK, "The witness is refused as a base");
+    TestUtils::expectValidProof(prover, data, data.wtns, "A proof of the base witness");
+    TestUtils::expectValidProof(prover, data, data.wtns, "A second proof of the base witness");
+
+    TestUtils::expect(setBase(prover, &fewChanged) == PROVER_OK, "A base with a few changed signals is refused");
+    TestUtils::expectValidProof(prover, data, data.wtns, "A proof over the changed signals");
+
+    TestUtils::expect(setBase(prover, &allChanged) == PROVER_OK, "A base with every signal changed is refused");
+    TestUtils::expectValidProof(prover, data, data.wtns, "A proof from a distant base");
+
+    TestUtils::expect(setBase(prover, nullptr) == PROVER_OK, "The base can not be dropped");
+    TestUtils::expectValidProof(prover, data, data.wtns, "A proof without a base");
+
+    groth16_prover_destroy(prover);
+
+    return TestUtils::result();
+}
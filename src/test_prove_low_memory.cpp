@@ -0,0 +1,147 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "binfile_utils.hpp"
+#include "test_utils.hpp"
+
+// Proves a witness of testdata/random_ultra_groth.zkey with and without
+// PROVER_OPTION_LOW_MEMORY, and across a warmup, which keeps the H arrays
+// that the option then frees. The zkey's points are random, so its proofs do
+// not verify: each proof must succeed, have the public signals of the
+// witness and parse as a proof.
+
+static void putU32(std::string &out, uint32_t v)
+{
+    out.append((const char *)&v, sizeof(v));
+}
+
+static void putSection(std::string &out, uint32_t id, const std::string &data)
+{
+    const uint64_t size = data.size();
+
+    putU32(out, id);
+    out.append((const char *)&size, sizeof(size));
+    out += data;
+}
+
+// A witness of 'nVars' small signals and no lookups, with the field header of
+// the testdata witness
+static std::string makeWitness(const std::string &testdataWtns, uint32_t nVars)
+{
+    BinFileUtils::BinFile f(testdataWtns.data(), testdataWtns.size(), "wtns", 2);
+    std::string header((const char *)f.getSectionData(1), f.getSectionSize(1));
+    std::string signals(nVars * 32, '\0');
+    std::string wtns = "wtns";
+
+    std::memcpy(&header[header.size() - 4], &nVars, sizeof(nVars));
+
+    for (uint32_t i = 0; i < nVars; i++) {
+        signals[i * 32] = (char)(i + 1);
+    }
+
+    putU32(wtns, 2);
+    putU32(wtns, 6);
+    putSection(wtns, 1, header);
+    putSection(wtns, 2, signals);
+
+    for (uint32_t id = 3; id <= 6; id++) {
+        putSection(wtns, id, "");
+    }
+
+    return wtns;
+}
+
+static bool setLowMemory(void *prover, bool enable)
+{
+    char errorMsg[256] = {0};
+
+    return ultra_groth_prover_set_option(prover, PROVER_OPTION_LOW_MEMORY, enable ? 1 : 0,
+                                         errorMsg, sizeof(errorMsg) - 1) == PROVER_OK;
+}
+
+static void expectProof(void *prover, const std::string &zkey, const std::string &wtns,
+                        std::string &publicSignals, const std::string &what)
+{
+    unsigned long long proofSize = 0;
+    unsigned long long publicSize = 0;
+    char errorMsg[256] = {0};
+
+    ultra_groth_proof_size(&proofSize);
+    ultra_groth_public_size_for_zkey_buf(zkey.data(), zkey.size(), &publicSize, errorMsg, sizeof(errorMsg) - 1);
+
+    std::vector<char> proof(proofSize);
+    std::vector<char> publicBuffer(publicSize);
+
+    const int status = ultra_groth_prover_prove(prover, wtns.data(), wtns.size(),
+                                                proof.data(), &proofSize, publicBuffer.data(), &publicSize,
+                                                errorMsg, sizeof(errorMsg) - 1);
+
+    TestUtils::expect(status == PROVER_OK, what + " returns " + std::to_string(status) + ": " + errorMsg);
+
+    if (status != PROVER_OK) {
+        return;
+    }
+
+    const std::string json = proof.data();
+
+    TestUtils::expect(json.find("\"pi_a\"") != std::string::npos && json.find("\"pi_b\"") != std::string::npos
+                      && json.find("\"pi_c\"") != std::string::npos, what + " is not a proof: " + json);
+
+    if (publicSignals.empty()) {
+        publicSignals = publicBuffer.data();
+    }
+    TestUtils::expect(publicSignals == publicBuffer.data(), what + " has other public signals");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        std::cerr << "Usage: test_prove_low_memory <testdata>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string zkey = TestUtils::readFile(std::string(argv[1]) + "/random_ultra_groth.zkey");
+    const std::string testdataWtns = TestUtils::readFile(std::string(argv[1]) + "/witness.wtns");
+    void *prover = nullptr;
+    char errorMsg[256] = {0};
+
+    if (ultra_groth_prover_create(&prover, zkey.data(), zkey.size(), errorMsg, sizeof(errorMsg) - 1) != PROVER_OK) {
+        std::cerr << "Error: " << errorMsg << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The nVars of the zkey header
+    BinFileUtils::BinFile zkeyFile(zkey.data(), zkey.size(), "zkey", 1);
+    const char *zkeyHeader = (const char *)zkeyFile.getSectionData(2);
+    uint32_t n8q, n8r, nVars;
+
+    std::memcpy(&n8q, zkeyHeader, 4);
+    std::memcpy(&n8r, zkeyHeader + 4 + n8q, 4);
+    std::memcpy(&nVars, zkeyHeader + 8 + n8q + n8r, 4);
+
+    const std::string wtns = makeWitness(testdataWtns, nVars);
+    std::string publicSignals;
+
+    expectProof(prover, zkey, wtns, publicSignals, "A proof");
+
+    TestUtils::expect(setLowMemory(prover, true), "The low-memory option is refused");
+    expectProof(prover, zkey, wtns, publicSignals, "A low-memory proof");
+    expectProof(prover, zkey, wtns, publicSignals, "A second low-memory proof");
+
+    TestUtils::expect(setLowMemory(prover, false), "The low-memory option can not be cleared");
+    TestUtils::expect(ultra_groth_prover_warmup(prover, errorMsg, sizeof(errorMsg) - 1) == PROVER_OK,
+                      std::string("The warmup fails: ") + errorMsg);
+    expectProof(prover, zkey, wtns, publicSignals, "A proof after a warmup");
+
+    // Frees the H arrays the warmup kept
+    TestUtils::expect(setLowMemory(prover, true), "The low-memory option is refused after a warmup");
+    expectProof(prover, zkey, wtns, publicSignals, "A low-memory proof after a warmup");
+
+    TestUtils::expect(setLowMemory(prover, false), "The low-memory option can not be cleared again");
+    expectProof(prover, zkey, wtns, publicSignals, "A proof after the low-memory ones");
+
+    ultra_groth_prover_destroy(prover);
+
+    return TestUtils::result();
+}
@@ -0,0 +1,128 @@
+#ifndef TEST_UTILS_HPP
+#define TEST_UTILS_HPP
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "prover.h"
+#include "verifier.h"
+
+// Failure counting shared by the test programs: each check calls expect, the
+// first failures are printed, and main returns result(). The proof tests get
+// the testdata directory as their first argument.
+
+namespace TestUtils {
+
+    // Failures printed before the rest are only counted
+    const int MAX_PRINTED = 10;
+
+    inline int &failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    inline void expect(bool ok, const std::string &what)
+    {
+        if (!ok && failures()++ < MAX_PRINTED) {
+            std::cerr << what << std::endl;
+        }
+    }
+
+    // Exit status of the test program
+    inline int result()
+    {
+        if (failures() > 0) {
+            std::cerr << failures() << " failures" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    inline std::string readFile(const std::string &path)
+    {
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file) {
+            throw std::runtime_error("Can not read " + path);
+        }
+
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    // The Groth16 circuit of testdata
+    struct Groth16Data {
+        std::string zkey;
+        std::string wtns;
+        std::string verificationKey;
+
+        explicit Groth16Data(const std::string &dir)
+            : zkey(readFile(dir + "/circuit_final.zkey")),
+              wtns(readFile(dir + "/witness.wtns")),
+              verificationKey(readFile(dir + "/verification_key.json")) {}
+    };
+
+    // Outcome of a proof through the C API, 'proof' and 'publicSignals' set
+    // on PROVER_OK and 'error' otherwise
+    struct ProveResult {
+        int status;
+        std::string proof;
+        std::string publicSignals;
+        std::string error;
+    };
+
+    // Under 'control' if not null, else under the control of the prover object
+    inline ProveResult prove(void *prover, const Groth16Data &data, const std::string &wtns, void *control = nullptr)
+    {
+        unsigned long long proofSize = 0;
+        unsigned long long publicSize = 0;
+        char errorMsg[256] = {0};
+
+        groth16_proof_size(&proofSize);
+        groth16_public_size_for_zkey_buf(data.zkey.data(), data.zkey.size(), &publicSize,
+                                         errorMsg, sizeof(errorMsg) - 1);
+
+        std::vector<char> proofBuffer(proofSize);
+        std::vector<char> publicBuffer(publicSize);
+        ProveResult r;
+
+        r.status = groth16_prover_prove_control(prover, control, wtns.data(), wtns.size(),
+                                                proofBuffer.data(), &proofSize, publicBuffer.data(), &publicSize,
+                                                errorMsg, sizeof(errorMsg) - 1);
+
+        if (r.status == PROVER_OK) {
+            r.proof = proofBuffer.data();
+            r.publicSignals = publicBuffer.data();
+        } else {
+            r.error = errorMsg;
+        }
+
+        return r;
+    }
+
+    inline bool verify(const Groth16Data &data, const std::string &proof, const std::string &publicSignals)
+    {
+        char errorMsg[256] = {0};
+
+        return groth16_verify(proof.c_str(), publicSignals.c_str(), data.verificationKey.c_str(),
+                              errorMsg, sizeof(errorMsg) - 1) == VERIFIER_VALID_PROOF;
+    }
+
+    // Proves 'wtns' and checks that the proof verifies
+    inline void expectValidProof(void *prover, const Groth16Data &data, const std::string &wtns, const std::string &what,
+                                 void *control = nullptr)
+    {
+        ProveResult r = prove(prover, data, wtns, control);
+
+        expect(r.status == PROVER_OK, what + ": " + r.error);
+        expect(r.status != PROVER_OK || verify(data, r.proof, r.publicSignals), what + " does not verify");
+    }
+}
+
+#endif // TEST_UTILS_HPP
@@ -0,0 +1,99 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#include "binfile_utils.hpp"
+#include "test_utils.hpp"
+
+// Validates a copy of testdata/random_ultra_groth.zkey, a small UltraGroth
+// zkey of random valid points (its proofs do not verify),
+// through a validated-key cache: a listed zkey is accepted again, and the
+// same file corrupted in place is checked again and refused, keyed by its
+// contents or with PROVER_VALIDATE_FAST_CACHE by its identity.
+
+// Offset in the zkey of the first G2 point of the B2 section
+static size_t pointsB2Offset(const std::string &zkey)
+{
+    BinFileUtils::BinFile f(zkey.data(), zkey.size(), "zkey", 1);
+
+    return (const char *)f.getSectionData(7) - zkey.data();
+}
+
+static void writeFile(const std::string &path, const std::string &data)
+{
+    // Rewritten in place: the inode and size stay the same
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+
+    if (!file) {
+        file.open(path, std::ios::binary | std::ios::out);
+    }
+    file.write(data.data(), data.size());
+}
+
+static int validate(const std::string &zkeyPath, const std::string &cachePath, unsigned int flags)
+{
+    void *prover = nullptr;
+    char errorMsg[256] = {0};
+
+    if (ultra_groth_prover_create_zkey_file(&prover, zkeyPath.c_str(), errorMsg, sizeof(errorMsg) - 1) != PROVER_OK) {
+        throw std::runtime_error(std::string("ultra_groth_prover_create_zkey_file: ") + errorMsg);
+    }
+
+    const int status = ultra_groth_prover_validate_flags(prover, cachePath.c_str(), flags, errorMsg, sizeof(errorMsg) - 1);
+
+    ultra_groth_prover_destroy(prover);
+
+    return status;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        std::cerr << "Usage: test_zkey_validate <testdata>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string zkey = TestUtils::readFile(std::string(argv[1]) + "/random_ultra_groth.zkey");
+    std::string corrupted = zkey;
+    char dir[] = "/tmp/test_zkey_validate.XXXXXX";
+
+    // An x coordinate off by one is off the curve
+    corrupted[pointsB2Offset(zkey)] ^= 1;
+
+    if (mkdtemp(dir) == nullptr) {
+        std::cerr << "Can not create a temporary directory" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string zkeyPath = std::string(dir) + "/circuit.zkey";
+    const std::string cachePath = std::string(dir) + "/validated";
+    const unsigned int flagSets[] = {0, PROVER_VALIDATE_FAST_CACHE};
+
+    for (unsigned int flags : flagSets) {
+        const std::string what = flags == 0 ? "Content key: " : "Identity key: ";
+
+        std::remove(cachePath.c_str());
+        writeFile(zkeyPath, zkey);
+
+        TestUtils::expect(validate(zkeyPath, cachePath, flags) == PROVER_OK, what + "the zkey is refused");
+        TestUtils::expect(validate(zkeyPath, cachePath, flags) == PROVER_OK, what + "the listed zkey is refused");
+
+        // File times advance with the kernel's coarse clock, a few ms
+        usleep(10000);
+        writeFile(zkeyPath, corrupted);
+
+        TestUtils::expect(validate(zkeyPath, cachePath, flags) == PROVER_INVALID_ZKEY,
+                          what + "the zkey corrupted in place is accepted from the cache");
+    }
+
+    TestUtils::expect(validate(zkeyPath, cachePath, PROVER_VALIDATE_STRICT_CACHE | PROVER_VALIDATE_FAST_CACHE) == PROVER_ERROR,
+                      "Both cache keys are accepted at once");
+
+    std::remove(cachePath.c_str());
+    std::remove(zkeyPath.c_str());
+    rmdir(dir);
+
+    return TestUtils::result();
+}
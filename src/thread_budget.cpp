@@ -0,0 +1,254 @@
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <mutex>
+#include <set>
+
+#include "numa.hpp"
+#include "thread_budget.hpp"
+
+#ifdef __linux__
+
+// A CPU of the process affinity mask, and whether a budget holds it
+struct Cpu {
+    int id;
+    unsigned node;
+    unsigned core;
+    bool reserved;
+};
+
+static std::mutex cpuMutex;
+static std::vector<Cpu> processCpus;
+// Serializes the re-pinning of the default pool
+static std::mutex defaultPoolMutex;
+
+// Unreserved CPUs of 'node' (of every node for -1) on cores where no budget
+// holds a CPU: one per core first, then the other SMT siblings of those cores
+static std::vector<size_t> freeCoreCpus(int node)
+{
+    std::set<unsigned> busyCores, pickedCores;
+    std::vector<size_t> first, siblings;
+
+    for (const Cpu &cpu : processCpus) {
+        if (cpu.reserved) {
+            busyCores.insert(cpu.core);
+        }
+    }
+
+    for (size_t i = 0; i < processCpus.size(); i++) {
+        const Cpu &cpu = processCpus[i];
+
+        if (cpu.reserved || busyCores.count(cpu.core) > 0 || (node >= 0 && cpu.node != (unsigned)node)) {
+            continue;
+        }
+        (pickedCores.insert(cpu.core).second ? first : siblings).push_back(i);
+    }
+
+    first.insert(first.end(), siblings.begin(), siblings.end());
+
+    return first;
+}
+
+// CPUs of free cores for worker i on node i * nodes / n, the layout of
+// numaPartition, or none if a node has not enough
+static std::vector<size_t> spreadCpus(unsigned int n)
+{
+    const unsigned nNodes = BinFileUtils::numaNodeCount();
+    std::vector<size_t> picked;
+
+    for (unsigned node = 0; node < nNodes; node++) {
+        const std::vector<size_t> candidates = freeCoreCpus(node);
+        size_t count = 0;
+
+        for (unsigned int i = 0; i < n; i++) {
+            count += (uint64_t)i * nNodes / n == node;
+        }
+
+        if (candidates.size() < count) {
+            return std::vector<size_t>();
+        }
+        picked.insert(picked.end(), candidates.begin(), candidates.begin() + count);
+    }
+
+    return picked;
+}
+
+// Picks 'n' unreserved CPUs, or none if there are not enough. Budgets are
+// kept on cores of their own, so that two of them never share the SMT
+// siblings of a core, and within one NUMA node when one has room: the first
+// node with n free cores, else n free cores over several nodes, else the
+// siblings of free cores, and only then CPUs of cores other budgets use.
+// With 'spreadNodes' the workers go over the nodes in order when every node
+// has free cores enough.
+static std::vector<int> reserveCpus(unsigned int n, bool spreadNodes)
+{
+    std::lock_guard<std::mutex> guard(cpuMutex);
+    std::vector<int> picked;
+
+    if (processCpus.empty()) {
+        cpu_set_t mask;
+
+        if (sched_getaffinity(0, sizeof(mask), &mask) != 0) {
+            return picked;
+        }
+
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &mask)) {
+                processCpus.push_back(Cpu{cpu, BinFileUtils::numaCpuNode(cpu), BinFileUtils::cpuCore(cpu), false});
+            }
+        }
+    }
+
+    std::vector<size_t> candidates;
+
+    if (spreadNodes && BinFileUtils::numaNodeCount() > 1) {
+        candidates = spreadCpus(n);
+    }
+
+    for (unsigned node = 0; node < BinFileUtils::numaNodeCount() && candidates.size() < n; node++) {
+        candidates = freeCoreCpus(node);
+    }
+
+    if (candidates.size() < n) {
+        candidates = freeCoreCpus(-1);
+    }
+
+    if (candidates.size() < n) {
+        candidates.clear();
+
+        for (size_t i = 0; i < processCpus.size(); i++) {
+            if (!processCpus[i].reserved) {
+                candidates.push_back(i);
+            }
+        }
+    }
+
+    if (candidates.size() < n) {
+        return picked;
+    }
+
+    for (size_t k = 0; k < n; k++) {
+        processCpus[candidates[k]].reserved = true;
+        picked.push_back(processCpus[candidates[k]].id);
+    }
+
+    return picked;
+}
+
+static void releaseCpus(const std::vector<int> &cpus)
+{
+    std::lock_guard<std::mutex> guard(cpuMutex);
+
+    for (int id : cpus) {
+        for (Cpu &cpu : processCpus) {
+            if (cpu.id == id) {
+                cpu.reserved = false;
+            }
+        }
+    }
+}
+
+static void pinWorkers(ThreadPool &pool, const std::vector<int> &cpus)
+{
+    const uint64_t nThreads = pool.getThreadCount();
+
+    pool.parallelFor(0, nThreads, [&](int64_t begin, int64_t end, uint64_t idThread) {
+        if (idThread > 0 && idThread < cpus.size()) {
+            cpu_set_t mask;
+
+            CPU_ZERO(&mask);
+            CPU_SET(cpus[idThread], &mask);
+            sched_setaffinity(0, sizeof(mask), &mask);
+        }
+    });
+}
+
+// Pins the workers of the default pool, which runs the proofs of prover
+// objects without a budget and the decoding of witnesses, to the CPUs no
+// budget holds, or to all of the process CPUs when budgets hold every one
+static void pinDefaultPool()
+{
+    std::lock_guard<std::mutex> guard(defaultPoolMutex);
+    cpu_set_t all, unreserved;
+
+    CPU_ZERO(&all);
+    CPU_ZERO(&unreserved);
+    {
+        std::lock_guard<std::mutex> cpuGuard(cpuMutex);
+
+        for (const Cpu &cpu : processCpus) {
+            CPU_SET(cpu.id, &all);
+            if (!cpu.reserved) {
+                CPU_SET(cpu.id, &unreserved);
+            }
+        }
+    }
+
+    const cpu_set_t &mask = CPU_COUNT(&unreserved) > 0 ? unreserved : all;
+    ThreadPool &pool = ThreadPool::defaultPool();
+
+    pool.parallelFor(0, pool.getThreadCount(), [&](int64_t begin, int64_t end, uint64_t idThread) {
+        if (idThread > 0) {
+            sched_setaffinity(0, sizeof(mask), &mask);
+        }
+    });
+}
+
+ThreadBudget::CallerPin::CallerPin(const ThreadBudget *budget)
+    : pinned(false)
+{
+    if (budget == nullptr || !budget->pinned()) {
+        return;
+    }
+
+    if (sched_getaffinity(0, sizeof(saved), &saved) != 0) {
+        return;
+    }
+
+    cpu_set_t mask;
+
+    CPU_ZERO(&mask);
+    CPU_SET(budget->cpus[0], &mask);
+    pinned = sched_setaffinity(0, sizeof(mask), &mask) == 0;
+}
+
+void ThreadBudget::CallerPin::restore()
+{
+    if (pinned) {
+        sched_setaffinity(0, sizeof(saved), &saved);
+        pinned = false;
+    }
+}
+
+#else
+
+static std::vector<int> reserveCpus(unsigned int, bool) { return std::vector<int>(); }
+static void releaseCpus(const std::vector<int> &) {}
+static void pinDefaultPool() {}
+static void pinWorkers(ThreadPool &, const std::vector<int> &) {}
+
+ThreadBudget::CallerPin::CallerPin(const ThreadBudget *) : pinned(false) {}
+void ThreadBudget::CallerPin::restore() {}
+
+#endif
+
+ThreadBudget::ThreadBudget(unsigned int nThreads, bool spreadNodes)
+    : pool(new ThreadPool(nThreads)),
+      cpus(reserveCpus(nThreads, spreadNodes))
+{
+    if (!cpus.empty()) {
+        pinWorkers(*pool, cpus);
+        pinDefaultPool();
+    }
+}
+
+ThreadBudget::~ThreadBudget()
+{
+    // The workers go with the pool, then their CPUs can be handed out again
+    pool.reset();
+    if (!cpus.empty()) {
+        releaseCpus(cpus);
+        pinDefaultPool();
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef THREAD_BUDGET_HPP
+#define THREAD_BUDGET_HPP
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <memory>
+#include <vector>
+
+#include "threadpool.hpp"
+
+// A thread pool of its own for the proofs of one prover handle (or one
+// call), so that concurrent proofs do not all land on the default pool.
+//
+// On Linux the budget also reserves as many CPUs, out of those the process may
+// run on, for as long as it exists, and pins its workers to them: concurrent
+// budgets get disjoint physical cores, within one NUMA node when it has room,
+// and the workers of the default pool move off the reserved CPUs. When not
+// enough CPUs are left unreserved the workers are not pinned. Worker 0 is the
+// thread calling into the pool: the budget does not pin it, a CallerPin held
+// for the length of a proof does.
+class ThreadBudget
+{
+    std::unique_ptr<ThreadPool> pool;
+    // Reserved CPUs, empty if unpinned; worker i runs on cpus[i]
+    std::vector<int> cpus;
+
+public:
+    // Pins the calling thread to the first CPU of 'budget', the one kept for
+    // worker 0, until restore() or destruction give it back its previous
+    // affinity. Does nothing for a null or unpinned budget.
+    class CallerPin
+    {
+        bool pinned;
+#ifdef __linux__
+        cpu_set_t saved;
+#endif
+
+    public:
+        explicit CallerPin(const ThreadBudget *budget);
+        ~CallerPin() { restore(); }
+
+        CallerPin(const CallerPin&) = delete;
+        CallerPin& operator=(const CallerPin&) = delete;
+
+        void restore();
+    };
+
+    // With 'spreadNodes' worker i is pinned to node i * nodes / nThreads, for
+    // the point sections of zkeys split by numaPartition
+    explicit ThreadBudget(unsigned int nThreads, bool spreadNodes = false);
+    ~ThreadBudget();
+
+    ThreadBudget(const ThreadBudget&) = delete;
+    ThreadBudget& operator=(const ThreadBudget&) = delete;
+
+    ThreadPool &threadPool() { return *pool; }
+
+    unsigned int threadCount() const { return pool->getThreadCount(); }
+
+    bool pinned() const { return !cpus.empty(); }
+};
+
+#endif // THREAD_BUDGET_HPP
@@ -15,20 +15,13 @@
 
 #include "random_generator.hpp"
 #include "misc.hpp"
+#include "msm_montgomery.hpp"
 
 using json = nlohmann::json;
 
 
 namespace UltraGroth {
 
-static void copy_digits(RawFr::Element a, uint64_t *dest) {
-    RawFr::Element tmp;
-    Fr_rawFromMontgomery(tmp.v, a.v);
-    
-    for (int i = 0; i < 4; i++){
-        dest[i] = tmp.v[i];
-    }
-}
 template <typename Engine>
 typename Engine::FrElement derive_challenge(Engine& E, typename Engine::G1PointAffine round_commitment)
 {
@@ -65,44 +58,38 @@ static void compute_lookup(AltBn128::Engine::FrElement* signals, LookupInfo &inf
     uint32_t chunks_total = info.chunks_len;
     uint32_t lookup_size = info.frequencies_len;
 
-    uint64_t *inv1_digits = new uint64_t[chunks_total << 2];
-    uint64_t *inv2_digits = new uint64_t[lookup_size << 2];
-    uint64_t *prod_digits = new uint64_t[lookup_size << 2];
+    // Push vector layout: rand | 1/(rand + chunk_i) | 1/(rand + i) | freq_i/(rand + i)
+    // Witness signals are kept in normal form, so every value is written in normal
+    // form directly by the operation producing it instead of a separate conversion pass.
+    RawFr::Element *push_vector = new RawFr::Element[2 * lookup_size + chunks_total + 1];
+    RawFr::Element *inv1 = push_vector + 1;
+    RawFr::Element *inv2 = inv1 + chunks_total;
+    RawFr::Element *prod = inv2 + lookup_size;
 
-    for (int i = 0; i < lookup_size; i++) {
+    RawFr::field.fromMontgomery(push_vector[0], rand);
+
+    for (uint32_t i = 0; i < lookup_size; i++) {
         RawFr::Element sum = RawFr::field.add(i, rand);
         RawFr::Element inv;
         RawFr::field.inv(inv, sum);
-        copy_digits(inv, &inv2_digits[i << 2]);
-        RawFr::Element prod = RawFr::field.mul(frequencies[i], inv);
-        copy_digits(prod, &prod_digits[i << 2]);
+        RawFr::field.fromMontgomery(inv2[i], inv);
+        // Montgomery product with a raw multiplier drops the R factor, i.e. yields normal form
+        RawFr::field.mul1(prod[i], inv, frequencies[i]);
     }
 
-    for (int i = 0; i < chunks_total; i++) {
-        memcpy(&inv1_digits[i << 2], &inv2_digits[chunks[i] << 2], sizeof(uint64_t) * 4);
+    for (uint32_t i = 0; i < chunks_total; i++) {
+        inv1[i] = inv2[chunks[i]];
     }
-    uint64_t rand_digits[4];
-    copy_digits(rand, rand_digits);
-
-    uint64_t offset = 0;
-    uint64_t *push_vector = new uint64_t[(2 * lookup_size + chunks_total + 1) * 4];
-
-    memcpy(&push_vector[offset], rand_digits, 32);
-    offset += 4;
-    memcpy(&push_vector[offset], inv1_digits, chunks_total * 4 * sizeof(uint64_t));
-    offset += chunks_total * 4;
-    memcpy(&push_vector[offset], inv2_digits, lookup_size * 4 * sizeof(uint64_t));
-    offset += lookup_size * 4;
-    memcpy(&push_vector[offset],prod_digits, lookup_size * 4 * sizeof(uint64_t));
-    offset += lookup_size * 4;
 
     for (uint32_t i = 0; i < info.wtns_indxs_len; i++) {
 
         uint32_t wtns_ind = info.wtns_indxs[i];
         uint32_t push_ind = info.push_indxs[i];
 
-        memcpy(&signals[wtns_ind], &push_vector[push_ind << 2], 4 * sizeof(uint64_t));
+        signals[wtns_ind] = push_vector[push_ind];
     }
+
+    delete[] push_vector;
 }
 
 template <typename Engine>
@@ -147,7 +134,7 @@ std::unique_ptr<Prover<Engine>> makeProver(
         *(typename Engine::G1PointAffine *)final_delta1,
         *(typename Engine::G2PointAffine *)final_delta2,
         *(typename Engine::G1PointAffine *)round_delta1,
-        (Coef<Engine> *)((uint64_t)coefs + 4),
+        coefs == nullptr ? nullptr : (Coef<Engine> *)((uint64_t)coefs + 4),
         (typename Engine::G1PointAffine *)pointsA,
         (typename Engine::G1PointAffine *)pointsB1,
         (typename Engine::G2PointAffine *)pointsB2,
@@ -163,10 +150,15 @@ std::tuple<typename Engine::G1PointAffine, typename Engine::FrElement>
 Prover<Engine>::execute_round(
     const typename Engine::FrElement *round_wtns, const uint64_t wtns_count
 ) {
-    uint32_t sW = sizeof(round_wtns[0]);
     typename Engine::G1Point commitment_projective;
-    E.g1.multiMulByScalarMSM(commitment_projective, round_pointsC, (uint8_t *)round_wtns, sW, wtns_count);
-    
+    msm(E.g1, commitment_projective, round_pointsC, round_wtns, wtns_count);
+
+    return blind_round(commitment_projective);
+}
+
+template <typename Engine>
+std::tuple<typename Engine::G1PointAffine, typename Engine::FrElement>
+Prover<Engine>::blind_round(typename Engine::G1Point &commitment_projective) {
     typename Engine::FrElement r;
     typename Engine::G1Point tmp;
     E.fr.copy(r, E.fr.zero());
@@ -185,69 +177,77 @@ Prover<Engine>::execute_round(
 
 
 template <typename Engine>
-std::tuple<typename Engine::G1PointAffine, typename Engine::G2PointAffine, typename Engine::G1PointAffine>
-Prover<Engine>::execute_final_round(
-    typename Engine::FrElement *wtns, 
-    typename Engine::FrElement *final_wtns,
-    typename Engine::FrElement round_random_factor
+void Prover<Engine>::evaluate_matrix(
+    const CoefMatrix<Engine> &matrix,
+    typename Engine::FrElement *wtns,
+    typename Engine::FrElement *out
 ) {
-    ThreadPool &threadPool = ThreadPool::defaultPool();
-
-    uint32_t sW = sizeof(wtns[0]);
-    typename Engine::G1Point pi_a;
-
-    std::cout << "nVars: " << nVars << std::endl;
+    ThreadPool &threadPool = thread_pool();
 
-    auto start_msm1 = std::chrono::high_resolution_clock::now();
-
-    E.g1.multiMulByScalarMSM(pi_a, pointsA, (uint8_t *)wtns, sW, nVars);
-
-    auto end_msm1 = std::chrono::high_resolution_clock::now();
-
-    auto duration_msm1 = std::chrono::duration_cast<std::chrono::milliseconds>(end_msm1 - start_msm1);
-    std::cout << "MSM1 taken: " << duration_msm1.count() << " milliseconds" << std::endl;
-
-    typename Engine::G1Point pib1;
-    
-    auto start_msm2 = std::chrono::high_resolution_clock::now();
+    threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t c = begin; c < end; c++) {
+            typename Engine::FrElement acc;
+            typename Engine::FrElement aux;
 
-    E.g1.multiMulByScalarMSM(pib1, pointsB1, (uint8_t *)wtns, sW, nVars);
+            if ((c & (ProveControl::POLL_INTERVAL - 1)) == 0 && cancelled()) {
+                return;
+            }
 
-    auto end_msm2 = std::chrono::high_resolution_clock::now();
+            E.fr.copy(acc, E.fr.zero());
 
-    auto duration_msm2 = std::chrono::duration_cast<std::chrono::milliseconds>(end_msm2 - start_msm2);
-    std::cout << "MSM2 taken: " << duration_msm2.count() << " milliseconds" << std::endl;
+            for (uint64_t k = matrix.rows[c]; k < matrix.rows[c + 1]; k++) {
+                FrOps::mul(aux, wtns[matrix.signals[k]], matrix.values[k]);
+                FrOps::add(acc, acc, aux);
+            }
 
-    auto start_msm3 = std::chrono::high_resolution_clock::now();
-
-    typename Engine::G2Point pi_b;
-    E.g2.multiMulByScalarMSM(pi_b, pointsB2, (uint8_t *)wtns, sW, nVars);
-
-    auto end_msm3 = std::chrono::high_resolution_clock::now();
+            out[c] = acc;
+        }
+    });
 
-    auto duration_msm3 = std::chrono::duration_cast<std::chrono::milliseconds>(end_msm3 - start_msm3);
-    std::cout << "MSM3 taken: " << duration_msm3.count() << " milliseconds" << std::endl;
+    check_cancelled();
+}
 
-    auto start_msm4 = std::chrono::high_resolution_clock::now();
+template <typename Engine>
+void Prover<Engine>::prefetch_points(const void *points, uint64_t size) {
+    if (streamer == nullptr) {
+        prefetcher.prefetch(points, size);
+    }
+}
 
-    typename Engine::G1Point pi_c;
-    E.g1.multiMulByScalarMSM(pi_c, final_pointsC, (uint8_t *)final_wtns, sW, final_round_indexes_count);
+template <typename Engine>
+void Prover<Engine>::prefetch_coefs() {
+    if (matrixA.rows == nullptr) {
+        prefetcher.prefetch(coefs, nCoefs * sizeof(coefs[0]));
+        return;
+    }
 
-    auto end_msm4 = std::chrono::high_resolution_clock::now();
+    for (const CoefMatrix<Engine> *m : {&matrixA, &matrixB}) {
+        const uint64_t n = m->rows[domainSize];
 
-    auto duration_msm4 = std::chrono::duration_cast<std::chrono::milliseconds>(end_msm4 - start_msm4);
-    std::cout << "MSM4 taken: " << duration_msm4.count() << " milliseconds" << std::endl;
+        prefetcher.prefetch(m->rows, ((uint64_t)domainSize + 1) * sizeof(m->rows[0]));
+        prefetcher.prefetch(m->signals, n * sizeof(m->signals[0]));
+        prefetcher.prefetch(m->values, n * sizeof(m->values[0]));
+    }
+}
 
-    auto start_fft = std::chrono::high_resolution_clock::now();
+template <typename Engine>
+void Prover<Engine>::evaluate_coefs(
+    typename Engine::FrElement *wtns,
+    typename Engine::FrElement *a,
+    typename Engine::FrElement *b
+) {
+    if (matrixA.rows != nullptr) {
+        if (a != nullptr) evaluate_matrix(matrixA, wtns, a);
+        if (b != nullptr) evaluate_matrix(matrixB, wtns, b);
+        return;
+    }
 
-    auto a = new typename Engine::FrElement[domainSize];
-    auto b = new typename Engine::FrElement[domainSize];
-    auto c = new typename Engine::FrElement[domainSize];
+    ThreadPool &threadPool = thread_pool();
 
     threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
         for (uint32_t i=begin; i<end; i++) {
-            E.fr.copy(a[i], E.fr.zero());
-            E.fr.copy(b[i], E.fr.zero());
+            if (a != nullptr) E.fr.copy(a[i], E.fr.zero());
+            if (b != nullptr) E.fr.copy(b[i], E.fr.zero());
         }
     });
 
@@ -260,7 +260,15 @@ Prover<Engine>::execute_final_round(
             typename Engine::FrElement *ab = (coefs[i].m == 0) ? a : b;
             typename Engine::FrElement aux;
 
-            E.fr.mul(
+            if ((i & (ProveControl::POLL_INTERVAL - 1)) == 0 && cancelled()) {
+                return;
+            }
+
+            if (ab == nullptr) {
+                continue;
+            }
+
+            FrOps::mul(
                 aux,
                 wtns[coefs[i].s],
                 coefs[i].coef
@@ -268,16 +276,258 @@ Prover<Engine>::execute_final_round(
 
             std::lock_guard<std::mutex> guard(locks[coefs[i].c % NLOCKS]);
 
-            E.fr.add(
+            FrOps::add(
                 ab[coefs[i].c],
                 ab[coefs[i].c],
                 aux
             );
         }
     });
+
+    check_cancelled();
+}
+
+template <typename Engine>
+void Prover<Engine>::coset_transform(typename Engine::FrElement *x) {
+    check_cancelled();
+    fft->cosetTransform(x, domainSize, thread_pool());
+}
+
+template <typename Engine>
+template <typename Curve>
+void Prover<Engine>::msm(
+    Curve &g,
+    typename Curve::Point &r,
+    typename Curve::PointAffine *bases,
+    const typename Engine::FrElement *scalars,
+    uint64_t n
+) {
+    std::vector<typename Curve::Point> results;
+
+    msm_batch(g, results, bases, {scalars}, n);
+    g.copy(r, results[0]);
+}
+
+template <typename Engine>
+template <typename Curve>
+void Prover<Engine>::msm_wtns(
+    Curve &g,
+    typename Curve::Point &r,
+    typename Curve::PointAffine *bases,
+    const typename Engine::FrElement *scalars,
+    uint64_t n
+) {
+    // ffiasm's MSM can not be stopped part way
+    if (pool == nullptr && control == nullptr) {
+        g.multiMulByScalarMSM(r, bases, (uint8_t *)scalars, sizeof(scalars[0]), n);
+        return;
+    }
+
+    MSMMontgomery<Curve, typename Engine::Fr> msm(g, E.fr, false, control);
+    msm.run(r, bases, scalars, n, thread_pool());
+}
+
+template <typename Engine>
+bool Prover<Engine>::diff_base(
+    const typename Engine::FrElement *scalars,
+    const typename Engine::FrElement *baseScalars,
+    uint64_t n,
+    std::vector<uint32_t> &indexes,
+    std::vector<typename Engine::FrElement> &deltas
+) {
+    ThreadPool &threadPool = thread_pool();
+
+    // Fixed chunks, so that appending them in order keeps the indexes ascending
+    const uint64_t nChunks = threadPool.getThreadCount();
+    const uint64_t chunkSize = (n + nChunks - 1) / nChunks;
+    std::vector<std::vector<uint32_t>> changed(nChunks);
+
+    threadPool.parallelFor(0, nChunks, [&](int64_t begin, int64_t end, uint64_t) {
+        for (int64_t k = begin; k < end; k++) {
+            const uint64_t last = std::min<uint64_t>(n, (k + 1) * chunkSize);
+
+            for (uint64_t i = k * chunkSize; i < last; i++) {
+                if (std::memcmp(&scalars[i], &baseScalars[i], sizeof(scalars[i])) != 0) {
+                    changed[k].push_back(i);
+                }
+            }
+        }
+    });
+
+    size_t count = 0;
+
+    for (const auto &c : changed) {
+        count += c.size();
+    }
+
+    // Past that the delta MSMs gain little over full ones
+    if (count > n / 2) {
+        return false;
+    }
+
+    indexes.reserve(count);
+
+    for (const auto &c : changed) {
+        indexes.insert(indexes.end(), c.begin(), c.end());
+    }
+
+    // Modular subtraction, the same in normal form as in Montgomery form
+    deltas.resize(count);
+
+    for (size_t j = 0; j < count; j++) {
+        FrOps::sub(deltas[j], scalars[indexes[j]], baseScalars[indexes[j]]);
+    }
+
+    return true;
+}
+
+template <typename Engine>
+template <typename Curve>
+void Prover<Engine>::msm_delta(
+    Curve &g,
+    typename Curve::Point &r,
+    typename Curve::Point &from,
+    typename Curve::PointAffine *bases,
+    const std::vector<uint32_t> &indexes,
+    const std::vector<typename Engine::FrElement> &deltas
+) {
+    if (indexes.empty()) {
+        g.copy(r, from);
+        return;
+    }
+
+    // Gathered, as the MSM takes contiguous bases; read through the mapping
+    // even when the sections are streamed, as only a few points are needed
+    std::vector<typename Curve::PointAffine> points(indexes.size());
+
+    for (size_t j = 0; j < indexes.size(); j++) {
+        g.copy(points[j], bases[indexes[j]]);
+    }
+
+    msm_wtns(g, r, points.data(), deltas.data(), indexes.size());
+    g.add(r, r, from);
+}
+
+template <typename Engine>
+template <typename Curve>
+void Prover<Engine>::msm_batch(
+    Curve &g,
+    std::vector<typename Curve::Point> &r,
+    typename Curve::PointAffine *bases,
+    const std::vector<const typename Engine::FrElement *> &scalars,
+    uint64_t n
+) {
+    if (streamer == nullptr) {
+        check_cancelled();
+        msm_wtns_batch(g, r, bases, scalars, n);
+        return;
+    }
+
+    r.resize(scalars.size());
+
+    // The MSM is linear in the bases: sum the MSMs of the chunks
+    for (size_t k = 0; k < scalars.size(); k++) {
+        g.copy(r[k], g.zero());
+    }
+
+    streamer->forEachChunk(bases, sizeof(bases[0]), n, [&] (void *chunk, uint64_t begin, uint64_t count) {
+        std::vector<const typename Engine::FrElement *> chunkScalars;
+        std::vector<typename Curve::Point> partial;
+
+        check_cancelled();
+
+        for (auto s : scalars) {
+            chunkScalars.push_back(s + begin);
+        }
+
+        msm_wtns_batch(g, partial, (typename Curve::PointAffine *)chunk, chunkScalars, count);
+
+        for (size_t k = 0; k < scalars.size(); k++) {
+            g.add(r[k], r[k], partial[k]);
+        }
+    });
+}
+
+template <typename Engine>
+template <typename Curve>
+void Prover<Engine>::msm_wtns_batch(
+    Curve &g,
+    std::vector<typename Curve::Point> &r,
+    typename Curve::PointAffine *bases,
+    const std::vector<const typename Engine::FrElement *> &scalars,
+    uint64_t n
+) {
+    if (scalars.size() == 1) {
+        r.resize(1);
+        msm_wtns(g, r[0], bases, scalars[0], n);
+        return;
+    }
+
+    MSMMontgomery<Curve, typename Engine::Fr> msm(g, E.fr, false, control);
+    msm.runBatch(r, bases, scalars, n, thread_pool());
+}
+
+template <typename Engine>
+void Prover<Engine>::msm_h(typename Engine::G1Point &pih, typename Engine::FrElement *h, uint32_t nSplits) {
+    MSMMontgomery<typename Engine::G1, typename Engine::Fr> msmH(E.g1, E.fr, true, control);
+
+    E.g1.copy(pih, E.g1.zero());
+
+    // The chunks bound the digit table as well, no further splitting
+    if (streamer != nullptr) {
+        streamer->forEachChunk(pointsH, sizeof(pointsH[0]), domainSize, [&] (void *chunk, uint64_t begin, uint64_t count) {
+            typename Engine::G1Point partial;
+
+            check_cancelled();
+
+            msmH.run(partial, (typename Engine::G1PointAffine *)chunk, h + begin, count, thread_pool());
+            E.g1.add(pih, pih, partial);
+        });
+        return;
+    }
+
+    // Splitting bounds the digit table of the MSM to domainSize / nSplits entries
+    for (uint32_t k = 0; k < nSplits; k++) {
+        uint64_t begin = (uint64_t)domainSize * k / nSplits;
+        uint64_t end = (uint64_t)domainSize * (k + 1) / nSplits;
+
+        typename Engine::G1Point partial;
+        check_cancelled();
+        msmH.run(partial, pointsH + begin, h + begin, end - begin, thread_pool());
+        E.g1.add(pih, pih, partial);
+    }
+}
+
+template <typename Engine>
+void Prover<Engine>::compute_h(
+    typename Engine::G1Point &pih,
+    typename Engine::FrElement *wtns,
+    typename Engine::FrElement *scratch
+) {
+    ThreadPool &threadPool = thread_pool();
+
+    auto start_fft = std::chrono::high_resolution_clock::now();
+
+    // Without scratch b and c are freed before the MSM, as it needs memory too
+    std::unique_ptr<typename Engine::FrElement[]> ownedA, ownedB, ownedC;
+
+    if (scratch == nullptr) {
+        ownedA.reset(new typename Engine::FrElement[domainSize]);
+        ownedB.reset(new typename Engine::FrElement[domainSize]);
+        ownedC.reset(new typename Engine::FrElement[domainSize]);
+    }
+
+    auto a = scratch ? scratch : ownedA.get();
+    auto b = scratch ? scratch + domainSize : ownedB.get();
+    auto c = scratch ? scratch + 2 * (uint64_t)domainSize : ownedC.get();
+
+    evaluate_coefs(wtns, a, b);
+
+    prefetch_points(pointsH, (uint64_t)domainSize * sizeof(pointsH[0]));
+
     threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
         for (uint64_t i=begin; i<end; i++) {
-            E.fr.mul(
+            FrOps::mul(
                 c[i],
                 a[i],
                 b[i]
@@ -285,55 +535,208 @@ Prover<Engine>::execute_final_round(
         }
     });
 
-    uint32_t domainPower = fft->log2(domainSize);
-    fft->ifft(a, domainSize);
-    threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
-        for (uint64_t i=begin; i<end; i++) {
-            E.fr.mul(a[i], a[i], fft->root(domainPower+1, i));
-        }
-    });
-    fft->fft(a, domainSize);
-    fft->ifft(b, domainSize);
+    coset_transform(a);
+    coset_transform(b);
+    coset_transform(c);
+
     threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
         for (uint64_t i=begin; i<end; i++) {
-            E.fr.mul(b[i], b[i], fft->root(domainPower+1, i));
+            FrOps::mul(a[i], a[i], b[i]);
+            FrOps::sub(a[i], a[i], c[i]);
         }
     });
-    fft->fft(b, domainSize);
-    fft->ifft(c, domainSize);
+
+    ownedB.reset();
+    ownedC.reset();
+
+    auto end_fft = std::chrono::high_resolution_clock::now();
+
+    auto duration_fft = std::chrono::duration_cast<std::chrono::milliseconds>(end_fft - start_fft);
+    std::cout << "FFT taken: " << duration_fft.count() << " milliseconds" << std::endl;
+
+    auto start_msm5 = std::chrono::high_resolution_clock::now();
+
+    // a is left in Montgomery form, the MSM converts each scalar on the fly
+    msm_h(pih, a, 1);
+    ownedA.reset();
+
+    auto end_msm5 = std::chrono::high_resolution_clock::now();
+
+    auto duration_msm5 = std::chrono::duration_cast<std::chrono::milliseconds>(end_msm5 - start_msm5);
+    std::cout << "MSM5 taken: " << duration_msm5.count() << " milliseconds" << std::endl;
+}
+
+// Same result as compute_h with at most two domain-sized arrays alive.
+// h = A'*B' - C' is committed as MSM(A'*B') - MSM(C'): C' is transformed and
+// committed first in the buffer that held b, then b is re-evaluated from the
+// coefficients. Costs one extra pass over the B coefficients and one extra
+// pointsH MSM, run in splits so its digit table stays small as well.
+template <typename Engine>
+void Prover<Engine>::compute_h_low_memory(
+    typename Engine::G1Point &pih,
+    typename Engine::FrElement *wtns,
+    typename Engine::FrElement *scratch
+) {
+    ThreadPool &threadPool = thread_pool();
+
+    std::unique_ptr<typename Engine::FrElement[]> ownedA, ownedB;
+
+    if (scratch == nullptr) {
+        ownedA.reset(new typename Engine::FrElement[domainSize]);
+        ownedB.reset(new typename Engine::FrElement[domainSize]);
+    }
+
+    auto a = scratch ? scratch : ownedA.get();
+    auto b = scratch ? scratch + domainSize : ownedB.get();
+
+    evaluate_coefs(wtns, a, b);
+
+    prefetch_points(pointsH, (uint64_t)domainSize * sizeof(pointsH[0]));
+
+    // c is computed in place of b
     threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
         for (uint64_t i=begin; i<end; i++) {
-            E.fr.mul(c[i], c[i], fft->root(domainPower+1, i));
+            FrOps::mul(b[i], a[i], b[i]);
         }
     });
-    fft->fft(c, domainSize);
+
+    coset_transform(b);
+
+    typename Engine::G1Point pic;
+    msm_h(pic, b, LOW_MEMORY_MSM_SPLITS);
+
+    coset_transform(a);
+
+    evaluate_coefs(wtns, nullptr, b);
+    coset_transform(b);
+
     threadPool.parallelFor(0, domainSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
         for (uint64_t i=begin; i<end; i++) {
-            E.fr.mul(a[i], a[i], b[i]);
-            E.fr.sub(a[i], a[i], c[i]);
-            E.fr.fromMontgomery(a[i], a[i]);
+            FrOps::mul(a[i], a[i], b[i]);
         }
     });
 
-    delete [] b;
-    delete [] c;
+    ownedB.reset();
 
-    auto end_fft = std::chrono::high_resolution_clock::now();
+    msm_h(pih, a, LOW_MEMORY_MSM_SPLITS);
+    E.g1.sub(pih, pih, pic);
 
-    auto duration_fft = std::chrono::duration_cast<std::chrono::milliseconds>(end_fft - start_fft);
-    std::cout << "FFT taken: " << duration_fft.count() << " milliseconds" << std::endl;
+    ownedA.reset();
+}
 
-    auto start_msm5 = std::chrono::high_resolution_clock::now();
+template <typename Engine>
+std::tuple<typename Engine::G1PointAffine, typename Engine::G2PointAffine, typename Engine::G1PointAffine>
+Prover<Engine>::execute_final_round(
+    typename Engine::FrElement *wtns, 
+    typename Engine::FrElement *final_wtns,
+    typename Engine::FrElement round_random_factor
+) {
+    typename Engine::G1Point pi_a;
+
+    std::cout << "nVars: " << nVars << std::endl;
+
+    // With a base witness that is close enough, MSMs over the changes only:
+    // the signals for A, B1 and B2, the final round signals for C
+    std::vector<uint32_t> indexes, finalIndexes;
+    std::vector<typename Engine::FrElement> deltas, finalDeltas;
+
+    const bool delta = base && diff_base(wtns, base->wtns.data(), nVars, indexes, deltas);
+    const bool finalDelta = base && diff_base(final_wtns, base->final_wtns.data(), final_round_indexes_count,
+                                              finalIndexes, finalDeltas);
+
+    // Two stages ahead: the B1 and B2 pages load while the pointsA MSM runs
+    if (!delta) {
+        prefetch_points(pointsB1, (uint64_t)nVars * sizeof(pointsB1[0]));
+        prefetch_points(pointsB2, (uint64_t)nVars * sizeof(pointsB2[0]));
+    }
+
+    auto start_msm1 = std::chrono::high_resolution_clock::now();
+
+    if (delta) {
+        msm_delta(E.g1, pi_a, base->pi_a, pointsA, indexes, deltas);
+    } else {
+        msm(E.g1, pi_a, pointsA, wtns, nVars);
+    }
+    stage_done("msm_a");
+
+    auto end_msm1 = std::chrono::high_resolution_clock::now();
+
+    auto duration_msm1 = std::chrono::duration_cast<std::chrono::milliseconds>(end_msm1 - start_msm1);
+    std::cout << "MSM1 taken: " << duration_msm1.count() << " milliseconds" << std::endl;
+
+    typename Engine::G1Point pib1;
+    
+    auto start_msm2 = std::chrono::high_resolution_clock::now();
+
+    if (delta) {
+        msm_delta(E.g1, pib1, base->pib1, pointsB1, indexes, deltas);
+    } else {
+        msm(E.g1, pib1, pointsB1, wtns, nVars);
+    }
+    stage_done("msm_b1");
+
+    auto end_msm2 = std::chrono::high_resolution_clock::now();
+
+    auto duration_msm2 = std::chrono::duration_cast<std::chrono::milliseconds>(end_msm2 - start_msm2);
+    std::cout << "MSM2 taken: " << duration_msm2.count() << " milliseconds" << std::endl;
+
+    if (!finalDelta) {
+        prefetch_points(final_pointsC, (uint64_t)final_round_indexes_count * sizeof(final_pointsC[0]));
+    }
+    prefetch_coefs();
+
+    auto start_msm3 = std::chrono::high_resolution_clock::now();
+
+    typename Engine::G2Point pi_b;
+    if (delta) {
+        msm_delta(E.g2, pi_b, base->pi_b, pointsB2, indexes, deltas);
+    } else {
+        msm(E.g2, pi_b, pointsB2, wtns, nVars);
+    }
+    stage_done("msm_b2");
+
+    auto end_msm3 = std::chrono::high_resolution_clock::now();
+
+    auto duration_msm3 = std::chrono::duration_cast<std::chrono::milliseconds>(end_msm3 - start_msm3);
+    std::cout << "MSM3 taken: " << duration_msm3.count() << " milliseconds" << std::endl;
+
+    auto start_msm4 = std::chrono::high_resolution_clock::now();
+
+    typename Engine::G1Point pi_c;
+    if (finalDelta) {
+        msm_delta(E.g1, pi_c, base->pi_c, final_pointsC, finalIndexes, finalDeltas);
+    } else {
+        msm(E.g1, pi_c, final_pointsC, final_wtns, final_round_indexes_count);
+    }
+    stage_done("msm_c");
+
+    auto end_msm4 = std::chrono::high_resolution_clock::now();
+
+    auto duration_msm4 = std::chrono::duration_cast<std::chrono::milliseconds>(end_msm4 - start_msm4);
+    std::cout << "MSM4 taken: " << duration_msm4.count() << " milliseconds" << std::endl;
 
     typename Engine::G1Point pih;
-    E.g1.multiMulByScalarMSM(pih, pointsH, (uint8_t *)a, sizeof(a[0]), domainSize);
-    delete [] a;
 
-    auto end_msm5 = std::chrono::high_resolution_clock::now();
+    if (lowMemory) {
+        compute_h_low_memory(pih, wtns, kept_h_scratch());
+    } else {
+        compute_h(pih, wtns, kept_h_scratch());
+    }
+    stage_done("h");
 
-    auto duration_msm5 = std::chrono::duration_cast<std::chrono::milliseconds>(end_msm5 - start_msm5);
-    std::cout << "MSM5 taken: " << duration_msm5.count() << " milliseconds" << std::endl;
+    return finalize(pi_a, pib1, pi_b, pi_c, pih, round_random_factor);
+}
 
+template <typename Engine>
+std::tuple<typename Engine::G1PointAffine, typename Engine::G2PointAffine, typename Engine::G1PointAffine>
+Prover<Engine>::finalize(
+    typename Engine::G1Point &pi_a,
+    typename Engine::G1Point &pib1,
+    typename Engine::G2Point &pi_b,
+    typename Engine::G1Point &pi_c,
+    typename Engine::G1Point &pih,
+    typename Engine::FrElement round_random_factor
+) {
     // initializing variables for blinding factors
     typename Engine::FrElement r;
     typename Engine::FrElement s;
@@ -398,10 +801,68 @@ Prover<Engine>::execute_final_round(
     return {A, B, C};
 };
 
+template <typename Engine>
+void Prover<Engine>::warmup() {
+    ThreadPool &threadPool = thread_pool();
+    std::vector<std::pair<const void *, uint64_t>> ranges;
+
+    ranges.emplace_back(round_indexes, (uint64_t)round_indexes_count * sizeof(round_indexes[0]));
+    ranges.emplace_back(final_round_indexes, (uint64_t)final_round_indexes_count * sizeof(final_round_indexes[0]));
+
+    if (matrixA.rows == nullptr) {
+        ranges.emplace_back(coefs, nCoefs * sizeof(coefs[0]));
+    } else {
+        for (const CoefMatrix<Engine> *m : {&matrixA, &matrixB}) {
+            const uint64_t n = m->rows[domainSize];
+
+            ranges.emplace_back(m->rows, ((uint64_t)domainSize + 1) * sizeof(m->rows[0]));
+            ranges.emplace_back(m->signals, n * sizeof(m->signals[0]));
+            ranges.emplace_back(m->values, n * sizeof(m->values[0]));
+        }
+    }
+
+    // Streamed sections are read into the streamer buffers on every proof
+    if (streamer == nullptr) {
+        ranges.emplace_back(round_pointsC, (uint64_t)round_indexes_count * sizeof(round_pointsC[0]));
+        ranges.emplace_back(pointsA, (uint64_t)nVars * sizeof(pointsA[0]));
+        ranges.emplace_back(pointsB1, (uint64_t)nVars * sizeof(pointsB1[0]));
+        ranges.emplace_back(pointsB2, (uint64_t)nVars * sizeof(pointsB2[0]));
+        ranges.emplace_back(final_pointsC, (uint64_t)final_round_indexes_count * sizeof(final_pointsC[0]));
+        ranges.emplace_back(pointsH, (uint64_t)domainSize * sizeof(pointsH[0]));
+    }
+
+    for (const auto &range : ranges) {
+        BinFileUtils::touchRange(range.first, range.second, threadPool);
+    }
+
+    fft->prepareCoset(domainSize, threadPool);
+
+    // Low memory proofs hold the H arrays only while computing H
+    if (lowMemory) {
+        return;
+    }
+
+    // Written, not read, so that every page gets its own frame now
+    if (hScratchSize != h_scratch_size()) {
+        hScratch.reset();
+        hScratchSize = h_scratch_size();
+        hScratch.reset(new typename Engine::FrElement[hScratchSize]);
+    }
+
+    typename Engine::FrElement *h = hScratch.get();
+
+    threadPool.parallelFor(0, hScratchSize, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t i = begin; i < end; i++) {
+            E.fr.copy(h[i], E.fr.zero());
+        }
+    });
+}
+
 template <typename Engine>
 std::unique_ptr<Proof<Engine>> Prover<Engine>::prove(
-    typename Engine::FrElement* wtns, LookupInfo &lookupInfo
+    typename Engine::FrElement* wtns, LookupInfo &lookupInfo, ProveControl *control
 ) {
+    start_control(control);
 
     Proof<Engine> *p = new Proof<Engine>(Engine::engine);
     p->error = nullptr;
@@ -411,18 +872,34 @@ std::unique_ptr<Proof<Engine>> Prover<Engine>::prove(
     typename Engine::FrElement round_random_factor;
     typename Engine::G1PointAffine round_commitment;
     
+    prefetch_points(round_pointsC, (uint64_t)round_indexes_count * sizeof(round_pointsC[0]));
+    prefetcher.prefetch(final_round_indexes, (uint64_t)final_round_indexes_count * sizeof(final_round_indexes[0]));
+    prefetch_points(pointsA, (uint64_t)nVars * sizeof(pointsA[0]));
+
     // here cloning of appropriate part of witness for first round should happen
-    typename Engine::FrElement *round_wtns = new typename Engine::FrElement[round_indexes_count];
+    std::vector<typename Engine::FrElement> round_wtns(round_indexes_count);
 
     for (uint32_t i = 0; i < round_indexes_count; i++) {
         round_wtns[i] = wtns[round_indexes[i]];
     }
 
-    std::tuple<typename Engine::G1PointAffine, typename Engine::FrElement> round_result = execute_round(round_wtns, round_indexes_count);
-    
+    // With a base witness that is close enough, an MSM over the changes only
+    typename Engine::G1Point round_msm;
+    std::vector<uint32_t> indexes;
+    std::vector<typename Engine::FrElement> deltas;
+
+    if (base && diff_base(round_wtns.data(), base->round_wtns.data(), round_indexes_count, indexes, deltas)) {
+        msm_delta(E.g1, round_msm, base->round, round_pointsC, indexes, deltas);
+    } else {
+        msm(E.g1, round_msm, round_pointsC, round_wtns.data(), round_indexes_count);
+    }
+
+    std::tuple<typename Engine::G1PointAffine, typename Engine::FrElement> round_result = blind_round(round_msm);
+
     round_commitment = std::get<0>(round_result);
     round_random_factor = std::get<1>(round_result);
-    delete[] round_wtns;
+    std::vector<typename Engine::FrElement>().swap(round_wtns);
+    stage_done("round");
     
     // Hash point to derive challenge
     typename Engine::FrElement rand = derive_challenge<Engine>(E, round_commitment);
@@ -436,7 +913,7 @@ std::unique_ptr<Proof<Engine>> Prover<Engine>::prove(
 
     compute_lookup(wtns, lookupInfo, rand);
 
-    typename Engine::FrElement *final_round_wtns = new typename Engine::FrElement[final_round_indexes_count];
+    std::vector<typename Engine::FrElement> final_round_wtns(final_round_indexes_count);
 
     // Convert witness from uint64 to FrElement
     for (uint32_t i = 0; i < final_round_indexes_count; i++) {
@@ -446,12 +923,11 @@ std::unique_ptr<Proof<Engine>> Prover<Engine>::prove(
 
     auto final_round_result = execute_final_round(
         wtns,
-        final_round_wtns,
+        final_round_wtns.data(),
         round_random_factor
     );
     
     //witness_from_digits((uint64_t *)wtnsData->signals, nVars);
-    delete[] final_round_wtns;
 
     E.g1.copy(p->A, std::get<0>(final_round_result));
     E.g2.copy(p->B, std::get<1>(final_round_result));
@@ -461,6 +937,158 @@ std::unique_ptr<Proof<Engine>> Prover<Engine>::prove(
     return std::unique_ptr<Proof<Engine>>(p);
 }
 
+template <typename Engine>
+void Prover<Engine>::set_base_witness(const typename Engine::FrElement *wtns, const LookupInfo *lookupInfo) {
+
+    if (wtns == nullptr) {
+        base.reset();
+        return;
+    }
+
+    // Not under the control of the last proof, which may be gone
+    start_control(nullptr);
+
+    std::unique_ptr<BaseWitness> b(new BaseWitness);
+
+    b->round_wtns.resize(round_indexes_count);
+
+    for (uint32_t i = 0; i < round_indexes_count; i++) {
+        b->round_wtns[i] = wtns[round_indexes[i]];
+    }
+
+    b->wtns.assign(wtns, wtns + nVars);
+
+    for (uint64_t i = 0; lookupInfo != nullptr && i < lookupInfo->wtns_indxs_len; i++) {
+        E.fr.copy(b->wtns[lookupInfo->wtns_indxs[i]], E.fr.zero());
+    }
+
+    b->final_wtns.resize(final_round_indexes_count);
+
+    for (uint32_t i = 0; i < final_round_indexes_count; i++) {
+        b->final_wtns[i] = b->wtns[final_round_indexes[i]];
+    }
+
+    msm(E.g1, b->round, round_pointsC, b->round_wtns.data(), round_indexes_count);
+    msm(E.g1, b->pi_a, pointsA, b->wtns.data(), nVars);
+    msm(E.g1, b->pib1, pointsB1, b->wtns.data(), nVars);
+    msm(E.g2, b->pi_b, pointsB2, b->wtns.data(), nVars);
+    msm(E.g1, b->pi_c, final_pointsC, b->final_wtns.data(), final_round_indexes_count);
+
+    base = std::move(b);
+}
+
+template <typename Engine>
+std::vector<std::unique_ptr<Proof<Engine>>> Prover<Engine>::prove_batch(
+    const std::vector<typename Engine::FrElement *> &wtns, const std::vector<LookupInfo *> &lookupInfos,
+    ProveControl *control
+) {
+    const size_t n = wtns.size();
+
+    start_control(control);
+
+    prefetch_points(round_pointsC, (uint64_t)round_indexes_count * sizeof(round_pointsC[0]));
+    prefetcher.prefetch(final_round_indexes, (uint64_t)final_round_indexes_count * sizeof(final_round_indexes[0]));
+    prefetch_points(pointsA, (uint64_t)nVars * sizeof(pointsA[0]));
+
+    // Common round of every witness, in one sweep of the round points
+    std::vector<typename Engine::FrElement> round_wtns((uint64_t)n * round_indexes_count);
+    std::vector<const typename Engine::FrElement *> round_scalars(n);
+
+    for (size_t k = 0; k < n; k++) {
+        typename Engine::FrElement *w = round_wtns.data() + k * round_indexes_count;
+
+        for (uint32_t i = 0; i < round_indexes_count; i++) {
+            w[i] = wtns[k][round_indexes[i]];
+        }
+        round_scalars[k] = w;
+    }
+
+    std::vector<typename Engine::G1Point> round_msm;
+    msm_batch(E.g1, round_msm, round_pointsC, round_scalars, round_indexes_count);
+    std::vector<typename Engine::FrElement>().swap(round_wtns);
+    stage_done("round");
+
+    std::vector<typename Engine::G1PointAffine> round_commitment(n);
+    std::vector<typename Engine::FrElement> round_random_factor(n);
+    std::vector<typename Engine::FrElement> final_wtns((uint64_t)n * final_round_indexes_count);
+    std::vector<const typename Engine::FrElement *> final_scalars(n);
+    std::vector<const typename Engine::FrElement *> scalars(wtns.begin(), wtns.end());
+
+    for (size_t k = 0; k < n; k++) {
+        std::tie(round_commitment[k], round_random_factor[k]) = blind_round(round_msm[k]);
+
+        typename Engine::FrElement rand = derive_challenge<Engine>(E, round_commitment[k]);
+        compute_lookup(wtns[k], *lookupInfos[k], rand);
+
+        typename Engine::FrElement *w = final_wtns.data() + k * final_round_indexes_count;
+
+        for (uint32_t i = 0; i < final_round_indexes_count; i++) {
+            w[i] = wtns[k][final_round_indexes[i]];
+        }
+        final_scalars[k] = w;
+    }
+
+    // Final round, one point section at a time for all witnesses
+    std::vector<typename Engine::G1Point> pi_a, pib1, pi_c, pih(n);
+    std::vector<typename Engine::G2Point> pi_b;
+
+    prefetch_points(pointsB1, (uint64_t)nVars * sizeof(pointsB1[0]));
+    prefetch_points(pointsB2, (uint64_t)nVars * sizeof(pointsB2[0]));
+
+    msm_batch(E.g1, pi_a, pointsA, scalars, nVars);
+    stage_done("msm_a");
+    msm_batch(E.g1, pib1, pointsB1, scalars, nVars);
+    stage_done("msm_b1");
+
+    prefetch_points(final_pointsC, (uint64_t)final_round_indexes_count * sizeof(final_pointsC[0]));
+    prefetch_coefs();
+
+    msm_batch(E.g2, pi_b, pointsB2, scalars, nVars);
+    stage_done("msm_b2");
+    msm_batch(E.g1, pi_c, final_pointsC, final_scalars, final_round_indexes_count);
+    stage_done("msm_c");
+    std::vector<typename Engine::FrElement>().swap(final_wtns);
+
+    // The H arrays of one proof at a time, in the same scratch
+    std::unique_ptr<typename Engine::FrElement[]> scratch;
+    typename Engine::FrElement *h = kept_h_scratch();
+
+    if (h == nullptr) {
+        scratch.reset(new typename Engine::FrElement[h_scratch_size()]);
+        h = scratch.get();
+    }
+
+    for (size_t k = 0; k < n; k++) {
+        if (lowMemory) {
+            compute_h_low_memory(pih[k], wtns[k], h);
+        } else {
+            compute_h(pih[k], wtns[k], h);
+        }
+    }
+
+    scratch.reset();
+    stage_done("h");
+
+    std::vector<std::unique_ptr<Proof<Engine>>> proofs;
+
+    for (size_t k = 0; k < n; k++) {
+        auto result = finalize(pi_a[k], pib1[k], pi_b[k], pi_c[k], pih[k], round_random_factor[k]);
+
+        Proof<Engine> *p = new Proof<Engine>(Engine::engine);
+        p->error = nullptr;
+        p->error_size = 0;
+
+        E.g1.copy(p->A, std::get<0>(result));
+        E.g2.copy(p->B, std::get<1>(result));
+        E.g1.copy(p->final_commitment, std::get<2>(result));
+        E.g1.copy(p->round_commitment, round_commitment[k]);
+
+        proofs.push_back(std::unique_ptr<Proof<Engine>>(p));
+    }
+
+    return proofs;
+}
+
 
 template <typename Engine>
 std::string Proof<Engine>::toJsonStr()
@@ -473,6 +1101,21 @@ std::string Proof<Engine>::toJsonStr()
     return ss.str();
 }
 
+template <typename Engine>
+void Proof<Engine>::toEvm(uint8_t *out)
+{
+    montgomeryToBytesBE(E.f1, A.x, out + 0);
+    montgomeryToBytesBE(E.f1, A.y, out + 32);
+    montgomeryToBytesBE(E.f1, B.x.b, out + 64);
+    montgomeryToBytesBE(E.f1, B.x.a, out + 96);
+    montgomeryToBytesBE(E.f1, B.y.b, out + 128);
+    montgomeryToBytesBE(E.f1, B.y.a, out + 160);
+    montgomeryToBytesBE(E.f1, final_commitment.x, out + 192);
+    montgomeryToBytesBE(E.f1, final_commitment.y, out + 224);
+    montgomeryToBytesBE(E.f1, round_commitment.x, out + 256);
+    montgomeryToBytesBE(E.f1, round_commitment.y, out + 288);
+}
+
 template <typename Engine>
 json Proof<Engine>::toJson()
 {
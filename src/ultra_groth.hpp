@@ -5,11 +5,17 @@
 #include <array>
 #include <vector>
 #include <tuple>
+#include <memory>
 #include <cstdint>
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
 
-#include "fft.hpp"
+#include "fft_lazy.hpp"
+#include "fr_inline.hpp"
+#include "prefetcher.hpp"
+#include "section_streamer.hpp"
+#include "prove_control.hpp"
+#include "field_bytes.hpp"
 
 //Error codes returned by the functions.
 #define PROVER_OK                     0x0
@@ -74,6 +80,11 @@ namespace UltraGroth {
         Proof(Engine &_E) : E(_E) { }
         std::string toJsonStr();
         json toJson();
+
+        // pi_a, pi_b, pi_f, pi_r as 32-byte big-endian coordinates, G2 with the
+        // imaginary part first: the calldata layout of EVM verifiers
+        static const size_t EVM_SIZE = 320;
+        void toEvm(uint8_t *out);
         void fromJson(const json &proof);
     };
 
@@ -105,12 +116,24 @@ namespace UltraGroth {
     };
 #pragma pack(pop)
 
+    // Constraint matrix in CSR form (prepared zkeys): the coefficients of
+    // constraint c are [rows[c], rows[c + 1]) of signals and values
+    template <typename Engine>
+    struct CoefMatrix {
+        const uint64_t *rows;
+        const uint32_t *signals;
+        const typename Engine::FrElement *values;
+    };
+
     template <typename Engine>
     typename Engine::FrElement derive_challenge(Engine& E, typename Engine::G1PointAffine round_commitment);
 
     template <typename Engine>
     class Prover {
 
+        // Inlined field ops for the per-element loops, E.fr elsewhere
+        typedef typename InlineField<typename Engine::Fr>::type FrOps;
+
         Engine &E;
         uint32_t nVars;
         uint32_t nPublic;
@@ -133,6 +156,9 @@ namespace UltraGroth {
         typename Engine::G1PointAffine &round_delta1;
         // Probably matrix coefficients
         Coef<Engine> *coefs;
+        // Same coefficients split by matrix and sorted by constraint, if the zkey was prepared
+        CoefMatrix<Engine> matrixA;
+        CoefMatrix<Engine> matrixB;
         // [interpolated polynomials from L matrix evaluated in tau]_g1
         typename Engine::G1PointAffine *pointsA;
         // [interpolated polynomials from R matrix evaluated in tau]_g1
@@ -146,7 +172,132 @@ namespace UltraGroth {
         // Probably points of target polynomail - [(tau * Z(tau)) / delta]_g1
         typename Engine::G1PointAffine *pointsH;
 
-        FFT<typename Engine::Fr> *fft;
+        LazyFFT<typename Engine::Fr> *fft;
+
+        // Keep at most two domain-sized arrays alive while computing H
+        bool lowMemory;
+
+        // Faults in the zkey data of the next stages while the current one computes
+        BinFileUtils::Prefetcher prefetcher;
+
+        // If set, point sections are read through it instead of the mapping
+        BinFileUtils::SectionStreamer *streamer;
+
+        // Pool the proofs run on, null for the default pool
+        ThreadPool *pool;
+
+        ThreadPool &thread_pool() const { return pool != nullptr ? *pool : ThreadPool::defaultPool(); }
+
+        // MSM of normal form scalars: ffiasm's, which always runs on the
+        // default pool and can not be cancelled, or MSMMontgomery on a
+        // dedicated pool or under a control
+        template <typename Curve>
+        void msm_wtns(Curve &g, typename Curve::Point &r, typename Curve::PointAffine *bases,
+                      const typename Engine::FrElement *scalars, uint64_t n);
+
+        // One msm_wtns per scalar vector, computed in a single pass over the bases
+        template <typename Curve>
+        void msm_wtns_batch(Curve &g, std::vector<typename Curve::Point> &r, typename Curve::PointAffine *bases,
+                            const std::vector<const typename Engine::FrElement *> &scalars, uint64_t n);
+
+        // Control of the proof in progress, may be null
+        ProveControl *control;
+        unsigned int stagesDone;
+
+        // Round, A, B1, B2, C and H
+        static const unsigned int PROVE_STAGES = 6;
+
+        void start_control(ProveControl *_control) { control = _control; stagesDone = 0; }
+
+        // For the parallel loops, which stop early and leave the throwing to
+        // check_cancelled on the calling thread
+        bool cancelled() const { return control != nullptr && control->isCancelled(); }
+        void check_cancelled() const { if (control != nullptr) control->check(); }
+        void stage_done(const char *stage) { if (control != nullptr) control->stageDone(stage, ++stagesDone, PROVE_STAGES); }
+
+        // Point sections are left alone when they are streamed
+        void prefetch_points(const void *points, uint64_t size);
+
+        // Number of pieces the pointsH MSM is split into in low memory mode
+        static const uint32_t LOW_MEMORY_MSM_SPLITS = 8;
+
+        void prefetch_coefs();
+
+        // One output element per constraint, no locking
+        void evaluate_matrix(const CoefMatrix<Engine> &matrix, typename Engine::FrElement *wtns, typename Engine::FrElement *out);
+
+        // Evaluates the A (m = 0) and B (m = 1) matrices at the witness; a null output skips that matrix
+        void evaluate_coefs(typename Engine::FrElement *wtns, typename Engine::FrElement *a, typename Engine::FrElement *b);
+
+        // Moves evaluations over the domain to evaluations over its odd coset, in place
+        void coset_transform(typename Engine::FrElement *x);
+
+        // MSM of normal form scalars, streamed in chunks if out-of-core
+        template <typename Curve>
+        void msm(Curve &g, typename Curve::Point &r, typename Curve::PointAffine *bases,
+                 const typename Engine::FrElement *scalars, uint64_t n);
+
+        // One MSM per scalar vector over the same bases, every point (or
+        // out-of-core chunk) read once for all of them
+        template <typename Curve>
+        void msm_batch(Curve &g, std::vector<typename Curve::Point> &r, typename Curve::PointAffine *bases,
+                       const std::vector<const typename Engine::FrElement *> &scalars, uint64_t n);
+
+        // Commits to h (Montgomery form) with pointsH
+        void msm_h(typename Engine::G1Point &pih, typename Engine::FrElement *h, uint32_t nSplits);
+
+        // scratch holds h_scratch_size() elements, or is null to allocate them
+        void compute_h(typename Engine::G1Point &pih, typename Engine::FrElement *wtns, typename Engine::FrElement *scratch);
+        void compute_h_low_memory(typename Engine::G1Point &pih, typename Engine::FrElement *wtns, typename Engine::FrElement *scratch);
+
+        uint64_t h_scratch_size() const { return (lowMemory ? 2 : 3) * (uint64_t)domainSize; }
+
+        // H arrays kept by warmup for the next proofs, if of h_scratch_size();
+        // never kept in low memory mode
+        std::unique_ptr<typename Engine::FrElement[]> hScratch;
+        uint64_t hScratchSize;
+
+        typename Engine::FrElement *kept_h_scratch() const {
+            return hScratchSize == h_scratch_size() ? hScratch.get() : nullptr;
+        }
+
+        // Adds the blinding factor to the round commitment
+        std::tuple<typename Engine::G1PointAffine, typename Engine::FrElement>
+        blind_round(typename Engine::G1Point &commitment);
+
+        // Copy of a base witness and its unblinded round, A, B1, B2 and C
+        // MSMs. The lookup signals, which every proof derives from its own
+        // challenge, are zeroed in 'wtns' and 'final_wtns', so that they are
+        // added in full to the base MSMs by the proofs.
+        struct BaseWitness {
+            // Read before the lookup signals are written, as the proofs do
+            std::vector<typename Engine::FrElement> round_wtns;
+            std::vector<typename Engine::FrElement> wtns;
+            std::vector<typename Engine::FrElement> final_wtns;
+            typename Engine::G1Point round;
+            typename Engine::G1Point pi_a;
+            typename Engine::G1Point pib1;
+            typename Engine::G2Point pi_b;
+            typename Engine::G1Point pi_c;
+        };
+        std::unique_ptr<BaseWitness> base;
+
+        // Positions where the 'n' scalars differ from 'baseScalars', ascending,
+        // and for each the new value minus the base one. Returns false, leaving
+        // them unset, when more than half of the scalars differ.
+        bool diff_base(const typename Engine::FrElement *scalars, const typename Engine::FrElement *baseScalars,
+                       uint64_t n, std::vector<uint32_t> &indexes, std::vector<typename Engine::FrElement> &deltas);
+
+        // r = from + MSM of the deltas with the bases at their positions
+        template <typename Curve>
+        void msm_delta(Curve &g, typename Curve::Point &r, typename Curve::Point &from, typename Curve::PointAffine *bases,
+                       const std::vector<uint32_t> &indexes, const std::vector<typename Engine::FrElement> &deltas);
+
+        // Adds the blinding factors to the final round MSM results
+        std::tuple<typename Engine::G1PointAffine, typename Engine::G2PointAffine, typename Engine::G1PointAffine>
+        finalize(typename Engine::G1Point &pi_a, typename Engine::G1Point &pib1, typename Engine::G2Point &pi_b,
+                 typename Engine::G1Point &pi_c, typename Engine::G1Point &pih, typename Engine::FrElement round_random_factor);
+
     public:
         Prover(
             Engine &_E,
@@ -195,17 +346,74 @@ namespace UltraGroth {
             pointsB2(_pointsB2),
             final_pointsC(_final_pointsC),
             round_pointsC(_round_pointsC),
-            pointsH(_pointsH)
+            pointsH(_pointsH),
+            lowMemory(false),
+            streamer(nullptr),
+            pool(nullptr),
+            control(nullptr),
+            stagesDone(0),
+            hScratchSize(0)
         {
-            fft = new FFT<typename Engine::Fr>(domainSize*2);
+            matrixA.rows = nullptr;
+            matrixB.rows = nullptr;
+
+            fft = new LazyFFT<typename Engine::Fr>(domainSize*2);
         }
 
         ~Prover() {
             delete fft;
         }
 
+        // Trades one extra coefficient pass and pointsH MSM for a third less peak
+        // memory; frees the H arrays kept by warmup
+        void set_low_memory(bool enable) {
+            lowMemory = enable;
+            if (lowMemory) {
+                hScratch.reset();
+                hScratchSize = 0;
+            }
+        }
+
+        // Out-of-core MSMs: points are read through the streamer, nullptr maps them again
+        void set_streamer(BinFileUtils::SectionStreamer *_streamer) { streamer = _streamer; }
+
+        // Runs the proofs on '_pool' instead of the default pool, nullptr
+        // goes back to it. The pool must outlive the proofs.
+        void set_thread_pool(ThreadPool *_pool) { pool = _pool; }
+
+        // Evaluates from CSR matrices instead of the coefs list
+        void set_prepared_coefs(const CoefMatrix<Engine> &a, const CoefMatrix<Engine> &b) {
+            matrixA = a;
+            matrixB = b;
+        }
+
+        // Does up front what the first proof would otherwise do on the way:
+        // faults in every zkey range the proofs read (point sections only when
+        // not streamed), builds the coset table of the FFT, and allocates and
+        // faults in the H arrays, which are then kept for the proofs unless in
+        // low memory mode
+        void warmup();
+
+        // Keeps a copy of 'wtns' and its unblinded round, A, B1, B2 and C MSMs.
+        // While set, prove computes each of them as the base MSM plus one over
+        // the scalars that differ from the base, unless more than half do. The
+        // round MSM depends on the witness only, the others also on the lookup
+        // signals (at the indexes of 'lookupInfo' for the base), which count
+        // as changed in every proof; H is always computed in full. nullptr
+        // drops the base.
+        void set_base_witness(const typename Engine::FrElement *wtns, const LookupInfo *lookupInfo);
+
         // Function to execute entire proving process
-        std::unique_ptr<Proof<Engine>> prove(typename Engine::FrElement* wtns, LookupInfo &lookupInfo);
+        // A cancelled 'control' makes it throw ProveCancelled
+        std::unique_ptr<Proof<Engine>> prove(typename Engine::FrElement* wtns, LookupInfo &lookupInfo,
+                                             ProveControl *control = nullptr);
+
+        // Same proofs as prove on each witness, computed stage by stage for the
+        // whole batch: every point section is swept (or streamed) once for all
+        // witnesses, and the H scratch arrays are allocated once
+        std::vector<std::unique_ptr<Proof<Engine>>> prove_batch(
+            const std::vector<typename Engine::FrElement *> &wtns, const std::vector<LookupInfo *> &lookupInfos,
+            ProveControl *control = nullptr);
 
         // Function to execute common round of proving process
         // Pointer to accumulator is passed to function; accumulator size is 32
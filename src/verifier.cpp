@@ -1,4 +1,5 @@
 #include <string>
+#include <cstring>
 #include <stdexcept>
 #include <alt_bn128.hpp>
 #include <nlohmann/json.hpp>
@@ -7,6 +8,7 @@
 #include "verifier.h"
 #include "groth16.hpp"
 #include "ultra_groth.hpp"
+#include "field_decimal.hpp"
 
 
 
@@ -64,21 +66,17 @@ parse_inputs(const char *inputs_str)
     std::vector<AltBn128::FrElement> inputs;
 
     try {
-        json inputs_json = json::parse(inputs_str);
+        FieldDecimal::ArrayReader reader(inputs_str, std::strlen(inputs_str));
+        AltBn128::FrElement aux;
 
-        auto inputs_str_vec = inputs_json.template get<std::vector<std::string>>();
-
-        if (inputs_str_vec.empty()) {
-            throw std::invalid_argument("invalid inputs data");
+        while (reader.next(aux.v)) {
+            FieldDecimal::reduce(aux.v, FrInline::q);
+            AltBn128::Fr.toMontgomery(aux, aux);
+            inputs.push_back(aux);
         }
 
-        inputs.reserve(inputs_str_vec.size());
-
-        for (const auto& elem: inputs_str_vec) {
-            AltBn128::FrElement aux;
-
-            AltBn128::Fr.fromString(aux, elem);
-            inputs.push_back(aux);
+        if (inputs.empty()) {
+            throw std::invalid_argument("invalid inputs data");
         }
 
     } catch(...) {
@@ -1,4 +1,12 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
 #include "wtns_utils.hpp"
+#include "threadpool.hpp"
 
 namespace WtnsUtils {
 
@@ -25,4 +33,265 @@ std::unique_ptr<Header> loadHeader(BinFileUtils::BinFile *f) {
     return h;
 }
 
+static const uint8_t CODE_FULL = 2;
+
+// Largest k encoded as 4k or 4k + 1
+static const uint64_t MAX_SMALL = (1ULL << 62) - 1;
+
+static std::vector<uint64_t> primeLimbs(const Header &h) {
+    std::vector<uint64_t> limbs(h.n8 / 8, 0);
+    mpz_export(limbs.data(), nullptr, -1, 8, 0, 0, h.prime);
+    return limbs;
+}
+
+static void checkElementSize(const Header &h) {
+    if (h.n8 == 0 || h.n8 % 8 != 0) {
+        throw std::invalid_argument("Unsupported witness element size " + std::to_string(h.n8));
+    }
+}
+
+static void putVarint(std::vector<uint8_t> &out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back((uint8_t)v | 0x80);
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+// False on a truncated or overlong varint
+static bool getVarint(const uint8_t *&p, const uint8_t *end, uint64_t &v) {
+    v = 0;
+
+    for (unsigned shift = 0; shift < 64 && p < end; shift += 7) {
+        const uint8_t byte = *p++;
+
+        v |= (uint64_t)(byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Code of 'value' (nLimbs limbs), or CODE_FULL
+static uint64_t smallCode(const uint64_t *value, const uint64_t *prime, uint64_t nLimbs) {
+    bool high = false;
+
+    for (uint64_t i = 1; i < nLimbs; i++) {
+        high |= value[i] != 0;
+    }
+
+    if (!high && value[0] <= MAX_SMALL) {
+        return value[0] << 2;
+    }
+
+    // prime - value, if value < prime
+    uint64_t diff0 = 0, borrow = 0;
+    bool diffHigh = false;
+
+    for (uint64_t i = 0; i < nLimbs; i++) {
+        const uint64_t d = prime[i] - value[i] - borrow;
+
+        borrow = (prime[i] < value[i] || (prime[i] == value[i] && borrow)) ? 1 : 0;
+
+        if (i == 0) {
+            diff0 = d;
+        } else {
+            diffHigh |= d != 0;
+        }
+    }
+
+    if (!borrow && !diffHigh && diff0 != 0 && diff0 <= MAX_SMALL) {
+        return (diff0 << 2) | 1;
+    }
+
+    return CODE_FULL;
+}
+
+bool isCompact(BinFileUtils::BinFile *f) {
+    return !f->hasSection(2) && f->hasSection(SECTION_COMPACT_SIGNALS);
+}
+
+void loadSignals(BinFileUtils::BinFile *f, const Header &h, void *signals) {
+    const uint64_t n8 = h.n8;
+
+    if (!isCompact(f)) {
+        if (f->getSectionSize(2) != (uint64_t)h.nVars * n8) {
+            throw std::invalid_argument("Invalid witness section size");
+        }
+        memcpy(signals, f->getSectionData(2), (uint64_t)h.nVars * n8);
+        return;
+    }
+
+    checkElementSize(h);
+
+    const uint64_t nLimbs = n8 / 8;
+    const std::vector<uint64_t> prime = primeLimbs(h);
+    const uint64_t nBlocks = ((uint64_t)h.nVars + COMPACT_BLOCK_SIZE - 1) / COMPACT_BLOCK_SIZE;
+    const uint64_t codesSize = f->getSectionSize(SECTION_COMPACT_SIGNALS);
+    const uint64_t *index = (const uint64_t *)f->getSectionData(SECTION_COMPACT_INDEX);
+    const uint8_t *codes = (const uint8_t *)f->getSectionData(SECTION_COMPACT_SIGNALS);
+
+    if (f->getSectionSize(SECTION_COMPACT_INDEX) != (nBlocks + 1) * 8 ||
+        index[0] != 0 || index[nBlocks] != codesSize) {
+
+        throw std::invalid_argument("Invalid compact witness index");
+    }
+
+    std::atomic<bool> invalid(false);
+
+    ThreadPool::defaultPool().parallelFor(0, nBlocks, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t b = begin; b < end; b++) {
+            if (index[b] > index[b + 1] || index[b + 1] > codesSize) {
+                invalid = true;
+                return;
+            }
+
+            const uint8_t *p = codes + index[b];
+            const uint8_t *blockEnd = codes + index[b + 1];
+            const uint64_t first = b * COMPACT_BLOCK_SIZE;
+            const uint64_t last = std::min<uint64_t>(first + COMPACT_BLOCK_SIZE, h.nVars);
+
+            for (uint64_t i = first; i < last; i++) {
+                uint64_t *out = (uint64_t *)signals + i * nLimbs;
+                uint64_t code;
+
+                if (!getVarint(p, blockEnd, code)) {
+                    invalid = true;
+                    return;
+                }
+
+                if (code == CODE_FULL) {
+                    if ((uint64_t)(blockEnd - p) < n8) {
+                        invalid = true;
+                        return;
+                    }
+                    memcpy(out, p, n8);
+                    p += n8;
+
+                } else if ((code & 3) == 0) {
+                    memset(out, 0, n8);
+                    out[0] = code >> 2;
+
+                } else if ((code & 3) == 1 && (code >> 2) != 0) {
+                    // prime - k
+                    uint64_t k = code >> 2;
+                    uint64_t borrow = 0;
+
+                    for (uint64_t l = 0; l < nLimbs; l++) {
+                        const uint64_t sub = (l == 0 ? k : 0);
+
+                        out[l] = prime[l] - sub - borrow;
+                        borrow = (prime[l] < sub || (prime[l] == sub && borrow)) ? 1 : 0;
+                    }
+
+                } else {
+                    invalid = true;
+                    return;
+                }
+            }
+
+            if (p != blockEnd) {
+                invalid = true;
+                return;
+            }
+        }
+    });
+
+    if (invalid) {
+        throw std::invalid_argument("Corrupted compact witness");
+    }
+}
+
+void writeCompactWitness(const void *data, uint64_t size, const std::string &outFileName) {
+    BinFileUtils::BinFile f(data, size, "wtns", 2);
+    auto h = loadHeader(&f);
+
+    checkElementSize(*h);
+
+    const uint64_t n8 = h->n8;
+    const uint64_t nLimbs = n8 / 8;
+    const std::vector<uint64_t> prime = primeLimbs(*h);
+
+    if (f.getSectionSize(2) != (uint64_t)h->nVars * n8) {
+        throw std::invalid_argument("Invalid witness section size");
+    }
+
+    const uint64_t *values = (const uint64_t *)f.getSectionData(2);
+    const uint64_t nBlocks = ((uint64_t)h->nVars + COMPACT_BLOCK_SIZE - 1) / COMPACT_BLOCK_SIZE;
+    std::vector<std::vector<uint8_t>> blocks(nBlocks);
+
+    ThreadPool::defaultPool().parallelFor(0, nBlocks, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t b = begin; b < end; b++) {
+            const uint64_t first = b * COMPACT_BLOCK_SIZE;
+            const uint64_t last = std::min<uint64_t>(first + COMPACT_BLOCK_SIZE, h->nVars);
+            std::vector<uint8_t> &out = blocks[b];
+
+            for (uint64_t i = first; i < last; i++) {
+                const uint64_t *value = values + i * nLimbs;
+                const uint64_t code = smallCode(value, prime.data(), nLimbs);
+
+                putVarint(out, code);
+
+                if (code == CODE_FULL) {
+                    out.insert(out.end(), (const uint8_t *)value, (const uint8_t *)value + n8);
+                }
+            }
+        }
+    });
+
+    std::vector<uint64_t> index(nBlocks + 1, 0);
+
+    for (uint64_t b = 0; b < nBlocks; b++) {
+        index[b + 1] = index[b] + blocks[b].size();
+    }
+
+    std::ofstream out(outFileName, std::ios::binary | std::ios::trunc);
+
+    if (!out) {
+        throw std::runtime_error("Cannot open " + outFileName + " for writing");
+    }
+
+    auto write = [&out] (const void *p, uint64_t len) {
+        out.write((const char *)p, len);
+    };
+    auto writeSection = [&write] (uint32_t type, const void *p, uint64_t len) {
+        write(&type, 4);
+        write(&len, 8);
+        write(p, len);
+    };
+
+    // Header, index, signals and whichever lookup sections the input has
+    uint32_t nSections = 3;
+
+    for (uint32_t id = 3; id <= 6; id++) {
+        nSections += f.hasSection(id) ? 1 : 0;
+    }
+
+    write("wtns", 4);
+    write(&COMPACT_VERSION, 4);
+    write(&nSections, 4);
+
+    writeSection(1, f.getSectionData(1), f.getSectionSize(1));
+    writeSection(SECTION_COMPACT_INDEX, index.data(), index.size() * 8);
+
+    uint32_t type = SECTION_COMPACT_SIGNALS;
+    write(&type, 4);
+    write(&index[nBlocks], 8);
+    for (const auto &block : blocks) {
+        write(block.data(), block.size());
+    }
+
+    for (uint32_t id = 3; id <= 6; id++) {
+        if (f.hasSection(id)) {
+            writeSection(id, f.getSectionData(id), f.getSectionSize(id));
+        }
+    }
+
+    if (!out) {
+        throw std::runtime_error("Write to " + outFileName + " failed");
+    }
+}
+
 } // NAMESPACE
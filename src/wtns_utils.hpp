@@ -3,6 +3,8 @@
 
 #include <gmp.h>
 #include <cstdint>
+#include <memory>
+#include <string>
 
 #include "binfile_utils.hpp"
 
@@ -21,6 +23,33 @@ namespace WtnsUtils {
 
     std::unique_ptr<Header> loadHeader(BinFileUtils::BinFile *f);
 
+    // Compact witness: a version 3 "wtns" file with the same header (1) and
+    // lookup sections (3-6), whose signals section (2) is replaced by
+    //
+    // CompactIndex(7)    u64[nBlocks + 1], offset in section 8 of each block
+    //                    of COMPACT_BLOCK_SIZE signals, then the section size
+    // CompactSignals(8)  one LEB128 varint code per signal:
+    //                      4k      the value k
+    //                      4k + 1  the value prime - k
+    //                      2       a full n8-byte element follows
+    //
+    // so 0/1 signals and small (negative) integers take one or two bytes and
+    // blocks decode independently. Signals stay in normal form.
+
+    const uint32_t COMPACT_VERSION = 3;
+    const uint32_t SECTION_COMPACT_INDEX = 7;
+    const uint32_t SECTION_COMPACT_SIGNALS = 8;
+    const uint64_t COMPACT_BLOCK_SIZE = 4096;
+
+    bool isCompact(BinFileUtils::BinFile *f);
+
+    // Writes the nVars signals of a plain or compact witness to 'signals',
+    // decoding compact ones in parallel
+    void loadSignals(BinFileUtils::BinFile *f, const Header &h, void *signals);
+
+    // Converts the witness in 'data' into a compact witness at 'outFileName'
+    void writeCompactWitness(const void *data, uint64_t size, const std::string &outFileName);
+
 }
 
 #endif // ZKEY_UTILS_H
\ No newline at end of file
@@ -0,0 +1,486 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "zkey_prepared.hpp"
+#include "zkey_utils.hpp"
+#include "point_compression.hpp"
+#include "fileloader.hpp"
+#include "keccak256.h"
+#include "threadpool.hpp"
+
+namespace ZKeyUtils {
+
+static const char PREPARED_TYPE[] = "pzky";
+static const uint64_t TREE_HASH_LEAF_SIZE = 1 << 20;
+
+// Point sections by curve; the sizes are those of uncompressed points
+static const uint32_t G1_POINT_SECTIONS[] = {5, 6, 8, 9, 12};
+static const uint32_t G2_POINT_SECTIONS[] = {7};
+static const uint64_t G1_POINT_SIZE = 64;
+static const uint64_t G2_POINT_SIZE = 128;
+
+static bool isG1PointSection(uint32_t id) {
+    return std::find(std::begin(G1_POINT_SECTIONS), std::end(G1_POINT_SECTIONS), id) != std::end(G1_POINT_SECTIONS);
+}
+
+static bool isG2PointSection(uint32_t id) {
+    return std::find(std::begin(G2_POINT_SECTIONS), std::end(G2_POINT_SECTIONS), id) != std::end(G2_POINT_SECTIONS);
+}
+
+// Sequential BinFile writer that aligns the data of every section
+class PreparedWriter {
+
+    std::ofstream out;
+    uint64_t pos;
+    uint32_t nSections;
+    uint64_t sectionStart;
+
+    void writeSectionHeader(uint32_t type, uint64_t size) {
+        write(&type, 4);
+        write(&size, 8);
+        nSections++;
+    }
+
+    void align() {
+        const uint64_t misalignment = (pos + 12) % PREPARED_ALIGNMENT;
+
+        if (misalignment == 0) {
+            return;
+        }
+
+        // A padding section takes 12 bytes of header itself
+        uint64_t padding = (2 * PREPARED_ALIGNMENT - misalignment - 12) % PREPARED_ALIGNMENT;
+        std::vector<char> zeros(padding, 0);
+
+        writeSectionHeader(PREPARED_SECTION_PADDING, padding);
+        write(zeros.data(), padding);
+    }
+
+public:
+    PreparedWriter(const std::string &fileName, uint32_t version)
+        : out(fileName, std::ios::binary | std::ios::trunc), pos(0), nSections(0), sectionStart(0)
+    {
+        if (!out) {
+            throw std::runtime_error("Cannot open " + fileName + " for writing");
+        }
+
+        uint32_t placeholder = 0;
+
+        write(PREPARED_TYPE, 4);
+        write(&version, 4);
+        write(&placeholder, 4);
+    }
+
+    void write(const void *data, uint64_t len) {
+        out.write((const char *)data, len);
+        if (!out) {
+            throw std::runtime_error("Write to prepared zkey failed");
+        }
+        pos += len;
+    }
+
+    void writeU64(uint64_t value) {
+        write(&value, 8);
+    }
+
+    // Returns the file offset of the section data
+    uint64_t startSection(uint32_t type) {
+        align();
+        writeSectionHeader(type, 0);
+        sectionStart = pos;
+        return sectionStart;
+    }
+
+    void endSection() {
+        const uint64_t size = pos - sectionStart;
+
+        out.seekp(sectionStart - 8);
+        out.write((const char *)&size, 8);
+        out.seekp(pos);
+    }
+
+    void writeSection(uint32_t type, const void *data, uint64_t len) {
+        startSection(type);
+        write(data, len);
+        endSection();
+    }
+
+    void finish() {
+        out.seekp(8);
+        out.write((const char *)&nSections, 4);
+        out.close();
+
+        if (!out) {
+            throw std::runtime_error("Closing prepared zkey failed");
+        }
+    }
+};
+
+bool isPrepared(const void *data, uint64_t size) {
+    return size >= 4 && memcmp(data, PREPARED_TYPE, 4) == 0;
+}
+
+void treeHash(uint8_t *digest, const void *data, uint64_t size) {
+    const uint64_t nLeaves = (size + TREE_HASH_LEAF_SIZE - 1) / TREE_HASH_LEAF_SIZE;
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    std::vector<uint8_t> leaves(nLeaves * 32 + 8);
+
+    ThreadPool::defaultPool().parallelFor(0, nLeaves, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t i = begin; i < end; i++) {
+            const uint64_t offset = i * TREE_HASH_LEAF_SIZE;
+            const uint64_t len = std::min(TREE_HASH_LEAF_SIZE, size - offset);
+
+            FIPS202_KECCAK_256(bytes + offset, len, &leaves[i * 32]);
+        }
+    });
+
+    memcpy(&leaves[nLeaves * 32], &size, 8);
+
+    FIPS202_KECCAK_256(leaves.data(), leaves.size(), digest);
+}
+
+static void loadMatrix(
+    BinFileUtils::BinFile *f,
+    PreparedMatrix &m,
+    uint32_t rowsSection,
+    uint64_t nCoefs,
+    uint32_t domainSize,
+    uint32_t n8r
+) {
+    if (f->getSectionSize(rowsSection) != ((uint64_t)domainSize + 1) * 8 ||
+        f->getSectionSize(rowsSection + 1) != nCoefs * 4 ||
+        f->getSectionSize(rowsSection + 2) != nCoefs * n8r) {
+
+        throw std::range_error("Invalid prepared coefficient section " + std::to_string(rowsSection));
+    }
+
+    m.rows = (const uint64_t *)f->getSectionData(rowsSection);
+    m.signals = (const uint32_t *)f->getSectionData(rowsSection + 1);
+    m.values = f->getSectionData(rowsSection + 2);
+    m.nCoefs = nCoefs;
+
+    if (m.rows[0] != 0 || m.rows[domainSize] != nCoefs) {
+        throw std::range_error("Invalid prepared row offsets in section " + std::to_string(rowsSection));
+    }
+
+    // The prover reads [rows[c], rows[c + 1]) unchecked; from 0 up to nCoefs
+    // without decreasing keeps every row inside the signals and values
+    for (uint32_t c = 0; c < domainSize; c++) {
+        if (m.rows[c] > m.rows[c + 1]) {
+            throw std::range_error("Prepared row offsets decrease at constraint " + std::to_string(c)
+                                   + " in section " + std::to_string(rowsSection));
+        }
+    }
+}
+
+std::unique_ptr<PreparedCoefs> loadPreparedCoefs(BinFileUtils::BinFile *f, uint32_t domainSize, uint32_t n8r) {
+
+    std::unique_ptr<PreparedCoefs> p(new PreparedCoefs());
+
+    f->startReadSection(PREPARED_SECTION_META);
+    memcpy(p->sourceHash, f->read(32), 32);
+    uint64_t nCoefsA = f->readU64LE();
+    uint64_t nCoefsB = f->readU64LE();
+    f->endReadSection();
+
+    loadMatrix(f, p->a, PREPARED_SECTION_A_ROWS, nCoefsA, domainSize, n8r);
+    loadMatrix(f, p->b, PREPARED_SECTION_B_ROWS, nCoefsB, domainSize, n8r);
+
+    return p;
+}
+
+// Calls fn(id, g2, n) for each compressed point section of n points
+template <typename Fn>
+static void forCompressedSections(BinFileUtils::BinFile *f, Fn fn) {
+
+    if (!f->hasSection(PREPARED_SECTION_COMPRESSED_POINTS)) {
+        return;
+    }
+
+    const uint64_t nIds = f->getSectionSize(PREPARED_SECTION_COMPRESSED_POINTS) / 4;
+    const uint32_t *ids = (const uint32_t *)f->getSectionData(PREPARED_SECTION_COMPRESSED_POINTS);
+
+    for (uint64_t i = 0; i < nIds; i++) {
+        const uint32_t id = ids[i];
+        const bool g2 = isG2PointSection(id);
+
+        if (!g2 && !isG1PointSection(id)) {
+            throw std::range_error("Section " + std::to_string(id) + " does not hold points");
+        }
+
+        const uint64_t compressedSize = g2 ? G2_COMPRESSED_SIZE : G1_COMPRESSED_SIZE;
+        const uint64_t sectionSize = f->getSectionSize(id);
+
+        if (sectionSize % compressedSize != 0) {
+            throw std::range_error("Invalid compressed point section " + std::to_string(id));
+        }
+
+        fn(id, g2, sectionSize / compressedSize);
+    }
+}
+
+uint64_t expandedPointsSize(BinFileUtils::BinFile *f) {
+
+    uint64_t size = 0;
+
+    forCompressedSections(f, [&size] (uint32_t id, bool g2, uint64_t n) {
+        size += n * (g2 ? G2_POINT_SIZE : G1_POINT_SIZE);
+    });
+
+    return size;
+}
+
+void expandPreparedPoints(BinFileUtils::BinFile *f, uint8_t *out) {
+
+    forCompressedSections(f, [f, &out] (uint32_t id, bool g2, uint64_t n) {
+        const uint8_t *compressed = (const uint8_t *)f->getSectionData(id);
+
+        if (g2) {
+            decompressG2Points(out, compressed, n);
+        } else {
+            decompressG1Points(out, compressed, n);
+        }
+        out += n * (g2 ? G2_POINT_SIZE : G1_POINT_SIZE);
+    });
+}
+
+PointSections expandedPointSections(BinFileUtils::BinFile *f, const uint8_t *expanded) {
+
+    PointSections sections;
+
+    forCompressedSections(f, [&sections, &expanded] (uint32_t id, bool g2, uint64_t n) {
+        const uint64_t size = n * (g2 ? G2_POINT_SIZE : G1_POINT_SIZE);
+
+        sections[id] = PointSection{expanded, size};
+        expanded += size;
+    });
+
+    return sections;
+}
+
+void prepareUltraGrothZKey(const void *data, uint64_t size, const std::string &outFileName, bool compressPoints) {
+
+    BinFileUtils::BinFile zkey(data, size, "zkey", 1);
+    auto header = ultra_groth_loadHeader(&zkey);
+
+    const uint32_t n8r = header->n8r;
+    const uint32_t domainSize = header->domainSize;
+    const uint64_t entrySize = 12 + n8r;
+
+    // Coeffs: u32 count followed by packed {m, c, s, value} entries
+    const uint8_t *coefs = (const uint8_t *)zkey.getSectionData(4);
+    const uint64_t nCoefs = *(const uint32_t *)coefs;
+
+    if (4 + nCoefs * entrySize > zkey.getSectionSize(4)) {
+        throw std::range_error("Coeffs section is too short for " + std::to_string(nCoefs) + " coefficients");
+    }
+    coefs += 4;
+
+    std::vector<uint64_t> rows[2];
+    rows[0].assign((uint64_t)domainSize + 1, 0);
+    rows[1].assign((uint64_t)domainSize + 1, 0);
+
+    for (uint64_t i = 0; i < nCoefs; i++) {
+        uint32_t mcs[3];
+        memcpy(mcs, coefs + i * entrySize, 12);
+
+        if (mcs[0] > 1 || mcs[1] >= domainSize || mcs[2] >= header->nVars) {
+            throw std::range_error("Invalid coefficient #" + std::to_string(i));
+        }
+        rows[mcs[0]][mcs[1] + 1]++;
+    }
+
+    for (int m = 0; m < 2; m++) {
+        for (uint32_t c = 0; c < domainSize; c++) {
+            rows[m][c + 1] += rows[m][c];
+        }
+    }
+
+    // Stable counting sort by constraint, keeping the zkey order within a row
+    std::vector<uint32_t> signals[2];
+    std::vector<uint8_t> values[2];
+    std::vector<uint64_t> next[2];
+
+    for (int m = 0; m < 2; m++) {
+        signals[m].resize(rows[m][domainSize]);
+        values[m].resize(rows[m][domainSize] * n8r);
+        next[m] = rows[m];
+    }
+
+    for (uint64_t i = 0; i < nCoefs; i++) {
+        const uint8_t *entry = coefs + i * entrySize;
+        uint32_t mcs[3];
+        memcpy(mcs, entry, 12);
+
+        const uint64_t k = next[mcs[0]][mcs[1]]++;
+
+        signals[mcs[0]][k] = mcs[2];
+        memcpy(&values[mcs[0]][k * n8r], entry + 12, n8r);
+    }
+
+    uint8_t sourceHash[32];
+    treeHash(sourceHash, data, size);
+
+    PreparedWriter writer(outFileName, compressPoints ? 2 : 1);
+
+    const uint32_t copied[] = {1, 2, 3, 5, 6, 7, 8, 9, 10, 11, 12};
+    std::vector<uint32_t> compressedIds;
+
+    for (uint32_t id : copied) {
+        const bool g2 = isG2PointSection(id);
+
+        if (!compressPoints || !(isG1PointSection(id) || g2)) {
+            writer.writeSection(id, zkey.getSectionData(id), zkey.getSectionSize(id));
+            continue;
+        }
+
+        const uint64_t pointSize = g2 ? G2_POINT_SIZE : G1_POINT_SIZE;
+        const uint64_t sectionSize = zkey.getSectionSize(id);
+
+        if (sectionSize % pointSize != 0) {
+            throw std::range_error("Invalid point section " + std::to_string(id));
+        }
+
+        const uint64_t n = sectionSize / pointSize;
+        std::vector<uint8_t> compressed(n * (g2 ? G2_COMPRESSED_SIZE : G1_COMPRESSED_SIZE));
+
+        if (g2) {
+            compressG2Points(compressed.data(), zkey.getSectionData(id), n);
+        } else {
+            compressG1Points(compressed.data(), zkey.getSectionData(id), n);
+        }
+
+        writer.writeSection(id, compressed.data(), compressed.size());
+        compressedIds.push_back(id);
+    }
+
+    writer.startSection(PREPARED_SECTION_META);
+    writer.write(sourceHash, 32);
+    writer.writeU64(rows[0][domainSize]);
+    writer.writeU64(rows[1][domainSize]);
+    writer.endSection();
+
+    for (int m = 0; m < 2; m++) {
+        const uint32_t base = m == 0 ? PREPARED_SECTION_A_ROWS : PREPARED_SECTION_B_ROWS;
+
+        writer.writeSection(base, rows[m].data(), rows[m].size() * 8);
+        writer.writeSection(base + 1, signals[m].data(), signals[m].size() * 4);
+        writer.writeSection(base + 2, values[m].data(), values[m].size());
+    }
+
+    if (!compressedIds.empty()) {
+        writer.writeSection(PREPARED_SECTION_COMPRESSED_POINTS, compressedIds.data(), compressedIds.size() * 4);
+    }
+
+    uint8_t checksum[32] = {0};
+    const uint64_t checksumPos = writer.startSection(PREPARED_SECTION_CHECKSUM);
+    writer.write(checksum, 32);
+    writer.endSection();
+    writer.finish();
+
+    // The checksum covers the final header, so it is patched in afterwards
+    {
+        BinFileUtils::FileLoader written(outFileName);
+        treeHash(checksum, written.dataBuffer(), checksumPos - 12);
+    }
+
+    std::fstream out(outFileName, std::ios::binary | std::ios::in | std::ios::out);
+    out.seekp(checksumPos);
+    out.write((const char *)checksum, 32);
+
+    if (!out) {
+        throw std::runtime_error("Writing prepared zkey checksum failed");
+    }
+}
+
+bool verifyPreparedChecksum(const void *data, uint64_t size) {
+
+    BinFileUtils::BinFile f(data, size, PREPARED_TYPE, PREPARED_VERSION);
+
+    if (f.getSectionSize(PREPARED_SECTION_CHECKSUM) != 32) {
+        return false;
+    }
+
+    const uint8_t *stored = (const uint8_t *)f.getSectionData(PREPARED_SECTION_CHECKSUM);
+    const uint64_t checksumPos = stored - (const uint8_t *)data;
+
+    uint8_t checksum[32];
+    treeHash(checksum, data, checksumPos - 12);
+
+    return memcmp(checksum, stored, 32) == 0;
+}
+
+// The stored checksum of a prepared zkey, nullptr if there is none
+static const uint8_t *storedChecksum(const void *data, uint64_t size) {
+
+    if (!isPrepared(data, size)) {
+        return nullptr;
+    }
+
+    BinFileUtils::BinFile f(data, size, PREPARED_TYPE, PREPARED_VERSION);
+
+    if (!f.hasSection(PREPARED_SECTION_CHECKSUM) || f.getSectionSize(PREPARED_SECTION_CHECKSUM) != 32) {
+        return nullptr;
+    }
+
+    return (const uint8_t *)f.getSectionData(PREPARED_SECTION_CHECKSUM);
+}
+
+static void sharedName(const void *data, size_t size, uint8_t *digest) {
+
+    const uint8_t *checksum = storedChecksum(data, size);
+
+    // The checksum is only read: attaching to a segment does not read the file
+    if (checksum != nullptr) {
+        memcpy(digest, checksum, 32);
+    } else {
+        treeHash(digest, data, size);
+    }
+}
+
+static bool sharedVerify(const void *data, size_t size, const uint8_t *digest) {
+
+    const uint8_t *checksum = storedChecksum(data, size);
+
+    if (checksum != nullptr) {
+        return memcmp(checksum, digest, 32) == 0 && verifyPreparedChecksum(data, size);
+    }
+
+    uint8_t hash[32];
+    treeHash(hash, data, size);
+
+    return memcmp(hash, digest, 32) == 0;
+}
+
+static size_t sharedExtraSize(const void *data, size_t size) {
+
+    if (!isPrepared(data, size)) {
+        return 0;
+    }
+
+    BinFileUtils::BinFile f(data, size, PREPARED_TYPE, PREPARED_VERSION);
+
+    return expandedPointsSize(&f);
+}
+
+static void sharedFillExtra(const void *data, size_t size, void *extra) {
+
+    BinFileUtils::BinFile f(data, size, PREPARED_TYPE, PREPARED_VERSION);
+
+    expandPreparedPoints(&f, (uint8_t *)extra);
+}
+
+const BinFileUtils::SharedSegment &zkeySharedSegment() {
+
+    static const BinFileUtils::SharedSegment segment = {sharedName, sharedVerify, sharedExtraSize, sharedFillExtra};
+
+    return segment;
+}
+
+} // namespace
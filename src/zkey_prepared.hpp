@@ -0,0 +1,118 @@
+#ifndef ZKEY_PREPARED_HPP
+#define ZKEY_PREPARED_HPP
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "binfile_utils.hpp"
+#include "fileloader.hpp"
+
+// Prepared ("compiled") UltraGroth zkey, written by prepare_zkey from a
+// snarkjs-style zkey. Same BinFile container, file type "pzky".
+//
+// Header(1), HeaderGroth(2), IC(3), PointsA(5) .. PointsH(12)
+//      copied verbatim from the source zkey
+// PreparedMeta(20)
+//      source_hash (tree keccak of the source zkey, 32 bytes)
+//      n_coefs_a (u64)
+//      n_coefs_b (u64)
+// CoefsARows(21)       u64[domain_size + 1], CSR row offsets
+// CoefsASignals(22)    u32[n_coefs_a]
+// CoefsAValues(23)     Fr[n_coefs_a]
+// CoefsBRows(24)       same for the B matrix
+// CoefsBSignals(25)
+// CoefsBValues(26)
+// CompressedPoints(27), version 2 only
+//      u32 ids of the point sections stored compressed (point_compression.hpp)
+// Checksum(30)
+//      tree keccak of every byte of the file before this section
+//
+// The Coeffs section (4) is replaced by the A and B matrices in CSR form: the
+// coefficients of constraint c are [rows[c], rows[c + 1]) of signals/values,
+// so each constraint is evaluated by one thread without locking. Padding(0)
+// sections are inserted so the data of every other section starts at a
+// 64-byte boundary of the file.
+//
+// Files with compressed point sections are written as version 2, so that
+// readers which cannot expand them reject the file.
+
+namespace ZKeyUtils {
+
+    // Highest version understood; 1 has no compressed points
+    const uint32_t PREPARED_VERSION = 2;
+
+    const uint32_t PREPARED_SECTION_PADDING = 0;
+    const uint32_t PREPARED_SECTION_META = 20;
+    const uint32_t PREPARED_SECTION_A_ROWS = 21;
+    const uint32_t PREPARED_SECTION_A_SIGNALS = 22;
+    const uint32_t PREPARED_SECTION_A_VALUES = 23;
+    const uint32_t PREPARED_SECTION_B_ROWS = 24;
+    const uint32_t PREPARED_SECTION_B_SIGNALS = 25;
+    const uint32_t PREPARED_SECTION_B_VALUES = 26;
+    const uint32_t PREPARED_SECTION_COMPRESSED_POINTS = 27;
+    const uint32_t PREPARED_SECTION_CHECKSUM = 30;
+
+    const uint64_t PREPARED_ALIGNMENT = 64;
+
+    // One constraint matrix in CSR form, pointing into the prepared file
+    struct PreparedMatrix {
+        const uint64_t *rows;
+        const uint32_t *signals;
+        const void *values;
+        uint64_t nCoefs;
+    };
+
+    class PreparedCoefs {
+    public:
+        uint8_t sourceHash[32];
+        PreparedMatrix a;
+        PreparedMatrix b;
+    };
+
+    // True if the buffer starts with the prepared file type
+    bool isPrepared(const void *data, uint64_t size);
+
+    std::unique_ptr<PreparedCoefs> loadPreparedCoefs(BinFileUtils::BinFile *f, uint32_t domainSize, uint32_t n8r);
+
+    // An expanded point section: 'size' bytes at 'data'
+    struct PointSection {
+        const uint8_t *data;
+        uint64_t size;
+    };
+
+    // Expanded point sections, keyed by section id
+    typedef std::map<uint32_t, PointSection> PointSections;
+
+    // Bytes of the compressed point sections of a prepared file once
+    // expanded; 0 if the points are stored uncompressed
+    uint64_t expandedPointsSize(BinFileUtils::BinFile *f);
+
+    // Expands the compressed point sections into 'out', expandedPointsSize
+    // bytes, one after the other
+    void expandPreparedPoints(BinFileUtils::BinFile *f, uint8_t *out);
+
+    // The sections written to 'expanded' by expandPreparedPoints
+    PointSections expandedPointSections(BinFileUtils::BinFile *f, const uint8_t *expanded);
+
+    // LOAD_SHARED segments of zkeys: named after the stored checksum of a
+    // prepared zkey, or else a treeHash of the file, and checked against it
+    // on every attach. The compressed points of a prepared zkey are expanded
+    // into the segment, after the file.
+    const BinFileUtils::SharedSegment &zkeySharedSegment();
+
+    // Keccak-256 over 1 MiB leaves hashed in parallel, then over the leaf
+    // digests followed by the total size (u64 LE)
+    void treeHash(uint8_t *digest, const void *data, uint64_t size);
+
+    // Converts the UltraGroth zkey in 'data' into a prepared file at 'outFileName',
+    // optionally with the point sections compressed to half their size
+    void prepareUltraGrothZKey(const void *data, uint64_t size, const std::string &outFileName, bool compressPoints = false);
+
+    // Recomputes the checksum of a prepared file held in 'data'
+    bool verifyPreparedChecksum(const void *data, uint64_t size);
+}
+
+#endif // ZKEY_PREPARED_HPP
@@ -157,7 +157,8 @@ std::unique_ptr<UltraGrothHeader> ultra_groth_loadHeader(BinFileUtils::BinFile *
     h->final_delta2 = f->read(h->n8q*4);
     f->endReadSection();
 
-    h->nCoefs = f->getSectionSize(4) / (12 + h->n8r);
+    // Prepared zkeys carry the coefficients in their own sections
+    h->nCoefs = f->hasSection(4) ? f->getSectionSize(4) / (12 + h->n8r) : 0;
 
     return h;
 }
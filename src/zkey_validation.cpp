@@ -0,0 +1,504 @@
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#include "zkey_validation.hpp"
+#include "zkey_prepared.hpp"
+#include "fq2.hpp"
+#include "threadpool.hpp"
+
+namespace ZKeyUtils {
+
+static const uint64_t G1_POINT_SIZE = 64;
+static const uint64_t G2_POINT_SIZE = 128;
+
+// Field orders as little-endian limbs; raw elements must be below them
+static const uint64_t Q_LIMBS[4] = {0x3c208c16d87cfd47, 0x97816a916871ca8d, 0xb85045b68181585d, 0x30644e72e131a029};
+static const uint64_t R_LIMBS[4] = {0x43e1f593f0000001, 0x2833e84879b97091, 0xb85045b68181585d, 0x30644e72e131a029};
+
+// 6x^2 for the BN254 seed x = 4965661367192848881
+static const uint64_t SIX_X_SQUARED[2] = {0xf83e9682e87cfd46, 0x6f4d8248eeb859fb};
+
+// Exponents (q - 1) / 3 and (q - 1) / 2 of the psi constants
+static const uint64_t EXP_Q_MINUS_1_DIV_3[4] = {0x69602eb24829a9c2, 0xdd2b2385cd7b4384, 0xe81ac1e7808072c9, 0x10216f7ba065e00d};
+static const uint64_t EXP_Q_MINUS_1_DIV_2[4] = {0x9e10460b6c3e7ea3, 0xcbc0b548b438e546, 0xdc2822db40c0ac2e, 0x183227397098d014};
+
+// psi(x, y) = (conj(x) * PSI_X, conj(y) * PSI_Y), the twisted Frobenius
+// endomorphism of G2 with PSI_X = xi^((q-1)/3), PSI_Y = xi^((q-1)/2), xi = 9 + u
+struct PsiConstants {
+    Fq2Element x;
+    Fq2Element y;
+
+    PsiConstants() {
+        Fq2Element xi;
+        RawFq::field.copy(xi.c0, RawFq::field.set(9));
+        RawFq::field.copy(xi.c1, RawFq::field.one());
+
+        fq2Exp(x, xi, EXP_Q_MINUS_1_DIV_3);
+        fq2Exp(y, xi, EXP_Q_MINUS_1_DIV_2);
+    }
+};
+
+static const PsiConstants &psiConstants() {
+    static const PsiConstants c;
+    return c;
+}
+
+static bool isReduced(const uint64_t *v, const uint64_t *order) {
+    for (int i = 3; i >= 0; i--) {
+        if (v[i] != order[i]) {
+            return v[i] < order[i];
+        }
+    }
+    return false;
+}
+
+static int cmpLimbs(mpz_srcptr a, const uint64_t *limbs) {
+    mpz_t b;
+
+    mpz_init(b);
+    mpz_import(b, 4, -1, sizeof(uint64_t), 0, 0, limbs);
+
+    const int cmp = mpz_cmp(a, b);
+
+    mpz_clear(b);
+    return cmp;
+}
+
+// Jacobian G2 point, the point at infinity has z = 0
+struct G2Jacobian {
+    Fq2Element x;
+    Fq2Element y;
+    Fq2Element z;
+};
+
+// dbl-2009-l; r may alias p
+static void g2Double(G2Jacobian &r, const G2Jacobian &p) {
+    Fq2Element a, b, c, d, e, f, t;
+
+    fq2Square(a, p.x);
+    fq2Square(b, p.y);
+    fq2Square(c, b);
+
+    fq2Add(t, p.x, b);
+    fq2Square(t, t);
+    fq2Sub(t, t, a);
+    fq2Sub(t, t, c);
+    fq2Add(d, t, t);
+
+    fq2Add(e, a, a);
+    fq2Add(e, e, a);
+    fq2Square(f, e);
+
+    fq2Mul(t, p.y, p.z);
+    fq2Add(r.z, t, t);
+
+    fq2Sub(r.x, f, d);
+    fq2Sub(r.x, r.x, d);
+
+    fq2Add(c, c, c);
+    fq2Add(c, c, c);
+    fq2Add(c, c, c);
+    fq2Sub(t, d, r.x);
+    fq2Mul(t, e, t);
+    fq2Sub(r.y, t, c);
+}
+
+// madd-2007-bl, p plus the affine point (x2, y2); r may alias p
+static void g2AddAffine(G2Jacobian &r, const G2Jacobian &p, const Fq2Element &x2, const Fq2Element &y2) {
+    RawFq &F = RawFq::field;
+
+    if (fq2IsZero(p.z)) {
+        r.x = x2;
+        r.y = y2;
+        F.copy(r.z.c0, F.one());
+        F.copy(r.z.c1, F.zero());
+        return;
+    }
+
+    Fq2Element z1z1, u2, s2, h, hh, i, j, rr, v, t;
+
+    fq2Square(z1z1, p.z);
+    fq2Mul(u2, x2, z1z1);
+    fq2Mul(s2, y2, p.z);
+    fq2Mul(s2, s2, z1z1);
+
+    fq2Sub(h, u2, p.x);
+    fq2Sub(rr, s2, p.y);
+    fq2Add(rr, rr, rr);
+
+    if (fq2IsZero(h)) {
+        if (fq2IsZero(rr)) {
+            g2Double(r, p);
+        } else {
+            F.copy(r.z.c0, F.zero());
+            F.copy(r.z.c1, F.zero());
+        }
+        return;
+    }
+
+    fq2Square(hh, h);
+    fq2Add(i, hh, hh);
+    fq2Add(i, i, i);
+    fq2Mul(j, h, i);
+    fq2Mul(v, p.x, i);
+
+    G2Jacobian s;
+
+    fq2Add(s.z, p.z, h);
+    fq2Square(s.z, s.z);
+    fq2Sub(s.z, s.z, z1z1);
+    fq2Sub(s.z, s.z, hh);
+
+    fq2Square(s.x, rr);
+    fq2Sub(s.x, s.x, j);
+    fq2Sub(s.x, s.x, v);
+    fq2Sub(s.x, s.x, v);
+
+    fq2Sub(t, v, s.x);
+    fq2Mul(s.y, rr, t);
+    fq2Mul(t, p.y, j);
+    fq2Add(t, t, t);
+    fq2Sub(s.y, s.y, t);
+
+    r = s;
+}
+
+static bool isValidG1Point(const FqElement &x, const FqElement &y) {
+    RawFq &F = RawFq::field;
+
+    if (!isReduced(x.v, Q_LIMBS) || !isReduced(y.v, Q_LIMBS)) {
+        return false;
+    }
+
+    if (F.isZero(x) && F.isZero(y)) {
+        return true;
+    }
+
+    FqElement lhs, rhs;
+
+    F.square(lhs, y);
+    F.square(rhs, x);
+    F.mul(rhs, rhs, x);
+    F.add(rhs, rhs, curveConstants().b1);
+
+    return F.eq(lhs, rhs);
+}
+
+static bool isValidG2Point(const Fq2Element &x, const Fq2Element &y) {
+    RawFq &F = RawFq::field;
+
+    if (!isReduced(x.c0.v, Q_LIMBS) || !isReduced(x.c1.v, Q_LIMBS) ||
+        !isReduced(y.c0.v, Q_LIMBS) || !isReduced(y.c1.v, Q_LIMBS)) {
+        return false;
+    }
+
+    if (fq2IsZero(x) && fq2IsZero(y)) {
+        return true;
+    }
+
+    Fq2Element lhs, rhs;
+
+    fq2Square(lhs, y);
+    fq2Square(rhs, x);
+    fq2Mul(rhs, rhs, x);
+    fq2Add(rhs, rhs, curveConstants().b2);
+
+    if (!fq2Eq(lhs, rhs)) {
+        return false;
+    }
+
+    // Subgroup: [6x^2]P must equal psi(P)
+    G2Jacobian acc;
+    F.copy(acc.z.c0, F.zero());
+    F.copy(acc.z.c1, F.zero());
+
+    for (int i = 126; i >= 0; i--) {
+        g2Double(acc, acc);
+        if ((SIX_X_SQUARED[i / 64] >> (i % 64)) & 1) {
+            g2AddAffine(acc, acc, x, y);
+        }
+    }
+
+    if (fq2IsZero(acc.z)) {
+        return false;
+    }
+
+    Fq2Element psiX, psiY, zz, zzz, t;
+
+    F.copy(psiX.c0, x.c0);
+    F.neg(psiX.c1, x.c1);
+    fq2Mul(psiX, psiX, psiConstants().x);
+
+    F.copy(psiY.c0, y.c0);
+    F.neg(psiY.c1, y.c1);
+    fq2Mul(psiY, psiY, psiConstants().y);
+
+    fq2Square(zz, acc.z);
+    fq2Mul(zzz, zz, acc.z);
+
+    fq2Mul(t, psiX, zz);
+    if (!fq2Eq(t, acc.x)) {
+        return false;
+    }
+
+    fq2Mul(t, psiY, zzz);
+    return fq2Eq(t, acc.y);
+}
+
+// Lowest index in [0, n) for which 'invalid' holds, or -1
+template <typename Predicate>
+static int64_t findFirst(uint64_t n, Predicate invalid) {
+    std::atomic<int64_t> first(-1);
+
+    ThreadPool::defaultPool().parallelFor(0, n, [&] (int64_t begin, int64_t end, uint64_t idThread) {
+        for (int64_t i = begin; i < end; i++) {
+            int64_t current = first;
+
+            // Another thread already failed lower down
+            if (current >= 0 && current < i) {
+                return;
+            }
+
+            if (invalid(i)) {
+                while ((current < 0 || i < current) && !first.compare_exchange_weak(current, i)) {
+                }
+                return;
+            }
+        }
+    });
+
+    return first;
+}
+
+int64_t findInvalidG1Point(const void *points, uint64_t n) {
+    const FqElement *p = (const FqElement *)points;
+
+    return findFirst(n, [&] (int64_t i) {
+        return !isValidG1Point(p[2 * i], p[2 * i + 1]);
+    });
+}
+
+int64_t findInvalidG2Point(const void *points, uint64_t n) {
+    const Fq2Element *p = (const Fq2Element *)points;
+
+    return findFirst(n, [&] (int64_t i) {
+        return !isValidG2Point(p[2 * i], p[2 * i + 1]);
+    });
+}
+
+static void checkSize(uint64_t actual, uint64_t expected, const std::string &what) {
+    if (actual != expected) {
+        throw InvalidZKey(what + " has " + std::to_string(actual) + " bytes, expected "
+                          + std::to_string(expected));
+    }
+}
+
+static void checkPoints(const void *points, uint64_t size, uint64_t n, bool g2, const std::string &what) {
+    checkSize(size, n * (g2 ? G2_POINT_SIZE : G1_POINT_SIZE), what);
+
+    const int64_t invalid = g2 ? findInvalidG2Point(points, n) : findInvalidG1Point(points, n);
+
+    if (invalid >= 0) {
+        throw InvalidZKey(what + ": point #" + std::to_string(invalid) + " is not in the "
+                          + (g2 ? "G2" : "G1") + " subgroup");
+    }
+}
+
+static void checkIndexes(BinFileUtils::BinFile *f, uint32_t id, uint64_t n, uint32_t nVars, const std::string &what) {
+    checkSize(f->getSectionSize(id), n * 4, what);
+
+    const uint32_t *indexes = (const uint32_t *)f->getSectionData(id);
+    const int64_t invalid = findFirst(n, [&] (int64_t i) { return indexes[i] >= nVars; });
+
+    if (invalid >= 0) {
+        throw InvalidZKey(what + ": index #" + std::to_string(invalid) + " is out of the witness");
+    }
+}
+
+// Coefs: u32 count, then count entries of u32 matrix, constraint, signal and
+// an Fr value
+static void checkCoefs(BinFileUtils::BinFile *f, const UltraGrothHeader &h) {
+    const uint64_t entrySize = 12 + h.n8r;
+    const uint64_t size = f->getSectionSize(4);
+    const uint8_t *coefs = (const uint8_t *)f->getSectionData(4);
+
+    if (size < 4) {
+        throw InvalidZKey("Coefs section is empty");
+    }
+
+    uint32_t n;
+    memcpy(&n, coefs, 4);
+    checkSize(size, 4 + n * entrySize, "Coefs");
+
+    const int64_t invalid = findFirst(n, [&] (int64_t i) {
+        uint32_t entry[3];
+        uint64_t value[4];
+
+        memcpy(entry, coefs + 4 + i * entrySize, sizeof(entry));
+        memcpy(value, coefs + 4 + i * entrySize + 12, sizeof(value));
+
+        return entry[0] > 1 || entry[1] >= h.domainSize || entry[2] >= h.nVars || !isReduced(value, R_LIMBS);
+    });
+
+    if (invalid >= 0) {
+        throw InvalidZKey("Coefs: entry #" + std::to_string(invalid) + " is out of range");
+    }
+}
+
+// The row offsets are checked by loadPreparedCoefs
+static void checkPreparedMatrix(const PreparedMatrix &m, const UltraGrothHeader &h, const std::string &what) {
+    const uint64_t *values = (const uint64_t *)m.values;
+
+    const int64_t invalid = findFirst(m.nCoefs, [&] (int64_t k) {
+        return m.signals[k] >= h.nVars || !isReduced(values + 4 * k, R_LIMBS);
+    });
+
+    if (invalid >= 0) {
+        throw InvalidZKey(what + ": coefficient #" + std::to_string(invalid) + " is out of range");
+    }
+}
+
+void validateUltraGrothZKey(
+    BinFileUtils::BinFile *f,
+    const UltraGrothHeader &h,
+    const PointSections &expandedPoints
+) {
+    if (isPrepared(f->data(), f->dataSize()) && !verifyPreparedChecksum(f->data(), f->dataSize())) {
+        throw InvalidZKey("Checksum does not match the prepared zkey");
+    }
+
+    if (h.n8q != 32 || h.n8r != 32 ||
+        cmpLimbs(h.qPrime, Q_LIMBS) != 0 || cmpLimbs(h.rPrime, R_LIMBS) != 0) {
+
+        throw InvalidZKey("Fields are not those of bn128");
+    }
+
+    if (h.domainSize == 0 || (h.domainSize & (h.domainSize - 1)) != 0) {
+        throw InvalidZKey("Domain size " + std::to_string(h.domainSize) + " is not a power of two");
+    }
+
+    if (h.rand_indx >= h.nVars) {
+        throw InvalidZKey("rand_indx is out of the witness");
+    }
+
+    const struct {
+        const void *point;
+        bool g2;
+        const char *name;
+    } headerPoints[] = {
+        {h.alpha1, false, "alpha1"},
+        {h.beta1, false, "beta1"},
+        {h.beta2, true, "beta2"},
+        {h.gamma2, true, "gamma2"},
+        {h.round_delta1, false, "round delta1"},
+        {h.round_delta2, true, "round delta2"},
+        {h.final_delta1, false, "final delta1"},
+        {h.final_delta2, true, "final delta2"}
+    };
+
+    for (const auto &p : headerPoints) {
+        const int64_t invalid = p.g2 ? findInvalidG2Point(p.point, 1) : findInvalidG1Point(p.point, 1);
+
+        if (invalid >= 0) {
+            throw InvalidZKey(std::string("Header point ") + p.name + " is not in the subgroup");
+        }
+    }
+
+    // IC holds at least the constant and the public signals
+    const uint64_t icSize = f->getSectionSize(3);
+
+    if (icSize % G1_POINT_SIZE != 0 || icSize / G1_POINT_SIZE < (uint64_t)h.nPublic + 1) {
+        throw InvalidZKey("IC section does not hold nPublic + 1 points");
+    }
+    checkPoints(f->getSectionData(3), icSize, icSize / G1_POINT_SIZE, false, "IC");
+
+    if (f->hasSection(4)) {
+        checkCoefs(f, h);
+    } else {
+        auto prepared = loadPreparedCoefs(f, h.domainSize, h.n8r);
+
+        checkPreparedMatrix(prepared->a, h, "Coefs A");
+        checkPreparedMatrix(prepared->b, h, "Coefs B");
+    }
+
+    checkIndexes(f, 10, h.num_indexes_c1, h.nVars, "IndexesC1");
+    checkIndexes(f, 11, h.num_indexes_c2, h.nVars, "IndexesC2");
+
+    const struct {
+        uint32_t id;
+        uint64_t n;
+        bool g2;
+        const char *name;
+    } pointSections[] = {
+        {5, h.nVars, false, "PointsA"},
+        {6, h.nVars, false, "PointsB1"},
+        {7, h.nVars, true, "PointsB2"},
+        {8, h.num_indexes_c1, false, "PointsC1"},
+        {9, h.num_indexes_c2, false, "PointsC2"},
+        {12, h.domainSize, false, "PointsH"}
+    };
+
+    for (const auto &s : pointSections) {
+        auto it = expandedPoints.find(s.id);
+
+        if (it != expandedPoints.end()) {
+            checkPoints(it->second.data, it->second.size, s.n, s.g2, s.name);
+        } else {
+            checkPoints(f->getSectionData(s.id), f->getSectionSize(s.id), s.n, s.g2, s.name);
+        }
+    }
+}
+
+static std::string toHex(const uint8_t *digest) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+
+    for (int i = 0; i < 32; i++) {
+        hex += digits[digest[i] >> 4];
+        hex += digits[digest[i] & 0xf];
+    }
+    return hex;
+}
+
+bool isValidatedInCache(const std::string &cachePath, const uint8_t *digest) {
+    std::ifstream cache(cachePath);
+    const std::string hex = toHex(digest);
+    std::string line;
+
+    while (std::getline(cache, line)) {
+        if (line == hex) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void addToValidatedCache(const std::string &cachePath, const uint8_t *digest) {
+    const std::string line = toHex(digest) + "\n";
+
+    int fd = open(cachePath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd == -1) {
+        throw std::system_error(errno, std::generic_category(), "open " + cachePath);
+    }
+
+    // Whole lines only, even with several provers validating at once
+    flock(fd, LOCK_EX);
+    const ssize_t written = write(fd, line.data(), line.size());
+    const int error = errno;
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    if (written != (ssize_t)line.size()) {
+        throw std::system_error(error, std::generic_category(), "write " + cachePath);
+    }
+}
+
+} // namespace
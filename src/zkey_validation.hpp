@@ -0,0 +1,61 @@
+#ifndef ZKEY_VALIDATION_HPP
+#define ZKEY_VALIDATION_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+#include "binfile_utils.hpp"
+#include "zkey_utils.hpp"
+#include "zkey_prepared.hpp"
+
+// Full check of an UltraGroth zkey (plain or prepared), for keys that do not
+// come straight from a trusted setup pipeline:
+//
+//   - a prepared zkey matches its stored checksum
+//   - every section has the size its header implies, and coefficients and
+//     indexes stay within the witness and the domain
+//   - every point coordinate is a reduced Fq element and every point is on
+//     its curve and in the r-order subgroup. G1 has cofactor 1; G2 points
+//     are tested with psi(P) == [6x^2]P (El Housni, Guillevic, Piellard,
+//     "Co-factor clearing and subgroup membership testing on pairing-friendly
+//     curves"), a 127-bit multiplication instead of one by r.
+//
+// The point checks run in parallel on the default thread pool. A zkey that
+// passes can be recorded in a validated-key cache: a text file with a 32-byte
+// key of every validated file, one hex digest per line. The caller picks the
+// key: the tree hash (zkey_prepared.hpp) of the data, or something cheaper to
+// get such as the stored checksum of a prepared file.
+
+namespace ZKeyUtils {
+
+    class InvalidZKey : public std::invalid_argument
+    {
+    public:
+        explicit InvalidZKey(const std::string &msg)
+            : std::invalid_argument(msg) {}
+    };
+
+    // Index of the first invalid point among n, or -1 if all are valid.
+    // The point at infinity (all zeros) is valid.
+    int64_t findInvalidG1Point(const void *points, uint64_t n);
+    int64_t findInvalidG2Point(const void *points, uint64_t n);
+
+    // Throws InvalidZKey describing the first problem found. Point sections
+    // present in 'expandedPoints' (see expandedPointSections) are checked
+    // there.
+    void validateUltraGrothZKey(
+        BinFileUtils::BinFile *f,
+        const UltraGrothHeader &h,
+        const PointSections &expandedPoints
+    );
+
+    // Validated-key cache lookups and inserts, by 32-byte key. A missing
+    // cache file is empty; inserts are appended under an exclusive lock.
+    bool isValidatedInCache(const std::string &cachePath, const uint8_t *digest);
+    void addToValidatedCache(const std::string &cachePath, const uint8_t *digest);
+}
+
+#endif // ZKEY_VALIDATION_HPP